@@ -2,6 +2,7 @@
 #include <algorithm>
 #include "qpx.hpp"
 #include "psi.hpp"
+#include "perfect_hash.hpp"
 #include <benchmark/benchmark.h>
 #include <unordered_set>
 #include <tsl/hopscotch_set.h>
@@ -19,10 +20,17 @@ spin_det_t parse_line(std::string s) {
   return sd;
 }
 
-std::vector<det_t> setup() {
+const std::string data_dir = "/home/applenco/QuantumEnvelope/data/";
+
+// Frozen wavefunctions of 6k to 145k dets (gunzipped from data/)
+const std::vector<std::string> wf_files{
+    "c2_eq_hf_dz_11.6321det.wf",  "c2_eq_hf_tz_12.13249det.wf", "c2_eq_hf_dz_13.25293det.wf",
+    "c2_eq_hf_tz_14.53009det.wf", "c2_eq_hf_dz_15.101224det.wf", "c2_eq_hf_qz_16.144532det.wf"};
+
+std::vector<det_t> setup(const std::string& path) {
   std::vector<det_t> psi;
 
-  std::ifstream fs("/home/applenco/QuantumEnvelope/data/c2_eq_hf_dz_15.101224det.wf");
+  std::ifstream fs(path);
   while(true) {
     std::string coef_str_or_empty;
     if(!std::getline(fs, coef_str_or_empty)) break;
@@ -40,6 +48,14 @@ std::vector<det_t> setup() {
   return psi;
 }
 
+std::vector<det_t> setup() { return setup(data_dir + "c2_eq_hf_dz_15.101224det.wf"); }
+
+// Hopscotch set storing the hash next to each bucket, so that rehashing and probing
+// never need to recompute `std::hash<det_t>` from the bitsets (StoreHash needs a neighborhood <= 30)
+typedef tsl::hopscotch_set<det_t, std::hash<det_t>, std::equal_to<det_t>, std::allocator<det_t>,
+                           30, true>
+    det_hopscotch_set_t;
+
 bool get_element_naive(det_t target, std::vector<det_t>& psi) {
   for(auto& det : psi) {
     if(det == target) return true;
@@ -97,6 +113,56 @@ static void BinarySearchesLookup(benchmark::State& state) {
 }
 
 
+static void BatchedLookup(benchmark::State& state) {
+  auto psi = setup();
+  std::sort(psi.begin(), psi.end());
+
+  std::vector<det_t> psi_random{psi.begin(), psi.end()};
+  std::shuffle(psi_random.begin(), psi_random.end(), std::default_random_engine{});
+  std::vector<size_t> result(psi_random.size());
+
+  for(auto _ : state) {
+    find_indices_batched(psi.begin(), psi.end(), psi_random.begin(), psi_random.end(),
+                         result.begin());
+    benchmark::DoNotOptimize(result.data());
+  }
+  state.counters["LookupRate"] =
+      benchmark::Counter(psi.size(), benchmark::Counter::kIsIterationInvariantRate);
+}
+
+static void MergeLookup(benchmark::State& state) {
+  auto psi = setup();
+  std::sort(psi.begin(), psi.end());
+
+  std::vector<det_t> vals{psi.begin(), psi.end()};
+  std::vector<size_t> result(vals.size());
+
+  for(auto _ : state) {
+    find_indices_merge(psi.begin(), psi.end(), vals.begin(), vals.end(), result.begin());
+    benchmark::DoNotOptimize(result.data());
+  }
+  state.counters["LookupRate"] =
+      benchmark::Counter(psi.size(), benchmark::Counter::kIsIterationInvariantRate);
+}
+
+// Sparse sorted queries (one det out of state.range(0)), where galloping skips most of psi
+static void MergeSparseLookup(benchmark::State& state) {
+  auto psi = setup();
+  std::sort(psi.begin(), psi.end());
+
+  std::vector<det_t> vals;
+  for(size_t i = 0; i < psi.size(); i += state.range(0)) vals.push_back(psi[i]);
+  std::vector<size_t> result(vals.size());
+
+  for(auto _ : state) {
+    find_indices_merge(psi.begin(), psi.end(), vals.begin(), vals.end(), result.begin());
+    benchmark::DoNotOptimize(result.data());
+  }
+  state.counters["LookupRate"] =
+      benchmark::Counter(vals.size(), benchmark::Counter::kIsIterationInvariantRate);
+}
+
+
 static void stdHashLookup(benchmark::State& state) {
   auto psi = setup();
   std::unordered_set<det_t> psi_s;
@@ -133,11 +199,107 @@ static void tslHashLookup(benchmark::State& state) {
       benchmark::Counter(psi.size(), benchmark::Counter::kIsIterationInvariantRate);
 }
 
+static void tslStoreHashLookup(benchmark::State& state) {
+  auto psi = setup();
+  det_hopscotch_set_t psi_s;
+  for(auto d : psi) { psi_s.insert(d); }
+
+  std::vector<det_t> psi_random{psi.begin(), psi.end()};
+  std::shuffle(psi_random.begin(), psi_random.end(), std::default_random_engine{});
+
+  for(auto _ : state) {
+    for(auto& d : psi_random) {
+      bool f = (psi_s.find(d) != psi_s.end());
+      benchmark::DoNotOptimize(f);
+    }
+  }
+  state.counters["LookupRate"] =
+      benchmark::Counter(psi.size(), benchmark::Counter::kIsIterationInvariantRate);
+}
+
+// Lookups in the frozen wavefunction wf_files[state.range(0)], in random order
+
+static void FrozenBinarySearchLookup(benchmark::State& state) {
+  auto psi = setup(data_dir + wf_files[state.range(0)]);
+  state.SetLabel(wf_files[state.range(0)]);
+  std::sort(psi.begin(), psi.end());
+
+  std::vector<det_t> psi_random{psi.begin(), psi.end()};
+  std::shuffle(psi_random.begin(), psi_random.end(), std::default_random_engine{});
+
+  for(auto _ : state) {
+    for(auto& d : psi_random) {
+      auto it = std::lower_bound(psi.begin(), psi.end(), d);
+      benchmark::DoNotOptimize(it);
+    }
+  }
+  state.counters["LookupRate"] =
+      benchmark::Counter(psi.size(), benchmark::Counter::kIsIterationInvariantRate);
+}
+
+static void FrozenHopscotchLookup(benchmark::State& state) {
+  auto psi = setup(data_dir + wf_files[state.range(0)]);
+  state.SetLabel(wf_files[state.range(0)]);
+  det_hopscotch_set_t psi_s;
+  for(auto& d : psi) psi_s.insert(d);
+
+  std::vector<det_t> psi_random{psi.begin(), psi.end()};
+  std::shuffle(psi_random.begin(), psi_random.end(), std::default_random_engine{});
+
+  for(auto _ : state) {
+    for(auto& d : psi_random) {
+      bool f = (psi_s.find(d) != psi_s.end());
+      benchmark::DoNotOptimize(f);
+    }
+  }
+  state.counters["LookupRate"] =
+      benchmark::Counter(psi.size(), benchmark::Counter::kIsIterationInvariantRate);
+}
+
+static void FrozenPerfectHashLookup(benchmark::State& state) {
+  auto psi = setup(data_dir + wf_files[state.range(0)]);
+  state.SetLabel(wf_files[state.range(0)]);
+  const det_perfect_hash_t mph(psi);
+
+  std::vector<det_t> psi_random{psi.begin(), psi.end()};
+  std::shuffle(psi_random.begin(), psi_random.end(), std::default_random_engine{});
+
+  for(auto _ : state) {
+    for(auto& d : psi_random) {
+      auto i = mph.find(d);
+      benchmark::DoNotOptimize(i);
+    }
+  }
+  state.counters["LookupRate"] =
+      benchmark::Counter(psi.size(), benchmark::Counter::kIsIterationInvariantRate);
+  state.counters["Bytes/det"] = double(mph.memory_footprint()) / psi.size();
+}
+
+static void FrozenPerfectHashBuild(benchmark::State& state) {
+  auto psi = setup(data_dir + wf_files[state.range(0)]);
+  state.SetLabel(wf_files[state.range(0)]);
+
+  for(auto _ : state) {
+    det_perfect_hash_t mph(psi);
+    benchmark::DoNotOptimize(mph);
+  }
+  state.counters["BuildRate"] =
+      benchmark::Counter(psi.size(), benchmark::Counter::kIsIterationInvariantRate);
+}
+
 // Register the function as a benchmark
 BENCHMARK(NaiveLookup);
 BENCHMARK(BinarySearchLookup);
 BENCHMARK(BinarySearchesLookup);
+BENCHMARK(BatchedLookup);
+BENCHMARK(MergeLookup);
+BENCHMARK(MergeSparseLookup)->Arg(16)->Arg(256);
 BENCHMARK(stdHashLookup);
 BENCHMARK(tslHashLookup);
+BENCHMARK(tslStoreHashLookup);
+BENCHMARK(FrozenBinarySearchLookup)->DenseRange(0, wf_files.size() - 1);
+BENCHMARK(FrozenHopscotchLookup)->DenseRange(0, wf_files.size() - 1);
+BENCHMARK(FrozenPerfectHashLookup)->DenseRange(0, wf_files.size() - 1);
+BENCHMARK(FrozenPerfectHashBuild)->DenseRange(0, wf_files.size() - 1);
 // Run the benchmark
 BENCHMARK_MAIN();
@@ -12,36 +12,53 @@
 #include <doctest/doctest.h>
 #include <qpx.hpp>
 #include <determinant.hpp>
+#include <occupancy_index.hpp>
+#include <psi.hpp>
+#include <combinatorial_rank.hpp>
 
 // Utils
-uint64_t binom(int n, int k) {
-  if(k == 0 || k == n) return 1;
-  return binom(n - 1, k - 1) + binom(n - 1, k);
-}
-
-// We don't need it.
-// But one day... Map a spin_det_t to a int
-uint64_t unchoose(int n, spin_det_t S) {
-  auto k = S.count();
-  if((k == 0) || (k == n)) return 0;
-  auto j = S.find_first();
-  if(k == 1) return j;
-  S >>= 1;
-  if(!j) return unchoose(n - 1, S);
-  return binom(n - 1, k - 1) + unchoose(n - 1, S);
-}
 
-//// i-th lexicographical bit string of lenth n with popcount k
-spin_det_t combi(size_t i, size_t n, size_t k, size_t N = 0) {
-  if(N == 0) N = n;
-  if(k == 0) return spin_det_t(N);
+TEST_CASE("testing combinatorial_ranker_t") {
+  uint64_t b;
+  CHECK((binom_fits(10, 3, b) && b == 120));
+  CHECK((binom_fits(3, 5, b) && b == 0));
+  CHECK((binom_fits(67, 33, b) && b == 14226520737620288370ull));
+  CHECK(!binom_fits(68, 34, b));
+  CHECK_THROWS_AS(combinatorial_ranker_t(128, 32), std::overflow_error);
+
+  SUBCASE("all spin dets of 7 orbitals and 3 electrons, in order") {
+    const combinatorial_ranker_t ranker(7, 3);
+    CHECK(ranker.size() == 35);
+    uint64_t expected = 0;
+    for(uint64_t x = 0; x < (1 << 7); x++) {
+      if(__builtin_popcountll(x) != 3) continue;
+      const spin_det_t s(7, x);
+      CHECK(ranker.rank(s) == expected);
+      CHECK(ranker.unrank(expected) == s);
+      expected++;
+    }
+  }
 
-  assert(i < binom(n, k));
-  auto n0 = binom(n - 1, k - 1);
-  if(i < n0) {
-    return spin_det_t(N, 1) | (combi(i, n - 1, k - 1, N) << 1);
-  } else {
-    return combi(i - n0, n - 1, k, N) << 1;
+  SUBCASE("round trip and order of dets over several words") {
+    const size_t n_orb = 150;
+    const det_ranker_t ranker(n_orb, 9, 8);
+    std::mt19937 rng(0);
+    auto random_string = [&](size_t n_elec) {
+      spin_det_t s(n_orb);
+      while(s.count() < n_elec) s.set(rng() % n_orb);
+      return s;
+    };
+    std::vector<det_t> psi;
+    for(int i = 0; i < 200; i++) psi.push_back({random_string(9), random_string(8)});
+    psi.push_back({ranker[0].unrank(ranker[0].size() - 1), ranker[1].unrank(0)});
+    CHECK(psi.back().alpha.find_first() == n_orb - 9);
+    CHECK(psi.back().beta.find_next(7) == psi.back().beta.npos);
+
+    auto ranks = ranker.rank(psi);
+    for(size_t i = 0; i < psi.size(); i++) CHECK(ranker.unrank(ranks[i]) == psi[i]);
+    std::sort(psi.begin(), psi.end());
+    std::sort(ranks.begin(), ranks.end());
+    CHECK(ranker.rank(psi) == ranks);
   }
 }
 
@@ -121,6 +138,30 @@ TEST_CASE("testing get_dets_index_statisfing_masks") {
   }
 }
 
+TEST_CASE("testing occupancy_index_t") {
+  // Same answer as the linear scan, on random determinants and masks
+  const size_t N_orb = 12;
+  std::mt19937 gen(42);
+  auto random_spin_det = [&](double p) {
+    spin_det_t s(N_orb);
+    for(size_t i = 0; i < N_orb; i++) s[i] = std::bernoulli_distribution(p)(gen);
+    return s;
+  };
+
+  std::vector<det_t> psi;
+  for(int i = 0; i < 300; i++) psi.push_back({random_spin_det(0.4), random_spin_det(0.4)});
+  const occupancy_index_t index(psi, N_orb);
+  CHECK(index.size() == psi.size());
+
+  for(int k = 0; k < 200; k++) {
+    occupancy_mask_t occ{random_spin_det(0.1), random_spin_det(0.1)};
+    unoccupancy_mask_t unocc{random_spin_det(0.1), random_spin_det(0.1)};
+    CHECK(index.query(occ, unocc) == get_dets_index_statisfing_masks(psi, occ, unocc));
+  }
+  const auto none = spin_det_t(N_orb);
+  CHECK(index.query({none, none}, {none, none}).size() == psi.size());
+}
+
 enum integrals_categorie_e { IC_A, IC_B, IC_C, IC_D, IC_E, IC_F, IC_G };
 
 /*
@@ -149,7 +190,8 @@ typedef uint64_t det_idx_t;
 typedef float phase_t;
 typedef std::pair<std::pair<det_idx_t, det_idx_t>, phase_t> H_contribution_t;
 
-std::vector<H_contribution_t> category_A(uint64_t N_orb, eri_4idx_t idx, std::vector<det_t>& psi) {
+std::vector<H_contribution_t> category_A(uint64_t N_orb, eri_4idx_t idx,
+                                         const occupancy_index_t& index) {
   assert(integral_category(idx) == IC_A);
   const auto& [i, j, k, l] = idx;
   auto occ                 = spin_occupancy_mask_t(N_orb);
@@ -158,12 +200,14 @@ std::vector<H_contribution_t> category_A(uint64_t N_orb, eri_4idx_t idx, std::ve
   auto unocc = spin_unoccupancy_mask_t(N_orb);
   std::vector<H_contribution_t> result;
   // Phase is always one
-  for(auto index : get_dets_index_statisfing_masks(psi, {occ, occ}, {unocc, unocc})) {
-    result.push_back({{index, index}, 1});
-  }
+  for(auto i : index.query({occ, occ}, {unocc, unocc})) { result.push_back({{i, i}, 1}); }
   return result;
 }
 
+std::vector<H_contribution_t> category_A(uint64_t N_orb, eri_4idx_t idx, std::vector<det_t>& psi) {
+  return category_A(N_orb, idx, occupancy_index_t(psi, N_orb));
+}
+
 TEST_CASE("testing category A") {
   std::vector<det_t> psi{
       {spin_det_t{"11001"}, spin_det_t{"11001"}},
@@ -175,7 +219,8 @@ TEST_CASE("testing category A") {
         std::vector<H_contribution_t>{{{0, 0}, 1}, {{3, 3}, 1}});
 }
 
-std::vector<H_contribution_t> category_B(uint64_t N_orb, eri_4idx_t idx, std::vector<det_t>& psi) {
+std::vector<H_contribution_t> category_B(uint64_t N_orb, eri_4idx_t idx,
+                                         const occupancy_index_t& index) {
   assert(integral_category(idx) == IC_B);
 
   const auto& [i, j, k, l] = idx;
@@ -189,17 +234,17 @@ std::vector<H_contribution_t> category_B(uint64_t N_orb, eri_4idx_t idx, std::ve
 
   // Phase is always one
   std::vector<H_contribution_t> result;
-  for(auto index : get_dets_index_statisfing_masks(psi, {occ, occ_ij}, {unocc, unocc}))
-    result.push_back({{index, index}, 1});
-  for(auto index : get_dets_index_statisfing_masks(psi, {occ_ij, occ}, {unocc, unocc}))
-    result.push_back({{index, index}, 1});
-  for(auto index : get_dets_index_statisfing_masks(psi, {occ_i, occ_j}, {unocc, unocc}))
-    result.push_back({{index, index}, 1});
-  for(auto index : get_dets_index_statisfing_masks(psi, {occ_j, occ_i}, {unocc, unocc}))
-    result.push_back({{index, index}, 1});
+  for(auto i : index.query({occ, occ_ij}, {unocc, unocc})) result.push_back({{i, i}, 1});
+  for(auto i : index.query({occ_ij, occ}, {unocc, unocc})) result.push_back({{i, i}, 1});
+  for(auto i : index.query({occ_i, occ_j}, {unocc, unocc})) result.push_back({{i, i}, 1});
+  for(auto i : index.query({occ_j, occ_i}, {unocc, unocc})) result.push_back({{i, i}, 1});
   return result;
 }
 
+std::vector<H_contribution_t> category_B(uint64_t N_orb, eri_4idx_t idx, std::vector<det_t>& psi) {
+  return category_B(N_orb, idx, occupancy_index_t(psi, N_orb));
+}
+
 TEST_CASE("testing category B") {
   std::vector<det_t> psi{
       {spin_det_t{"00110"}, spin_det_t{"00000"}},
@@ -212,6 +257,7 @@ TEST_CASE("testing category B") {
 }
 
 void category_C_ijil(uint64_t N_orb, eri_4idx_t idx, std::vector<det_t>& psi,
+                     const occupancy_index_t& index, const sorted_psi_t<det_t>& sorted_psi,
                      std::vector<H_contribution_t>& result) {
   const auto& [i, j, k, l] = idx;
   assert(i == k);
@@ -232,22 +278,29 @@ void category_C_ijil(uint64_t N_orb, eri_4idx_t idx, std::vector<det_t>& psi,
       occ[spin_a][a]    = 1;
       occ[spin_bc][b]   = 1;
       unocc[spin_bc][c] = 1;
-      for(auto index0 : get_dets_index_statisfing_masks(psi, occ, unocc)) {
-        const auto det0 = psi[index0];
-        const auto det1 = apply_single_spin_excitation(det0, spin_bc, b, c);
-
-        for(uint64_t index1 = 0; index1 < psi.size(); index1++) {
-          if(psi[index1] == det1) {
-            result.push_back(
-                {{index0, index1}, compute_phase_single_spin_excitation(det0[spin_bc], b, c)});
-          }
-        }
+      // Look up all the det1 at once in the sorted psi
+      const auto dets0 = index.query(occ, unocc);
+      std::vector<det_t> dets1;
+      dets1.reserve(dets0.size());
+      for(auto index0 : dets0)
+        dets1.push_back(apply_single_spin_excitation(psi[index0], spin_bc, b, c));
+      std::vector<std::size_t> indices1;
+      sorted_psi.find(dets1, indices1);
+
+      for(size_t k = 0; k < dets0.size(); k++) {
+        if(indices1[k] == lookup_npos) continue;
+        const uint64_t index0 = dets0[k];
+        const uint64_t index1 = indices1[k];
+        result.push_back(
+            {{index0, index1}, compute_phase_single_spin_excitation(psi[index0][spin_bc], b, c)});
       }
     }
   }
 }
 
-std::vector<H_contribution_t> category_C(uint64_t N_orb, eri_4idx_t idx, std::vector<det_t>& psi) {
+std::vector<H_contribution_t> category_C(uint64_t N_orb, eri_4idx_t idx, std::vector<det_t>& psi,
+                                         const occupancy_index_t& index,
+                                         const sorted_psi_t<det_t>& sorted_psi) {
   std::vector<H_contribution_t> result;
 
   const auto& [i, j, k, l] = idx;
@@ -265,12 +318,17 @@ std::vector<H_contribution_t> category_C(uint64_t N_orb, eri_4idx_t idx, std::ve
   const eri_4idx_t idx_bc = {a, b, a, c};
   const eri_4idx_t idx_cb = {a, c, a, b};
 
-  category_C_ijil(N_orb, idx_bc, psi, result);
-  category_C_ijil(N_orb, idx_cb, psi, result);
+  category_C_ijil(N_orb, idx_bc, psi, index, sorted_psi, result);
+  category_C_ijil(N_orb, idx_cb, psi, index, sorted_psi, result);
   return result;
 }
 
+std::vector<H_contribution_t> category_C(uint64_t N_orb, eri_4idx_t idx, std::vector<det_t>& psi) {
+  return category_C(N_orb, idx, psi, occupancy_index_t(psi, N_orb), sorted_psi_t<det_t>(psi));
+}
+
 void category_D_iiil(uint64_t N_orb, eri_4idx_t idx, std::vector<det_t>& psi,
+                     const occupancy_index_t& index, const sorted_psi_t<det_t>& sorted_psi,
                      std::vector<H_contribution_t>& result) {
   const auto& [i, j, k, l] = idx;
   assert(i == k);
@@ -302,23 +360,29 @@ void category_D_iiil(uint64_t N_orb, eri_4idx_t idx, std::vector<det_t>& psi,
       occ[spin_ph][h]   = 1;
       occ[spin_aa][a]   = 1;
       unocc[spin_ph][p] = 1;
-      for(auto index0 : get_dets_index_statisfing_masks(psi, occ, unocc)) {
-        const auto det0 = psi[index0];
-        const auto det1 = apply_single_spin_excitation(det0, spin_ph, h, p);
-
-        for(uint64_t index1 = 0; index1 < psi.size(); index1++) {
-          if(psi[index1] == det1) {
-            result.push_back(
-                {{index0, index1}, compute_phase_single_spin_excitation(det0[spin_ph], h, p)});
-          }
-        }
+      // Look up all the det1 at once in the sorted psi
+      const auto dets0 = index.query(occ, unocc);
+      std::vector<det_t> dets1;
+      dets1.reserve(dets0.size());
+      for(auto index0 : dets0)
+        dets1.push_back(apply_single_spin_excitation(psi[index0], spin_ph, h, p));
+      std::vector<std::size_t> indices1;
+      sorted_psi.find(dets1, indices1);
+
+      for(size_t k = 0; k < dets0.size(); k++) {
+        if(indices1[k] == lookup_npos) continue;
+        const uint64_t index0 = dets0[k];
+        const uint64_t index1 = indices1[k];
+        result.push_back(
+            {{index0, index1}, compute_phase_single_spin_excitation(psi[index0][spin_ph], h, p)});
       }
     }
   }
 }
 
-
-std::vector<H_contribution_t> category_D(uint64_t N_orb, eri_4idx_t idx, std::vector<det_t>& psi) {
+std::vector<H_contribution_t> category_D(uint64_t N_orb, eri_4idx_t idx, std::vector<det_t>& psi,
+                                         const occupancy_index_t& index,
+                                         const sorted_psi_t<det_t>& sorted_psi) {
   std::vector<H_contribution_t> result;
 
   const auto& [i, j, k, l] = idx;
@@ -334,6 +398,41 @@ std::vector<H_contribution_t> category_D(uint64_t N_orb, eri_4idx_t idx, std::ve
     b = i;
   }
 
-  category_D_iiil(N_orb, {a, a, a, b}, psi, result);
+  category_D_iiil(N_orb, {a, a, a, b}, psi, index, sorted_psi, result);
   return result;
 }
+
+std::vector<H_contribution_t> category_D(uint64_t N_orb, eri_4idx_t idx, std::vector<det_t>& psi) {
+  return category_D(N_orb, idx, psi, occupancy_index_t(psi, N_orb), sorted_psi_t<det_t>(psi));
+}
+
+TEST_CASE("testing category C and D with a shared index") {
+  // a det and its alpha single 1 -> 2
+  std::vector<det_t> psi{
+      {spin_det_t{"00011"}, spin_det_t{"00001"}},
+      {spin_det_t{"00101"}, spin_det_t{"00001"}},
+      {spin_det_t{"00110"}, spin_det_t{"00011"}},
+      {spin_det_t{"00011"}, spin_det_t{"00101"}},
+  };
+  const uint64_t N_orb = 5;
+  const occupancy_index_t index(psi, N_orb);
+  const sorted_psi_t<det_t> sorted_psi(psi);
+
+  // (01|02) couples them once through the alpha and once through the beta electron in 0
+  const auto c = category_C(N_orb, {0, 1, 0, 2}, psi, index, sorted_psi);
+  CHECK(std::count(c.begin(), c.end(), H_contribution_t{{0, 1}, 1}) == 2);
+  CHECK(std::count(c.begin(), c.end(), H_contribution_t{{1, 0}, 1}) == 2);
+
+  // the index built once per psi serves every integral
+  for(uint64_t a = 0; a < N_orb; a++)
+    for(uint64_t b = 0; b < N_orb; b++) {
+      if(b == a) continue;
+      CHECK(category_D(N_orb, {a, a, a, b}, psi, index, sorted_psi) ==
+            category_D(N_orb, {a, a, a, b}, psi));
+      for(uint64_t d = b + 1; d < N_orb; d++) {
+        if(d == a) continue;
+        CHECK(category_C(N_orb, {a, b, a, d}, psi, index, sorted_psi) ==
+              category_C(N_orb, {a, b, a, d}, psi));
+      }
+    }
+}
@@ -0,0 +1,126 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstdint>
+#include <qpx.hpp>
+#include <stdexcept>
+#include <vector>
+
+// Binomial coefficient C(n, k), or false if it does not fit in 64 bits
+inline bool binom_fits(uint64_t n, uint64_t k, uint64_t& res) {
+  if(k > n) {
+    res = 0;
+    return true;
+  }
+  k   = std::min(k, n - k);
+  res = 1;
+  // C(n - k + i, i) = C(n - k + i - 1, i - 1) * (n - k + i) / i is exact at every step
+  for(uint64_t i = 1; i <= k; i++) {
+    const __uint128_t r = static_cast<__uint128_t>(res) * (n - k + i) / i;
+    if(r > UINT64_MAX) return false;
+    res = static_cast<uint64_t>(r);
+  }
+  return true;
+}
+
+/*
+Ranking of the spin determinants of n_orb orbitals and n_elec electrons in [0, C(n_orb, n_elec)).
+
+The rank is the combinatorial number system: with c_0 < c_1 < ... the occupied orbitals,
+    rank = C(c_0, 1) + C(c_1, 2) + ... + C(c_{n_elec - 1}, n_elec),
+so ranks follow the order of the bit strings as integers (the order of spin_det_t), one table
+lookup per electron. Unranking picks the electrons from the last one, each by a binary search in a
+row of the same table.
+
+Construction throws std::overflow_error when C(n_orb, n_elec) does not fit in 64 bits.
+*/
+class combinatorial_ranker_t {
+public:
+  combinatorial_ranker_t(size_t n_orb, size_t n_elec): m_n_orb(n_orb), m_n_elec(n_elec) {
+    if(n_elec > n_orb || !binom_fits(n_orb, n_elec, m_size))
+      throw std::overflow_error("combinatorial_ranker_t: C(n_orb, n_elec) exceeds 64 bits");
+
+    // m_table[(i - 1) * n_orb + c] = C(c, i), saturated: the entries above C(n_orb, n_elec) are
+    // never part of a rank, and only need to compare greater than any rank when unranking
+    m_table.resize(n_elec * n_orb);
+    for(size_t i = 1; i <= n_elec; i++)
+      for(size_t c = 0; c < n_orb; c++) {
+        uint64_t b;
+        m_table[(i - 1) * n_orb + c] = binom_fits(c, i, b) ? b : UINT64_MAX;
+      }
+  }
+
+  size_t n_orb() const { return m_n_orb; }
+  size_t n_elec() const { return m_n_elec; }
+  // Number of spin determinants, one past the largest rank
+  uint64_t size() const { return m_size; }
+
+  uint64_t rank(const spin_det_t& s) const {
+    assert(s.count() == m_n_elec);
+    assert(s.find_next(m_n_orb - 1) == s.npos);
+    const auto* blocks = s.data();
+    uint64_t r         = 0;
+    size_t i           = 0;
+    for(size_t w = 0; w < s.num_blocks(); w++)
+      for(uint64_t b = blocks[w]; b; b &= b - 1, i++)
+        r += m_table[i * m_n_orb + 64 * w + __builtin_ctzll(b)];
+    return r;
+  }
+
+  spin_det_t unrank(uint64_t r) const {
+    assert(r < m_size);
+    spin_det_t s(m_n_orb);
+    size_t hi = m_n_orb;
+    for(size_t i = m_n_elec; i > 0; i--) {
+      // largest c < hi with C(c, i) <= r
+      const auto* row = m_table.data() + (i - 1) * m_n_orb;
+      const size_t c  = std::upper_bound(row, row + hi, r) - row - 1;
+      s.set(c);
+      r -= row[c];
+      hi = c;
+    }
+    return s;
+  }
+
+private:
+  size_t m_n_orb, m_n_elec;
+  uint64_t m_size;
+  std::vector<uint64_t> m_table;
+};
+
+// A determinant as the ranks of its alpha and beta strings: 16 bytes, ordered like det_t, and
+// hashed, compared and radix sorted as plain integers
+typedef std::array<uint64_t, N_SPIN_SPECIES> det_rank_t;
+
+class det_ranker_t {
+public:
+  det_ranker_t(size_t n_orb, size_t n_alpha, size_t n_beta)
+      : m_rankers{combinatorial_ranker_t(n_orb, n_alpha), combinatorial_ranker_t(n_orb, n_beta)} {}
+
+  const combinatorial_ranker_t& operator[](int spin) const { return m_rankers[spin]; }
+
+  det_rank_t rank(const det_t& d) const {
+    return {m_rankers[0].rank(d[0]), m_rankers[1].rank(d[1])};
+  }
+  det_t unrank(const det_rank_t& r) const {
+    return {m_rankers[0].unrank(r[0]), m_rankers[1].unrank(r[1])};
+  }
+
+  std::vector<det_rank_t> rank(const std::vector<det_t>& psi) const {
+    std::vector<det_rank_t> res;
+    res.reserve(psi.size());
+    for(const auto& d : psi) res.push_back(rank(d));
+    return res;
+  }
+
+private:
+  std::array<combinatorial_ranker_t, N_SPIN_SPECIES> m_rankers;
+};
+
+struct det_rank_hash_t {
+  std::size_t operator()(det_rank_t const& r) const noexcept {
+    return hash_mix(r[0] ^ 0xa0761d6478bd642full, r[1] ^ 0xe7037ed1a0b428dbull);
+  }
+};
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <numeric>
+#include <qpx.hpp>
+#include <vector>
+
+// Inverted index of a wavefunction: for each spin and orbital, the sorted list of the indices of
+// the determinants in which that orbital is occupied.
+//
+// A query "occupied in `occ`, unoccupied in `unocc`" starts from the shortest posting list of the
+// occupied orbitals, intersects it with the others and removes the postings of the unoccupied
+// ones, so it only touches determinants that share the occupied orbitals instead of all of psi.
+class occupancy_index_t {
+public:
+  typedef unsigned det_idx_t;
+  typedef std::vector<det_idx_t> posting_t;
+
+  occupancy_index_t() = default;
+
+  occupancy_index_t(const std::vector<det_t>& psi, size_t N_orb): m_n_dets(psi.size()) {
+    for(auto& postings : m_postings) postings.resize(N_orb);
+    for(det_idx_t i = 0; i < psi.size(); i++) {
+      for(size_t spin = 0; spin < N_SPIN_SPECIES; spin++) {
+        const auto& d = psi[i][spin];
+        for(auto o = d.find_first(); o != d.npos && o < N_orb; o = d.find_next(o))
+          m_postings[spin][o].push_back(i);
+      }
+    }
+  }
+
+  size_t size() const { return m_n_dets; }
+  size_t n_orb() const { return m_postings[0].size(); }
+
+  // Indices of the determinants in which orbital `o` of `spin` is occupied, in increasing order
+  const posting_t& occupied(size_t spin, size_t o) const { return m_postings[spin][o]; }
+
+  // Indices, in increasing order, of the determinants in which every orbital of occ[spin] is
+  // occupied and every orbital of unocc[spin] is unoccupied
+  posting_t query(const occupancy_mask_t& occ, const unoccupancy_mask_t& unocc) const {
+    std::vector<const posting_t*> with, without;
+    for(size_t spin = 0; spin < N_SPIN_SPECIES; spin++) {
+      for(auto o = occ[spin].find_first(); o != occ[spin].npos; o = occ[spin].find_next(o))
+        with.push_back(&m_postings[spin][o]);
+      for(auto o = unocc[spin].find_first(); o != unocc[spin].npos; o = unocc[spin].find_next(o))
+        without.push_back(&m_postings[spin][o]);
+    }
+    // shortest lists first, so that the running result shrinks as fast as possible
+    std::sort(with.begin(), with.end(),
+              [](const posting_t* a, const posting_t* b) { return a->size() < b->size(); });
+
+    posting_t result;
+    if(with.empty()) {
+      result.resize(m_n_dets);
+      std::iota(result.begin(), result.end(), 0);
+    } else {
+      result = *with[0];
+    }
+    for(size_t k = 1; k < with.size() && !result.empty(); k++) filter(result, *with[k], true);
+    for(size_t k = 0; k < without.size() && !result.empty(); k++) filter(result, *without[k], false);
+    return result;
+  }
+
+private:
+  size_t m_n_dets = 0;
+  std::array<std::vector<posting_t>, N_SPIN_SPECIES> m_postings;
+
+  // Keep the elements of `result` that are (keep == true) or are not (keep == false) in `list`.
+  // Galloping search in `list`, since result is usually much shorter.
+  static void filter(posting_t& result, const posting_t& list, bool keep) {
+    auto first = list.begin();
+    size_t n   = 0;
+    for(const auto i : result) {
+      size_t step = 1;
+      auto hi     = first;
+      while(hi != list.end() && *hi < i) {
+        first = hi;
+        hi    = (size_t(list.end() - hi) > step) ? hi + step : list.end();
+        step *= 2;
+      }
+      first            = std::lower_bound(first, hi, i);
+      const bool found = (first != list.end() && *first == i);
+      if(found == keep) result[n++] = i;
+    }
+    result.resize(n);
+  }
+};
@@ -0,0 +1,211 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <psi.hpp>
+#include <qpx.hpp>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+// Map a 64-bit hash uniformly to [0, n) without a division
+inline uint64_t fastrange(uint64_t h, uint64_t n) {
+  return static_cast<uint64_t>((static_cast<__uint128_t>(h) * n) >> 64);
+}
+
+/*
+Minimal perfect hash of a frozen wavefunction: maps each of the n determinants of psi to a distinct
+slot in [0, n), which holds the determinant packed into raw words and its position in psi. A lookup
+costs one hash, a seed read and one slot read and comparison, whatever the determinant.
+
+Hash-and-displace construction (CHD / PTHash). The keys are split by hash into partitions of about
+PARTITION_SIZE keys, each owning its own range of slots, so that partitions are built
+independently, one per thread. Within a partition keys are grouped in buckets of LAMBDA keys on
+average; buckets are placed largest first, each trying seeds 0, 1, ... until its keys all land on
+free slots, and only the seed is stored.
+
+Memory: 8 bytes per 64 orbitals and spin plus 8 bytes for the position per slot, plus 4 / LAMBDA
+bytes per key for the seeds; about 25 bytes per det up to 64 orbitals. All the dets of psi must
+have the same number of orbitals.
+*/
+class det_perfect_hash_t {
+public:
+  static constexpr std::size_t PARTITION_SIZE = 1 << 14;
+  static constexpr std::size_t LAMBDA         = 4;
+
+  det_perfect_hash_t(const std::vector<det_t>& psi,
+                     unsigned n_threads = std::thread::hardware_concurrency()) {
+    const std::size_t n = psi.size();
+    if(n) m_n_orb = {psi[0].alpha.size(), psi[0].beta.size()};
+    for(const auto& d : psi)
+      if(d.alpha.size() != m_n_orb[0] || d.beta.size() != m_n_orb[1])
+        throw std::invalid_argument("det_perfect_hash_t: dets of different sizes in psi");
+    m_n_words = {psi.empty() ? 0 : psi[0].alpha.num_blocks(),
+                 psi.empty() ? 0 : psi[0].beta.num_blocks()};
+    m_stride  = m_n_words[0] + m_n_words[1] + 1;
+    m_table.resize(n * m_stride);
+
+    n_threads      = std::max(1u, n_threads);
+    m_n_partitions = std::max<std::size_t>(1, (n + PARTITION_SIZE - 1) / PARTITION_SIZE);
+
+    std::vector<uint64_t> hashes(n);
+    parallel_for(n_threads, n_threads, [&](std::size_t t) {
+      for(std::size_t i = t * n / n_threads; i < (t + 1) * n / n_threads; i++)
+        hashes[i] = m_hash(psi[i]);
+    });
+
+    // Counting sort of the keys by partition
+    m_slot_offset.assign(m_n_partitions + 1, 0);
+    for(const auto h : hashes) m_slot_offset[partition(h) + 1]++;
+    m_bucket_offset.assign(m_n_partitions + 1, 0);
+    for(std::size_t p = 0; p < m_n_partitions; p++) {
+      const auto m           = m_slot_offset[p + 1];
+      m_slot_offset[p + 1]   = m_slot_offset[p] + m;
+      m_bucket_offset[p + 1] = m_bucket_offset[p] + (m + LAMBDA - 1) / LAMBDA;
+    }
+    std::vector<uint32_t> keys(n);
+    {
+      auto next = m_slot_offset;
+      for(std::size_t i = 0; i < n; i++) keys[next[partition(hashes[i])]++] = i;
+    }
+
+    m_seeds.assign(m_bucket_offset.back(), 0);
+    std::vector<char> ok(m_n_partitions, true);
+    parallel_for(n_threads, m_n_partitions, [&](std::size_t p) {
+      ok[p] = build_partition(p, psi, hashes, keys.data() + m_slot_offset[p]);
+    });
+    if(!std::all_of(ok.begin(), ok.end(), [](char b) { return b; }))
+      throw std::invalid_argument("det_perfect_hash_t: duplicate determinants in psi");
+  }
+
+  std::size_t size() const { return m_stride ? m_table.size() / m_stride : 0; }
+
+  // Bytes used by the hash (psi is not referenced after construction)
+  std::size_t memory_footprint() const {
+    return sizeof(*this) + m_table.size() * sizeof(uint64_t) + m_seeds.size() * sizeof(uint32_t) +
+           (m_slot_offset.size() + m_bucket_offset.size()) * sizeof(std::size_t);
+  }
+
+  // Position of `d` in psi, or lookup_npos if `d` is not in psi
+  std::size_t find(const det_t& d) const {
+    if(m_table.empty() || d.alpha.size() != m_n_orb[0] || d.beta.size() != m_n_orb[1])
+      return lookup_npos;
+    const uint64_t* entry = m_table.data() + slot(m_hash(d)) * m_stride;
+    for(std::size_t s = 0; s < N_SPIN_SPECIES; s++) {
+      const auto* blocks = d[s].data();
+      for(std::size_t w = 0; w < m_n_words[s]; w++, entry++)
+        if(*entry != static_cast<uint64_t>(blocks[w])) return lookup_npos;
+    }
+    return *entry;
+  }
+
+private:
+  std::hash<det_t> m_hash;
+  std::array<std::size_t, N_SPIN_SPECIES> m_n_orb{}, m_n_words{};
+  std::size_t m_n_partitions = 1;
+  // Partition p owns slots [m_slot_offset[p], m_slot_offset[p + 1]) and buckets
+  // [m_bucket_offset[p], m_bucket_offset[p + 1])
+  std::vector<std::size_t> m_slot_offset, m_bucket_offset;
+  std::vector<uint32_t> m_seeds;
+  // Slot i: the alpha then beta words of its det, then the det's position in psi
+  std::size_t m_stride = 1;
+  std::vector<uint64_t> m_table;
+
+  std::size_t partition(uint64_t h) const { return fastrange(h, m_n_partitions); }
+
+  static std::size_t bucket(uint64_t h, std::size_t n_buckets) {
+    return fastrange(hash_mix(h, 0xa0761d6478bd642full), n_buckets);
+  }
+
+  // Slot of a key inside its partition of m keys, for a given bucket seed
+  static std::size_t local_slot(uint64_t h, uint32_t seed, std::size_t m) {
+    return fastrange(hash_mix(h ^ 0xe7037ed1a0b428dbull, (seed + 1) * 0x9e3779b97f4a7c15ull), m);
+  }
+
+  std::size_t slot(uint64_t h) const {
+    const auto p         = partition(h);
+    const auto m         = m_slot_offset[p + 1] - m_slot_offset[p];
+    const auto n_buckets = m_bucket_offset[p + 1] - m_bucket_offset[p];
+    const auto seed      = m_seeds[m_bucket_offset[p] + bucket(h, n_buckets)];
+    return m_slot_offset[p] + local_slot(h, seed, m);
+  }
+
+  // Place the m keys of partition p. Fails only if two keys have the same 64-bit hash, in
+  // which case no seed can separate them.
+  bool build_partition(std::size_t p, const std::vector<det_t>& psi,
+                       const std::vector<uint64_t>& hashes, const uint32_t* keys) {
+    const std::size_t m         = m_slot_offset[p + 1] - m_slot_offset[p];
+    const std::size_t n_buckets = m_bucket_offset[p + 1] - m_bucket_offset[p];
+
+    // Keys grouped by bucket (counting sort), then buckets ordered by decreasing size
+    std::vector<uint32_t> first(n_buckets + 1, 0), by_bucket(m);
+    for(std::size_t k = 0; k < m; k++) first[bucket(hashes[keys[k]], n_buckets) + 1]++;
+    for(std::size_t b = 0; b < n_buckets; b++) first[b + 1] += first[b];
+    {
+      auto next = first;
+      for(std::size_t k = 0; k < m; k++)
+        by_bucket[next[bucket(hashes[keys[k]], n_buckets)]++] = keys[k];
+    }
+    std::vector<uint32_t> order(n_buckets);
+    for(std::size_t b = 0; b < n_buckets; b++) order[b] = b;
+    std::stable_sort(order.begin(), order.end(), [&first](uint32_t a, uint32_t b) {
+      return first[a + 1] - first[a] > first[b + 1] - first[b];
+    });
+
+    std::vector<char> taken(m, false);
+    std::vector<std::size_t> slots;
+    for(const auto b : order) {
+      const auto* bucket_keys = by_bucket.data() + first[b];
+      const std::size_t size  = first[b + 1] - first[b];
+      if(size == 0) break;
+      for(std::size_t i = 0; i < size; i++)
+        for(std::size_t j = 0; j < i; j++)
+          if(hashes[bucket_keys[i]] == hashes[bucket_keys[j]]) return false;
+
+      for(uint32_t seed = 0;; seed++) {
+        slots.clear();
+        for(std::size_t i = 0; i < size; i++) {
+          const auto s = local_slot(hashes[bucket_keys[i]], seed, m);
+          if(taken[s]) break;
+          taken[s] = true;
+          slots.push_back(s);
+        }
+        if(slots.size() == size) {
+          m_seeds[m_bucket_offset[p] + b] = seed;
+          for(std::size_t i = 0; i < size; i++)
+            pack(psi[bucket_keys[i]], bucket_keys[i], m_slot_offset[p] + slots[i]);
+          break;
+        }
+        for(const auto s : slots) taken[s] = false;
+      }
+    }
+    return true;
+  }
+
+  void pack(const det_t& d, std::size_t index, std::size_t slot) {
+    uint64_t* entry = m_table.data() + slot * m_stride;
+    for(std::size_t s = 0; s < N_SPIN_SPECIES; s++) {
+      const auto* blocks = d[s].data();
+      for(std::size_t w = 0; w < m_n_words[s]; w++) *entry++ = static_cast<uint64_t>(blocks[w]);
+    }
+    *entry = index;
+  }
+
+  // Run f(0), ..., f(n - 1) on up to n_threads threads
+  template<class F>
+  static void parallel_for(unsigned n_threads, std::size_t n, F f) {
+    const std::size_t n_workers = std::min<std::size_t>(n_threads, n);
+    if(n_workers <= 1) {
+      for(std::size_t i = 0; i < n; i++) f(i);
+      return;
+    }
+    std::vector<std::thread> workers;
+    for(std::size_t t = 0; t < n_workers; t++)
+      workers.emplace_back([&f, t, n, n_workers] {
+        for(std::size_t i = t; i < n; i += n_workers) f(i);
+      });
+    for(auto& w : workers) w.join();
+  }
+};
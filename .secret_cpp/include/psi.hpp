@@ -1,37 +1,118 @@
 #pragma once
 
-template<class ForwardIterator, class ForwardIteratorBool>
-void binary_searchs_imp(ForwardIterator first, ForwardIterator last, ForwardIterator v_first,
-                        ForwardIterator v_last, ForwardIterator v, ForwardIteratorBool i) {
-  // Return:       *v ∈? [first, last).
-  // Precondition: v ∈ [v_first, v_last)
-
-  // pos is pointer ∈ [first, last) pointing `*v`.
-  auto pos = std::lower_bound(first, last, *v);
-  // Lazy: only set i, if found
-  if(pos != last && !(*v < *pos)) *i = true;
-
-  // Find the new `v` to search for
-  // v_first     v                v_last
-  // |-----------|----------------|
-  {
-    // Botom Half [v_first, v)
-    // End the recursion when v_first == v, we search for all our values
-    // if distance == 1, need to search for v_first
-    auto d = std::distance(v_first, v);
-    if(pos != first && d > 0)
-      binary_searchs_imp(first, pos, v_first, v - 1, v - (d + 1) / 2, i - (d + 1) / 2);
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <iterator>
+#include <limits>
+#include <numeric>
+#include <vector>
+
+// Index reported by the lookups below for values absent from the searched range
+constexpr std::size_t lookup_npos = std::numeric_limits<std::size_t>::max();
+
+// Number of values searched in lockstep by find_indices_batched. Their probes are independent,
+// so the memory accesses of a whole block are in flight at once instead of one binary search
+// waiting on each of its cache misses in turn.
+constexpr std::size_t lookup_block_size = 32;
+
+template<class RandomIt, class ForwardIt, class OutputIt>
+OutputIt find_indices_batched(RandomIt first, RandomIt last, ForwardIt v_first, ForwardIt v_last,
+                              OutputIt out) {
+  // For each *v in [v_first, v_last), in any order, write to `out` the position in the sorted
+  // range [first, last) of an element equal to *v, or lookup_npos.
+  const auto n = std::distance(first, last);
+  std::array<RandomIt, lookup_block_size> base;
+  std::array<ForwardIt, lookup_block_size> v;
+
+  while(v_first != v_last) {
+    std::size_t m = 0;
+    for(; m < lookup_block_size && v_first != v_last; m++, ++v_first) {
+      v[m]    = v_first;
+      base[m] = first;
+    }
+    // Lockstep lower bound: every search of the block has the same remaining length, so one
+    // loop advances them all. Ends with base[k] the last element < *v[k], or first.
+    for(auto len = n; len > 1;) {
+      const auto half = len / 2;
+      for(std::size_t k = 0; k < m; k++)
+        if(base[k][half] < *v[k]) base[k] += half;
+      len -= half;
+    }
+    for(std::size_t k = 0; k < m; k++, ++out) {
+      const auto pos = (n > 0 && *base[k] < *v[k]) ? base[k] + 1 : base[k];
+      *out = (pos != last && !(*v[k] < *pos)) ? std::size_t(pos - first) : lookup_npos;
+    }
   }
-  {
-    // Top Half (v, v_last)
-    // We cannot deference v_last, so we stop the recursion when d == 1
-    auto d = std::distance(v, v_last);
-    if(pos != last && d > 1) binary_searchs_imp(pos, last, v + 1, v_last, v + d / 2, i + d / 2);
+  return out;
+}
+
+template<class RandomIt, class ForwardIt, class OutputIt>
+OutputIt find_indices_merge(RandomIt first, RandomIt last, ForwardIt v_first, ForwardIt v_last,
+                            OutputIt out) {
+  // Same as find_indices_batched, for sorted values: merge-join of the two ranges, galloping
+  // from the previous match so that sparse values skip most of [first, last).
+  auto pos = first;
+  for(; v_first != v_last; ++v_first, ++out) {
+    const auto& v = *v_first;
+    // Invariant: every element before pos is < v, and hi == last or *hi >= v
+    std::size_t step = 1;
+    auto hi          = pos;
+    while(hi != last && *hi < v) {
+      pos = hi + 1;
+      hi  = (std::size_t(last - pos) > step) ? pos + step : last;
+      step *= 2;
+    }
+    pos  = std::lower_bound(pos, hi, v);
+    *out = (pos != last && !(v < *pos)) ? std::size_t(pos - first) : lookup_npos;
   }
+  return out;
+}
+
+template<class RandomIt, class ForwardIt, class OutputIt>
+OutputIt find_indices(RandomIt first, RandomIt last, ForwardIt v_first, ForwardIt v_last,
+                      OutputIt out) {
+  // Positions in the sorted range [first, last) of the values [v_first, v_last), or lookup_npos.
+  // The merge-join is used when the values are sorted themselves.
+  if(std::is_sorted(v_first, v_last)) return find_indices_merge(first, last, v_first, v_last, out);
+  return find_indices_batched(first, last, v_first, v_last, out);
 }
 
 template<class T1, class T2>
 void binary_searchs(T1& enumerable, T1& values, T2& result) {
-  binary_searchs_imp(enumerable.begin(), enumerable.end(), values.begin(), values.end(),
-                     values.begin() + values.size() / 2, result.begin() + values.size() / 2);
+  // Return:       result[i] = true if values[i] ∈ enumerable (left untouched otherwise).
+  // Precondition: enumerable and values are sorted
+  std::vector<std::size_t> idx(values.size());
+  find_indices_merge(enumerable.begin(), enumerable.end(), values.begin(), values.end(),
+                     idx.begin());
+  for(std::size_t i = 0; i < idx.size(); i++)
+    if(idx[i] != lookup_npos) result[i] = true;
 }
+
+// Sorted copy of a wavefunction that remembers where each determinant came from, to find the
+// positions in psi of many determinants at once (e.g. all the dets1 connected to a set of det0)
+template<class T>
+class sorted_psi_t {
+public:
+  explicit sorted_psi_t(const std::vector<T>& psi): m_order(psi.size()) {
+    std::iota(m_order.begin(), m_order.end(), 0);
+    std::sort(m_order.begin(), m_order.end(),
+              [&psi](std::size_t a, std::size_t b) { return psi[a] < psi[b]; });
+    m_sorted.reserve(psi.size());
+    for(const auto i : m_order) m_sorted.push_back(psi[i]);
+  }
+
+  std::size_t size() const { return m_sorted.size(); }
+
+  // idx[i] = position in psi of dets[i], or lookup_npos if dets[i] is not in psi
+  void find(const std::vector<T>& dets, std::vector<std::size_t>& idx) const {
+    idx.resize(dets.size());
+    find_indices(m_sorted.begin(), m_sorted.end(), dets.begin(), dets.end(), idx.begin());
+    for(auto& i : idx)
+      if(i != lookup_npos) i = m_order[i];
+  }
+
+private:
+  std::vector<T> m_sorted;
+  std::vector<std::size_t> m_order;
+};
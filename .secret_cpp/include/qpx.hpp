@@ -8,11 +8,27 @@
 
 typedef sul::dynamic_bitset<> spin_det_t;
 
+// wyhash-style mixing: fold the 128-bit product of the two operands into 64 bits
+inline uint64_t hash_mix(uint64_t a, uint64_t b) {
+  __uint128_t r = static_cast<__uint128_t>(a) * b;
+  return static_cast<uint64_t>(r) ^ static_cast<uint64_t>(r >> 64);
+}
+
+// Hash the raw blocks of the bitset instead of its string representation
+inline std::size_t hash_spin_det(const spin_det_t& s, uint64_t seed = 0) {
+  constexpr uint64_t p0 = 0xa0761d6478bd642full;
+  constexpr uint64_t p1 = 0xe7037ed1a0b428dbull;
+  const auto* blocks    = s.data();
+  const std::size_t n   = s.num_blocks();
+
+  uint64_t h = seed;
+  for(std::size_t i = 0; i < n; i++) h = hash_mix(static_cast<uint64_t>(blocks[i]) ^ p0, h ^ p1);
+  return hash_mix(h ^ p0, n ^ p1);
+}
+
 template<>
 struct std::hash<spin_det_t> {
-  std::size_t operator()(spin_det_t const& s) const noexcept {
-    return std::hash<std::string>()(s.to_string());
-  }
+  std::size_t operator()(spin_det_t const& s) const noexcept { return hash_spin_det(s); }
 };
 
 #define N_SPIN_SPECIES 2
@@ -44,15 +60,13 @@ public: // Access specifier
     }
   }
   // https://stackoverflow.com/a/27830679/7674852 seem to recommand doing the other way arround
-  const spin_det_t& operator[](unsigned i) const { return (*this)[i]; }
+  const spin_det_t& operator[](unsigned i) const { return const_cast<det_t&>(*this)[i]; }
 };
 
 template<>
 struct std::hash<det_t> {
   std::size_t operator()(det_t const& s) const noexcept {
-    std::size_t h1 = std::hash<spin_det_t>{}(s.alpha);
-    std::size_t h2 = std::hash<spin_det_t>{}(s.beta);
-    return h1 ^ (h2 << 1);
+    return hash_spin_det(s.beta, hash_spin_det(s.alpha));
   }
 };
 
@@ -1,12 +1,15 @@
 #include "qpx.hpp"
 #include "psi.hpp"
+#include "perfect_hash.hpp"
 #include <algorithm>
 #include <iterator>
 #if !defined(DOCTEST_CONFIG_DISABLE)
 #define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
 #endif
 #include <doctest/doctest.h>
+#include <random>
 #include <sstream>
+#include <unordered_set>
 
 namespace doctest {
 template<typename T>
@@ -70,3 +73,91 @@ TEST_CASE("testing binary_searches") {
     CHECK(results == expected);
   }
 }
+
+TEST_CASE("testing find_indices") {
+  std::vector<int> source{1, 2, 3, 4, 6, 10, 11, 40};
+  const auto expected_index = [&](int v) {
+    const auto it = std::find(source.begin(), source.end(), v);
+    return it == source.end() ? lookup_npos : size_t(it - source.begin());
+  };
+
+  SUBCASE("empty source") {
+    std::vector<int> empty, vals{1, 2};
+    std::vector<size_t> idx(vals.size());
+    find_indices_batched(empty.begin(), empty.end(), vals.begin(), vals.end(), idx.begin());
+    CHECK(idx == std::vector<size_t>{lookup_npos, lookup_npos});
+    find_indices_merge(empty.begin(), empty.end(), vals.begin(), vals.end(), idx.begin());
+    CHECK(idx == std::vector<size_t>{lookup_npos, lookup_npos});
+  }
+
+  SUBCASE("all values, more than a block, sorted and shuffled") {
+    std::vector<int> vals;
+    for(int v = -1; v < 45; v++) vals.push_back(v);
+    for(int shuffled = 0; shuffled < 2; shuffled++) {
+      std::vector<size_t> expected, batched(vals.size()), merged(vals.size()), any(vals.size());
+      for(auto v : vals) expected.push_back(expected_index(v));
+      find_indices_batched(source.begin(), source.end(), vals.begin(), vals.end(), batched.begin());
+      find_indices(source.begin(), source.end(), vals.begin(), vals.end(), any.begin());
+      CHECK(batched == expected);
+      CHECK(any == expected);
+      if(!shuffled) {
+        find_indices_merge(source.begin(), source.end(), vals.begin(), vals.end(), merged.begin());
+        CHECK(merged == expected);
+      }
+      std::reverse(vals.begin(), vals.end());
+      std::swap(vals[3], vals[20]);
+    }
+  }
+
+  SUBCASE("sorted values with duplicates") {
+    std::vector<int> vals{2, 2, 5, 40, 40, 41};
+    std::vector<size_t> idx(vals.size());
+    find_indices_merge(source.begin(), source.end(), vals.begin(), vals.end(), idx.begin());
+    CHECK(idx == std::vector<size_t>{1, 1, lookup_npos, 7, 7, lookup_npos});
+  }
+}
+
+TEST_CASE("testing sorted_psi_t") {
+  const std::vector<int> psi{7, 3, 9, 1};
+  const sorted_psi_t<int> sorted_psi(psi);
+  CHECK(sorted_psi.size() == 4);
+  std::vector<size_t> idx;
+  sorted_psi.find({9, 1, 4, 7, 3}, idx);
+  CHECK(idx == std::vector<size_t>{2, 3, lookup_npos, 0, 1});
+}
+
+TEST_CASE("testing det_perfect_hash_t") {
+  // Enough random dets for several partitions, and some more that are not in psi
+  std::mt19937 rng(0);
+  std::unordered_set<det_t> seen;
+  std::vector<det_t> psi, others;
+  while(seen.size() < 3 * det_perfect_hash_t::PARTITION_SIZE + 100) {
+    spin_det_t alpha(70), beta(70);
+    for(int k = 0; k < 8; k++) {
+      alpha[rng() % 70] = 1;
+      beta[rng() % 70]  = 1;
+    }
+    det_t d{alpha, beta};
+    if(seen.insert(d).second) (seen.size() % 10 ? psi : others).push_back(d);
+  }
+
+  for(unsigned n_threads : {1, 4}) {
+    const det_perfect_hash_t mph(psi, n_threads);
+    CHECK(mph.size() == psi.size());
+    bool all_found = true;
+    for(size_t i = 0; i < psi.size(); i++) all_found &= (mph.find(psi[i]) == i);
+    CHECK(all_found);
+    bool none_found = true;
+    for(const auto& d : others) none_found &= (mph.find(d) == lookup_npos);
+    CHECK(none_found);
+    CHECK(mph.memory_footprint() < 45 * psi.size());
+    CHECK(mph.find(det_t{spin_det_t(64), psi[0].beta}) == lookup_npos);
+  }
+
+  const std::vector<det_t> empty;
+  CHECK(det_perfect_hash_t(empty).find(psi[0]) == lookup_npos);
+
+  auto with_duplicate = psi;
+  with_duplicate.push_back(psi[42]);
+  CHECK_THROWS_AS(det_perfect_hash_t{with_duplicate}, std::invalid_argument);
+}
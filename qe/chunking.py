@@ -8,6 +8,28 @@ from qe.integral_indexing_utils import (
     canonical_idx4,
 )
 from qe.drivers import integral_category
+import pathlib
+from ctypes import CDLL, POINTER, c_int
+from ctypes import c_longlong as idx_t
+
+build_folder = pathlib.Path(__file__).parent.resolve().joinpath("build")
+chunking_lib = CDLL(build_folder.joinpath("libchunking.so"))
+
+idx_array = np.ctypeslib.ndpointer(dtype=np.int64, ndim=1, flags="C_CONTIGUOUS")
+val_array = np.ctypeslib.ndpointer(dtype=np.float64, ndim=1, flags="C_CONTIGUOUS")
+chunking_lib.jchunk_factory_size.restype = idx_t
+chunking_lib.jchunk_factory_size.argtypes = [
+    idx_t, c_int, idx_t, idx_t, idx_t, c_int, POINTER(idx_t),
+]  # fmt: skip
+chunking_lib.jchunk_factory_fill.restype = c_int
+chunking_lib.jchunk_factory_fill.argtypes = [
+    idx_t, c_int, idx_t, idx_t, idx_t, c_int,
+    idx_array, val_array, idx_t,
+    idx_array, val_array, idx_array,
+]  # fmt: skip
+
+# chunk_distribution_t of qe/src/include/chunking.h
+CHUNK_DISTRIBUTIONS = {"round_robin": 0, "contiguous": 1}
 
 
 def batched(iterable, n):
@@ -182,19 +204,60 @@ class JChunkFactory:
             return JChunk(chunk_size, J_vals, J_ind)
 
 
-if __name__ == "__main__":
-
-    class FakeComm:
-        def __init__(self, rank, size):
-            self.rank = rank
-            self.size = size
+def native_chunks(N_mo, category, src=None, chunk_size=-1, comm=None, distribution="round_robin"):
+    """Chunks of JChunkFactory(N_mo, category, src_data, chunk_size, comm).get_chunks(), built
+    natively instead of with generators: the same indices in the same order with
+    distribution="round_robin", or a contiguous range of the batches with "contiguous".
+    src : (sorted compound indices, values) of the category, e.g. an entry of the two-electron
+        integrals of load_integral_store; integrals not listed, or all when src is None, are zero.
+
+    >>> list(JChunkFactory.B_idx_iter(4))
+    [3, 15, 45, 17, 47, 50]
+    >>> [(c.idx.tolist(), c.J.tolist()) for c in native_chunks(4, "B", chunk_size=4)]
+    [([3, 15, 45, 17], [0.0, 0.0, 0.0, 0.0]), ([47, 50], [0.0, 0.0])]
+    >>> src = (np.array([3, 17]), np.array([0.5, 0.25]))
+    >>> chunk = native_chunks(4, "B", src, comm=FakeComm(1, 2))
+    >>> chunk.chunk_size, chunk.idx.tolist(), chunk.J.tolist()
+    (3, [15, 17, 50], [0.0, 0.25, 0.0])
+    >>> chunks = native_chunks(4, "B", chunk_size=2, comm=FakeComm(0, 2), distribution="contiguous")
+    >>> [c.idx.tolist() for c in chunks]
+    [[3, 15], [45, 17]]
+    """
+    rank, size = (0, 1) if comm is None else (comm.Get_rank(), comm.Get_size())
+    args = (N_mo, "ABCDEFG".index(category), chunk_size, rank, size)
+    args += (CHUNK_DISTRIBUTIONS[distribution],)
+    n_chunks = idx_t()
+    n = chunking_lib.jchunk_factory_size(*args, n_chunks)
+    if n < 0:
+        raise ValueError(f"invalid chunking of category {category}")
+    J_ind = np.empty(n, dtype=np.int64)
+    J = np.empty(n)
+    offsets = np.empty(n_chunks.value + 1, dtype=np.int64)
+    if src is None:
+        src = (np.empty(0, dtype=np.int64), np.empty(0))
+    src_idx = np.ascontiguousarray(src[0], dtype=np.int64)
+    src_val = np.ascontiguousarray(src[1], dtype=np.float64)
+    chunking_lib.jchunk_factory_fill(*args, src_idx, src_val, src_idx.size, J_ind, J, offsets)
+    chunks = [
+        JChunk(int(end - begin), J[begin:end], J_ind[begin:end], category)
+        for begin, end in zip(offsets[:-1], offsets[1:])
+    ]
+    return chunks if chunk_size >= 1 else chunks[0]
+
+
+class FakeComm:
+    def __init__(self, rank, size):
+        self.rank = rank
+        self.size = size
+
+    def Get_rank(self):
+        return self.rank
+
+    def Get_size(self):
+        return self.size
 
-        def Get_rank(self):
-            return self.rank
-
-        def Get_size(self):
-            return self.size
 
+if __name__ == "__main__":
     def test_chunk(N_mo, cat, ref_data, src_data=IntegralReader()):
         fact = JChunkFactory(N_mo, cat, src_data)
         chunk = fact.get_chunks()
@@ -24,6 +24,7 @@ from qe.integral_indexing_utils import (
     compound_idx4_reverse,
     compound_idx4,
     canonical_idx4,
+    idx_array,
 )
 
 import pathlib
@@ -47,6 +48,18 @@ it_lib = CDLL(run_folder.joinpath("build/libintegral_types.so"))
 it_lib.integral_category.restype = c_char
 it_lib.integral_category.argtypes = [idx_t, idx_t, idx_t, idx_t]
 
+# j_category values (IC_A, ..., IC_G) are C ints
+category_array = np.ctypeslib.ndpointer(dtype=np.intc, flags="C_CONTIGUOUS")
+
+it_lib.integral_category_batch.restype = None
+it_lib.integral_category_batch.argtypes = [idx_array, category_array, idx_t]
+
+it_lib.integral_category_ijkl_batch.restype = idx_t
+it_lib.integral_category_ijkl_batch.argtypes = [idx_array] * 4 + [category_array, idx_t]
+
+it_lib.integral_category_partition.restype = None
+it_lib.integral_category_partition.argtypes = [idx_array, idx_t, idx_array, idx_array]
+
 
 @offload(return_str(it_lib.integral_category))
 def integral_category(i, j, k, l):
@@ -97,6 +110,47 @@ def integral_category(i, j, k, l):
         return "G"
 
 
+def integral_category_batch(ijkl):
+    """
+    integral_category of an array of compound indices, as an array of j_category values
+    (0 for "A", ..., 6 for "G")
+    >>> integral_category_batch([compound_idx4(0, 0, 0, 0), compound_idx4(0, 1, 2, 3)])
+    array([0, 6], dtype=int32)
+    """
+    ijkl = np.ascontiguousarray(ijkl, dtype=np.int64)
+    cat = np.empty(ijkl.size, dtype=np.intc)
+    it_lib.integral_category_batch(ijkl, cat, ijkl.size)
+    return cat
+
+
+def integral_category_ijkl_batch(i, j, k, l):
+    """
+    integral_category of arrays of indices, taken in canonical order
+    returns (categories, number of non-canonical (i, j, k, l))
+    >>> integral_category_ijkl_batch([0, 1], [1, 0], [0, 0], [2, 0])
+    (array([2, 3], dtype=int32), 1)
+    """
+    i, j, k, l = (np.ascontiguousarray(x, dtype=np.int64) for x in (i, j, k, l))
+    cat = np.empty(i.size, dtype=np.intc)
+    n_non_canonical = it_lib.integral_category_ijkl_batch(i, j, k, l, cat, i.size)
+    return cat, n_non_canonical
+
+
+def integral_category_partition(ijkl):
+    """
+    split an array of compound indices by integral category, keeping their order
+    returns {category: array of compound indices}
+    >>> p = integral_category_partition([compound_idx4(0, 1, 2, 3), 0, 1, compound_idx4(0, 1, 2, 4)])
+    >>> {c: v.tolist() for c, v in p.items() if v.size}
+    {'A': [0], 'D': [1], 'G': [31, 69]}
+    """
+    ijkl = np.ascontiguousarray(ijkl, dtype=np.int64)
+    out = np.empty(ijkl.size, dtype=np.int64)
+    offsets = np.empty(len("ABCDEFG") + 1, dtype=np.int64)
+    it_lib.integral_category_partition(ijkl, ijkl.size, out, offsets)
+    return {c: out[offsets[n] : offsets[n + 1]] for n, c in enumerate("ABCDEFG")}
+
+
 #   ______ _                                      _   _____         _ _        _   _
 #   | ___ \ |                                    | | |  ___|       (_) |      | | (_)
 #   | |_/ / |__   __ _ ___  ___    __ _ _ __   __| | | |____  _____ _| |_ __ _| |_ _  ___  _ __
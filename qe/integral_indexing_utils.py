@@ -2,6 +2,7 @@
 import math
 from ctypes import CDLL, Structure
 from ctypes import c_longlong as idx_t
+import numpy as np
 from qe.func_decorators import return_tuple, offload
 import pathlib
 
@@ -87,6 +88,23 @@ iu_lib.canonical_idx4.argtypes = [idx_t, idx_t, idx_t, idx_t]
 iu_lib.compound_idx4_reverse_all.restype = ijkl_perms
 iu_lib.compound_idx4_reverse_all.argtypes = [idx_t]
 
+idx_array = np.ctypeslib.ndpointer(dtype=np.int64, flags="C_CONTIGUOUS")
+
+iu_lib.compound_idx2_batch.restype = None
+iu_lib.compound_idx2_batch.argtypes = [idx_array] * 3 + [idx_t]
+
+iu_lib.compound_idx4_batch.restype = None
+iu_lib.compound_idx4_batch.argtypes = [idx_array] * 5 + [idx_t]
+
+iu_lib.canonical_idx4_batch.restype = None
+iu_lib.canonical_idx4_batch.argtypes = [idx_array] * 8 + [idx_t]
+
+iu_lib.compound_idx2_reverse_batch.restype = None
+iu_lib.compound_idx2_reverse_batch.argtypes = [idx_array] * 3 + [idx_t]
+
+iu_lib.compound_idx4_reverse_batch.restype = None
+iu_lib.compound_idx4_reverse_batch.argtypes = [idx_array] * 5 + [idx_t]
+
 # iu_lib.get_unique_idx4.restype = c_int
 # iu_lib.get_unique_idx4.argtypes = [POINTER(ijkl_tuple), ijkl_perms]
 
@@ -257,3 +275,74 @@ def canonical_idx4(i, j, k, l):
         return i, j, k, l
     else:
         return j, i, l, k
+
+
+# Array forms: element-wise versions of the functions above over whole index arrays,
+# in a single (vectorized) call to the library
+
+
+def _idx_arrays(*arrays):
+    arrays = [np.ascontiguousarray(a, dtype=np.int64) for a in arrays]
+    n = arrays[0].size
+    assert all(a.size == n for a in arrays)
+    return arrays, n
+
+
+def compound_idx2_batch(i, j):
+    """
+    compound_idx2 over arrays
+    >>> compound_idx2_batch([0, 0, 1, 2], [0, 1, 1, 1])
+    array([0, 1, 2, 4])
+    """
+    (i, j), n = _idx_arrays(i, j)
+    ij = np.empty(n, dtype=np.int64)
+    iu_lib.compound_idx2_batch(i, j, ij, n)
+    return ij
+
+
+def compound_idx4_batch(i, j, k, l):
+    """
+    compound_idx4 over arrays
+    >>> compound_idx4_batch([0, 0, 1, 1, 1], [0, 1, 1, 0, 0], [0, 0, 0, 1, 1], [0, 0, 0, 0, 1])
+    array([0, 1, 2, 3, 4])
+    """
+    (i, j, k, l), n = _idx_arrays(i, j, k, l)
+    ijkl = np.empty(n, dtype=np.int64)
+    iu_lib.compound_idx4_batch(i, j, k, l, ijkl, n)
+    return ijkl
+
+
+def canonical_idx4_batch(i, j, k, l):
+    """
+    canonical_idx4 over arrays, returns the arrays (i, j, k, l)
+    >>> canonical_idx4_batch([1, 4, 3, 1], [0, 2, 2, 3], [0, 3, 1, 4], [0, 1, 4, 2])
+    (array([0, 1, 1, 2]), array([0, 3, 2, 1]), array([0, 2, 3, 3]), array([1, 4, 4, 4]))
+    """
+    (i, j, k, l), n = _idx_arrays(i, j, k, l)
+    out = tuple(np.empty(n, dtype=np.int64) for _ in range(4))
+    iu_lib.canonical_idx4_batch(i, j, k, l, *out, n)
+    return out
+
+
+def compound_idx2_reverse_batch(ij):
+    """
+    compound_idx2_reverse over an array, returns the arrays (i, j)
+    >>> compound_idx2_reverse_batch([0, 1, 2, 3])
+    (array([0, 0, 1, 0]), array([0, 1, 1, 2]))
+    """
+    (ij,), n = _idx_arrays(ij)
+    out = tuple(np.empty(n, dtype=np.int64) for _ in range(2))
+    iu_lib.compound_idx2_reverse_batch(ij, *out, n)
+    return out
+
+
+def compound_idx4_reverse_batch(ijkl):
+    """
+    compound_idx4_reverse over an array, returns the arrays (i, j, k, l)
+    >>> compound_idx4_reverse_batch([0, 3, 37])
+    (array([0, 0, 0]), array([0, 1, 2]), array([0, 0, 1]), array([0, 1, 3]))
+    """
+    (ijkl,), n = _idx_arrays(ijkl)
+    out = tuple(np.empty(n, dtype=np.int64) for _ in range(4))
+    iu_lib.compound_idx4_reverse_batch(ijkl, *out, n)
+    return out
@@ -7,9 +7,54 @@ from qe.fundamental_types import (
     List,
 )
 from collections import defaultdict
-from qe.integral_indexing_utils import compound_idx4
+from qe.integral_indexing_utils import compound_idx4_batch
 import math
 from itertools import takewhile
+import pathlib
+from ctypes import CDLL, POINTER, c_void_p, c_char_p, c_int, c_double
+from ctypes import c_longlong as idx_t
+import numpy as np
+
+build_folder = pathlib.Path(__file__).parent.resolve().joinpath("build")
+fcidump_lib = CDLL(build_folder.joinpath("libfcidump.so"))
+store_lib = CDLL(build_folder.joinpath("libintegral_store.so"))
+
+fcidump_lib.fcidump_load.restype = c_void_p
+fcidump_lib.fcidump_load.argtypes = [c_char_p, c_int]
+fcidump_lib.fcidump_free.restype = None
+fcidump_lib.fcidump_free.argtypes = [c_void_p]
+fcidump_lib.fcidump_n_orb.restype = idx_t
+fcidump_lib.fcidump_n_orb.argtypes = [c_void_p]
+fcidump_lib.fcidump_E0.restype = c_double
+fcidump_lib.fcidump_E0.argtypes = [c_void_p]
+fcidump_lib.fcidump_one_e.restype = POINTER(c_double)
+fcidump_lib.fcidump_one_e.argtypes = [c_void_p]
+fcidump_lib.fcidump_two_e_size.restype = idx_t
+fcidump_lib.fcidump_two_e_size.argtypes = [c_void_p, c_int]
+fcidump_lib.fcidump_two_e_idx.restype = POINTER(idx_t)
+fcidump_lib.fcidump_two_e_idx.argtypes = [c_void_p, c_int]
+fcidump_lib.fcidump_two_e_val.restype = POINTER(c_double)
+fcidump_lib.fcidump_two_e_val.argtypes = [c_void_p, c_int]
+store_lib.integral_store_write_fcidump.restype = c_int
+store_lib.integral_store_write_fcidump.argtypes = [c_char_p, c_char_p, c_int]
+
+# integral_store_header_t of qe/src/include/integral_store.h
+INTEGRAL_STORE_VERSION = 1
+integral_store_header = np.dtype(
+    [
+        ("magic", "S8"),
+        ("version", np.uint64),
+        ("file_size", np.uint64),
+        ("n_orb", np.int64),
+        ("E0", np.float64),
+        ("one_e_offset", np.uint64),
+        (
+            "categories",
+            [("count", np.uint64), ("idx_offset", np.uint64), ("val_offset", np.uint64)],
+            7,
+        ),
+    ]
+)
 
 #   _____      _ _   _       _ _          _   _
 #  |_   _|    (_) | (_)     | (_)        | | (_)
@@ -74,6 +119,8 @@ def load_integrals(
 
     d_one_e_integral = defaultdict(int)
     d_two_e_integral = defaultdict(int)
+    # Two-electron integrals are keyed after reading, with one compound_idx4_batch call
+    two_e_idx, two_e_values = [], []
 
     for line in f:
         v, *l = line.split()
@@ -95,14 +142,112 @@ def load_integrals(
             # Exchange r1 and r2 (indices i,k and j,l)
             # Exchange i,k
             # Exchange j,l
-            key = compound_idx4(i - 1, j - 1, k - 1, l - 1)
-            d_two_e_integral[key] = v
+            two_e_idx.append((i - 1, j - 1, k - 1, l - 1))
+            two_e_values.append(v)
 
     f.close()
 
+    if two_e_idx:
+        keys = compound_idx4_batch(*zip(*two_e_idx))
+        d_two_e_integral.update(zip(keys.tolist(), two_e_values))
+
     return n_orb, E0, d_one_e_integral, d_two_e_integral
 
 
+def load_integrals_arrays(fcidump_path, n_threads=0):
+    """Read all the Hamiltonian integrals with the native FCIDUMP reader (.fcidump, .gz or .bz2).
+    Returns: (n_orb, E0, one_e_integral, two_e_integral).
+    one_e_integral : dense (n_orb, n_orb) array,
+    two_e_integral : for each category "A" to "G", (compound indices, values) arrays, the
+        indices sorted.
+    n_threads : parsing threads, all hardware threads when 0.
+    """
+    handle = fcidump_lib.fcidump_load(str(fcidump_path).encode(), n_threads)
+    if not handle:
+        raise IOError(f"cannot load integrals from {fcidump_path}")
+    try:
+        n_orb = fcidump_lib.fcidump_n_orb(handle)
+        E0 = fcidump_lib.fcidump_E0(handle)
+        one_e = np.ctypeslib.as_array(
+            fcidump_lib.fcidump_one_e(handle), shape=(n_orb, n_orb)
+        ).copy()
+        two_e = {}
+        for c, category in enumerate("ABCDEFG"):
+            n = fcidump_lib.fcidump_two_e_size(handle, c)
+            if n == 0:
+                two_e[category] = (np.empty(0, dtype=np.int64), np.empty(0))
+                continue
+            idx = fcidump_lib.fcidump_two_e_idx(handle, c)
+            val = fcidump_lib.fcidump_two_e_val(handle, c)
+            two_e[category] = (
+                np.ctypeslib.as_array(idx, shape=(n,)).copy(),
+                np.ctypeslib.as_array(val, shape=(n,)).copy(),
+            )
+    finally:
+        fcidump_lib.fcidump_free(handle)
+    return n_orb, E0, one_e, two_e
+
+
+def write_integral_store(fcidump_path, store_path, n_threads=0):
+    """Convert an FCIDUMP file (.fcidump, .gz or .bz2) to a binary integral store, which
+    load_integral_store maps in memory instead of parsing text."""
+    if store_lib.integral_store_write_fcidump(
+        str(fcidump_path).encode(), str(store_path).encode(), n_threads
+    ):
+        raise IOError(f"cannot convert {fcidump_path} to {store_path}")
+
+
+def load_integral_store(store_path):
+    """Map a binary integral store (see write_integral_store) in memory.
+    Returns the same (n_orb, E0, one_e_integral, two_e_integral) as load_integrals_arrays, but
+    the arrays are read-only views of the mapped file, shared between the processes that map it.
+    """
+    data = np.memmap(store_path, dtype=np.uint8, mode="r")
+    header = data[: integral_store_header.itemsize].view(integral_store_header)[0]
+    if header["magic"] != b"QEINTS" or header["version"] != INTEGRAL_STORE_VERSION:
+        raise IOError(f"{store_path} is not a version {INTEGRAL_STORE_VERSION} integral store")
+    if header["file_size"] != data.size:
+        raise IOError(f"{store_path} is truncated")
+
+    def section(offset, dtype, count):
+        return np.frombuffer(data, dtype=dtype, count=count, offset=int(offset))
+
+    n_orb = int(header["n_orb"])
+    one_e = section(header["one_e_offset"], np.float64, n_orb * n_orb).reshape(n_orb, n_orb)
+    two_e = {}
+    for c, category in enumerate("ABCDEFG"):
+        count, idx_offset, val_offset = (int(x) for x in header["categories"][c])
+        two_e[category] = (
+            section(idx_offset, np.int64, count),
+            section(val_offset, np.float64, count),
+        )
+    return n_orb, float(header["E0"]), one_e, two_e
+
+
+def screen_integrals(two_e_integral, threshold):
+    """Drop the two-electron integrals of absolute value below threshold, as sparse_tej_t does.
+    two_e_integral : (compound indices, values) for each category, as from load_integrals_arrays
+        or load_integral_store.
+    Returns: (screened two_e_integral, number of dropped integrals, Frobenius norm of the dropped
+    integrals), counting each distinct integral once.
+
+    >>> two_e = {"A": (np.array([0, 2]), np.array([1.0, 1e-12])),
+    ...          "G": (np.array([31]), np.array([-3e-11]))}
+    >>> screened, n_dropped, norm = screen_integrals(two_e, 1e-10)
+    >>> screened["A"], screened["G"], n_dropped, round(norm / 1e-12, 6)
+    ((array([0]), array([1.])), (array([], dtype=int64), array([], dtype=float64)), 2, 30.016662)
+    """
+    screened = {}
+    n_dropped = 0
+    dropped_sq = 0.0
+    for category, (idx, val) in two_e_integral.items():
+        keep = np.abs(val) >= threshold
+        screened[category] = (idx[keep], val[keep])
+        n_dropped += int(keep.size - np.count_nonzero(keep))
+        dropped_sq += float(np.sum(np.square(val[~keep])))
+    return screened, n_dropped, math.sqrt(dropped_sq)
+
+
 def load_wf(
     path_wf, det_representation="tuple"
 ) -> Tuple[List[float], List[Determinant]]:
@@ -0,0 +1,87 @@
+"""NumPy exchange of determinants in the psi_block layout of qe/src/include/psi_block.h.
+
+A block of n determinants of n_orb orbitals is a C-contiguous uint64 array of shape
+(2, n_words, stride): word w of the alpha (beta) spin determinant of det i is block[0, w, i]
+(block[1, w, i]). The array is 64-byte aligned and stride is n rounded up to PSI_BLOCK_PAD, so that
+the native kernels use it in place, without converting each determinant.
+"""
+import pathlib
+from ctypes import CDLL, c_int, c_size_t
+import numpy as np
+from qe.fundamental_types import Determinant
+
+build_folder = pathlib.Path(__file__).parent.resolve().joinpath("build")
+psi_block_lib = CDLL(build_folder.joinpath("libpsi_block.so"))
+
+words_array = np.ctypeslib.ndpointer(dtype=np.uint64, flags="C_CONTIGUOUS")
+degree_array = np.ctypeslib.ndpointer(dtype=np.int8, ndim=1, flags="C_CONTIGUOUS")
+psi_block_lib.psi_block_filter_connected.restype = c_int
+psi_block_lib.psi_block_filter_connected.argtypes = [
+    c_int, words_array, words_array, c_size_t, c_size_t, degree_array,
+]  # fmt: skip
+
+# psi_block::PAD, and the static_det_t widths the native code is built for
+PSI_BLOCK_PAD = 8
+PSI_BLOCK_WORDS = (1, 2, 4, 8)
+
+
+def psi_block_words(n_orb):
+    """Smallest supported number of 64-bit words per spin holding n_orb orbitals
+
+    >>> psi_block_words(64), psi_block_words(65)
+    (1, 2)
+    """
+    for n_words in PSI_BLOCK_WORDS:
+        if n_orb <= 64 * n_words:
+            return n_words
+    raise ValueError(f"psi_block: {n_orb} orbitals is more than {64 * PSI_BLOCK_WORDS[-1]}")
+
+
+def empty_psi_block(n, n_words):
+    """Zeroed, 64-byte aligned block for n determinants"""
+    stride = -(-n // PSI_BLOCK_PAD) * PSI_BLOCK_PAD
+    size = 2 * n_words * stride
+    # over-allocate by one cache line and start at the first aligned word
+    buf = np.zeros(size + 8, dtype=np.uint64)
+    offset = (-buf.ctypes.data % 64) // 8
+    return buf[offset : offset + size].reshape(2, n_words, stride)
+
+
+def set_det(block, i, det):
+    """Write det (tuple representation) as determinant i of `block`"""
+    for spin, spin_det in enumerate((det.alpha, det.beta)):
+        for o in spin_det:
+            block[spin, o // 64, i] |= np.uint64(1) << np.uint64(o % 64)
+
+
+def to_psi_block(dets, n_orb):
+    """Block of the determinants `dets` (tuple representation) of n_orb orbitals"""
+    block = empty_psi_block(len(dets), psi_block_words(n_orb))
+    for i, det in enumerate(dets):
+        set_det(block, i, det)
+    return block
+
+
+def from_psi_block(block, n):
+    """The first n determinants of `block`, in tuple representation"""
+    n_words = block.shape[1]
+
+    def occupied(spin, i):
+        words = [int(block[spin, w, i]) for w in range(n_words)]
+        return tuple(64 * w + b for w, x in enumerate(words) for b in range(64) if (x >> b) & 1)
+
+    return [Determinant(occupied(0, i), occupied(1, i)) for i in range(n)]
+
+
+def filter_connected(ref, block, n):
+    """Indices of the singles and of the doubles of ref among the first n determinants of
+    `block`, found by the native SIMD filter over the array in place"""
+    n_words = block.shape[1]
+    ref_words = np.zeros((2, n_words, 1), dtype=np.uint64)
+    set_det(ref_words, 0, ref)
+    degree = np.empty(n, dtype=np.int8)
+    if psi_block_lib.psi_block_filter_connected(
+        n_words, ref_words, block, n, block.shape[2], degree
+    ):
+        raise ValueError("psi_block: invalid block")
+    return np.flatnonzero(degree == 1), np.flatnonzero(degree == 2)
@@ -0,0 +1,262 @@
+#if !defined(DOCTEST_CONFIG_DISABLE)
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#endif
+#include "chunking.h"
+#include <doctest/doctest.h>
+#include <iostream>
+#include <set>
+#include <stdexcept>
+
+namespace {
+
+/*
+Call f(ijkl) for the integrals of category c in the order of JChunkFactory.<c>_idx_iter, i.e. over
+the increasing combinations of 1 to 4 orbitals, until f returns false
+*/
+template <class F> void for_each_category_idx(const j_category c, const idx_t n, F &&f) {
+    switch (c) {
+    case IC_A:
+        for (idx_t i = 0; i < n; i++)
+            if (!f(compound_idx4(i, i, i, i)))
+                return;
+        return;
+    case IC_B:
+    case IC_D:
+    case IC_F:
+        for (idx_t i = 0; i < n; i++)
+            for (idx_t j = i + 1; j < n; j++) {
+                if (c == IC_B && !f(compound_idx4(i, j, i, j)))
+                    return;
+                if (c == IC_D && !(f(compound_idx4(i, i, i, j)) && f(compound_idx4(i, j, j, j))))
+                    return;
+                if (c == IC_F && !f(compound_idx4(i, i, j, j)))
+                    return;
+            }
+        return;
+    case IC_C:
+    case IC_E:
+        for (idx_t i = 0; i < n; i++)
+            for (idx_t j = i + 1; j < n; j++)
+                for (idx_t k = j + 1; k < n; k++) {
+                    if (c == IC_C &&
+                        !(f(compound_idx4(i, j, i, k)) && f(compound_idx4(i, k, j, k)) &&
+                          f(compound_idx4(j, i, j, k))))
+                        return;
+                    if (c == IC_E &&
+                        !(f(compound_idx4(i, i, j, k)) && f(compound_idx4(i, j, j, k)) &&
+                          f(compound_idx4(i, j, k, k))))
+                        return;
+                }
+        return;
+    case IC_G:
+        for (idx_t i = 0; i < n; i++)
+            for (idx_t j = i + 1; j < n; j++)
+                for (idx_t k = j + 1; k < n; k++)
+                    for (idx_t l = k + 1; l < n; l++)
+                        if (!(f(compound_idx4(i, j, k, l)) && f(compound_idx4(i, k, j, l)) &&
+                              f(compound_idx4(j, i, k, l))))
+                            return;
+        return;
+    }
+}
+
+} // namespace
+
+idx_t category_size(const j_category c, const idx_t n_orb) {
+    const idx_t n = n_orb;
+    const idx_t pairs = n * (n - 1) / 2, triples = pairs * (n - 2) / 3,
+                quadruples = triples * (n - 3) / 4;
+    switch (c) {
+    case IC_A:
+        return n;
+    case IC_B:
+    case IC_F:
+        return pairs;
+    case IC_C:
+    case IC_E:
+        return 3 * triples;
+    case IC_D:
+        return 2 * pairs;
+    case IC_G:
+        return 3 * quadruples;
+    }
+    return 0;
+}
+
+JChunkFactory::JChunkFactory(const idx_t N_orb, const j_category category, const idx_t chunk_size,
+                             const idx_t rank, const idx_t n_ranks,
+                             const chunk_distribution_t distribution)
+    : m_N_orb(N_orb), m_category(category), m_chunk_size(chunk_size), m_rank(rank),
+      m_n_ranks(n_ranks), m_distribution(distribution) {
+    if (N_orb < 0 || category < IC_A || category > IC_G || n_ranks < 1 || rank < 0 ||
+        rank >= n_ranks ||
+        (distribution != CHUNK_ROUND_ROBIN && distribution != CHUNK_CONTIGUOUS))
+        throw std::invalid_argument("JChunkFactory: invalid arguments");
+    m_total = category_size(category, N_orb);
+    m_batch = chunk_size < 1 ? 1 : chunk_size;
+}
+
+idx_t JChunkFactory::first_batch(const idx_t rank) const {
+    const idx_t n = n_batches();
+    return n / m_n_ranks * rank + std::min(rank, n % m_n_ranks);
+}
+
+bool JChunkFactory::owns_batch(const idx_t b) const {
+    if (m_distribution == CHUNK_ROUND_ROBIN)
+        return b % m_n_ranks == m_rank;
+    return b >= first_batch(m_rank) && b < first_batch(m_rank + 1);
+}
+
+idx_t JChunkFactory::size() const {
+    const idx_t n = n_batches();
+    if (!n)
+        return 0;
+    const idx_t owned = m_distribution == CHUNK_ROUND_ROBIN
+                            ? n / m_n_ranks + (m_rank < n % m_n_ranks)
+                            : first_batch(m_rank + 1) - first_batch(m_rank);
+    // the last batch may be short
+    return owned * m_batch - (owns_batch(n - 1) ? n * m_batch - m_total : 0);
+}
+
+idx_t JChunkFactory::n_chunks() const {
+    if (m_chunk_size < 1)
+        return 1;
+    return m_distribution == CHUNK_ROUND_ROBIN
+               ? n_batches() / m_n_ranks + (m_rank < n_batches() % m_n_ranks)
+               : first_batch(m_rank + 1) - first_batch(m_rank);
+}
+
+void JChunkFactory::indices(idx_t *J_ind, idx_t *offsets) const {
+    const bool batched = m_chunk_size >= 1;
+    const idx_t last = m_distribution == CHUNK_CONTIGUOUS ? first_batch(m_rank + 1) * m_batch
+                                                          : m_total;
+    idx_t p = 0, n = 0, c = 0;
+    offsets[0] = 0;
+    for_each_category_idx(m_category, m_N_orb, [&](const idx_t ijkl) {
+        const bool owned = owns_batch(p++ / m_batch);
+        if (owned)
+            J_ind[n++] = ijkl;
+        // end of an owned batch, or of the category
+        if (owned && batched && (p % m_batch == 0 || p == m_total))
+            offsets[++c] = n;
+        return p < last;
+    });
+    if (!batched)
+        offsets[1] = n;
+}
+
+extern "C" idx_t jchunk_factory_size(const idx_t N_orb, const int category,
+                                     const idx_t chunk_size, const idx_t rank,
+                                     const idx_t n_ranks, const int distribution,
+                                     idx_t *n_chunks) {
+    try {
+        const JChunkFactory f(N_orb, (j_category)category, chunk_size, rank, n_ranks,
+                              (chunk_distribution_t)distribution);
+        *n_chunks = f.n_chunks();
+        return f.size();
+    } catch (const std::exception &e) {
+        std::cerr << e.what() << '\n';
+        return -1;
+    }
+}
+
+extern "C" int jchunk_factory_fill(const idx_t N_orb, const int category, const idx_t chunk_size,
+                                   const idx_t rank, const idx_t n_ranks, const int distribution,
+                                   const idx_t *src_idx, const double *src_val, const idx_t src_n,
+                                   idx_t *J_ind, double *J, idx_t *offsets) {
+    try {
+        const JChunkFactory f(N_orb, (j_category)category, chunk_size, rank, n_ranks,
+                              (chunk_distribution_t)distribution);
+        f.indices(J_ind, offsets);
+        if (src_val)
+            JChunkFactory::fill_values(J_ind, f.size(), src_idx, src_val, src_n, J);
+        else
+            std::fill(J, J + f.size(), 0.);
+        return 0;
+    } catch (const std::exception &e) {
+        std::cerr << e.what() << '\n';
+        return -1;
+    }
+}
+
+TEST_CASE("testing category_size") {
+    for (idx_t n_orb = 0; n_orb < 9; n_orb++) {
+        idx_t count[N_CATEGORIES] = {};
+        for (idx_t ijkl = 0; ijkl < compound_idx4(n_orb, 0, 0, 0); ijkl++)
+            count[category_idx4(idx4_reverse(ijkl))]++;
+        for (int c = 0; c < N_CATEGORIES; c++)
+            CHECK(category_size((j_category)c, n_orb) == count[c]);
+    }
+}
+
+TEST_CASE("testing JChunkFactory") {
+    const idx_t n_orb = 9;
+    for (int c = 0; c < N_CATEGORIES; c++) {
+        const auto category = (j_category)c;
+        const idx_t n = category_size(category, n_orb);
+
+        // a single worker gets every index of the category once
+        const JChunkFactory all(n_orb, category);
+        REQUIRE(all.size() == n);
+        REQUIRE(all.n_chunks() == 1);
+        std::vector<idx_t> J_ind(n), offsets(2);
+        all.indices(J_ind.data(), offsets.data());
+        CHECK(offsets[1] == n);
+        const std::set<idx_t> unique(J_ind.begin(), J_ind.end());
+        CHECK((idx_t)unique.size() == n);
+        for (const idx_t ijkl : J_ind)
+            REQUIRE(category_idx4(idx4_reverse(ijkl)) == category);
+
+        // values from sorted arrays listing every other index of the category
+        std::vector<idx_t> sparse_idx;
+        std::vector<double> sparse_val;
+        idx_t count = 0;
+        for (const idx_t ijkl : unique)
+            if (count++ % 2 == 0) {
+                sparse_idx.push_back(ijkl);
+                sparse_val.push_back(ijkl + 0.5);
+            }
+
+        for (const auto distribution : {CHUNK_ROUND_ROBIN, CHUNK_CONTIGUOUS})
+            for (const idx_t chunk_size : {-1, 1, 7, 64})
+                for (const idx_t n_ranks : {1, 3, 8}) {
+                    // the workers partition the stream, in order within each chunk
+                    std::vector<std::pair<idx_t, idx_t>> seen; // (stream position, rank)
+                    for (idx_t rank = 0; rank < n_ranks; rank++) {
+                        const JChunkFactory f(n_orb, category, chunk_size, rank, n_ranks,
+                                              distribution);
+                        const auto chunks =
+                            f.get_chunks(sparse_idx.data(), sparse_val.data(), sparse_idx.size());
+                        REQUIRE((idx_t)chunks.size() == f.n_chunks());
+                        idx_t size = 0;
+                        for (const auto &chunk : chunks) {
+                            CHECK(chunk.category == category);
+                            if (chunk_size >= 1)
+                                CHECK(chunk.size() <= chunk_size);
+                            for (idx_t p = 0; p < chunk.size(); p++) {
+                                const idx_t pos = std::find(J_ind.begin(), J_ind.end(),
+                                                            chunk.J_ind[p]) -
+                                                  J_ind.begin();
+                                seen.push_back({pos, rank});
+                                const bool listed = std::binary_search(
+                                    sparse_idx.begin(), sparse_idx.end(), chunk.J_ind[p]);
+                                REQUIRE(chunk.J[p] == (listed ? chunk.J_ind[p] + 0.5 : 0.));
+                            }
+                            size += chunk.size();
+                        }
+                        CHECK(size == f.size());
+                    }
+                    std::sort(seen.begin(), seen.end());
+                    REQUIRE((idx_t)seen.size() == n);
+                    const idx_t batch = chunk_size < 1 ? 1 : chunk_size;
+                    for (idx_t p = 0; p < n; p++) {
+                        REQUIRE(seen[p].first == p);
+                        if (distribution == CHUNK_ROUND_ROBIN)
+                            REQUIRE(seen[p].second == p / batch % n_ranks);
+                        else if (p)
+                            REQUIRE(seen[p].second >= seen[p - 1].second);
+                    }
+                }
+    }
+    CHECK_THROWS_AS(JChunkFactory(n_orb, IC_G, -1, 2, 2), std::invalid_argument);
+}
@@ -4,14 +4,6 @@
 #include <determinant.h>
 #include <doctest/doctest.h>
 
-int compute_phase_single_excitation(spin_det_t d, uint64_t h, uint64_t p) {
-    const auto &[i, j] = std::minmax(h, p);
-    spin_det_t hpmask(d.size());
-    hpmask.set(i + 1, j - i - 1, 1);
-    const bool parity = (hpmask & d).count() % 2;
-    return parity ? -1 : 1;
-}
-
 TEST_CASE("testing get_phase_single") {
     CHECK(compute_phase_single_excitation(spin_det_t{"11000"}, 4, 2) == -1);
     CHECK(compute_phase_single_excitation(spin_det_t{"10001"}, 4, 2) == 1);
@@ -19,46 +11,181 @@ TEST_CASE("testing get_phase_single") {
     CHECK(compute_phase_single_excitation(spin_det_t{"00100"}, 2, 4) == 1);
 }
 
-int compute_phase_double_excitation(spin_det_t d, uint64_t h1, uint64_t h2, uint_64_t p1,
-                                    uint_64_t p2) {
-    // Single spin channel excitations, i.e., (2,0) or (0,2)
-    int phase =
-        compute_phase_single_excitation(d, h1, p1) * compute_phase_single_excitation(d, h2, p2);
-    phase = (h2 < p1) ? phase * -1 : phase;
-    phase = (p2 < h1) ? phase * -1 : phase;
-    return phase;
+TEST_CASE("testing get_phase_single across blocks") {
+    // Compare against a bit-by-bit count for excitations spanning several blocks
+    const std::size_t n_orb = 200;
+    spin_det_t d(n_orb);
+    static_spin_det_t<4> s;
+    for (std::size_t i = 0; i < n_orb; i += 3) {
+        d[i] = 1;
+        s[i] = 1;
+    }
+    for (uint64_t h : {0, 3, 63, 64, 129, 198}) {
+        for (uint64_t p : {1, 2, 62, 65, 128, 130, 199}) {
+            std::size_t n = 0;
+            for (auto k = std::min(h, p) + 1; k < std::max(h, p); k++)
+                n += d[k];
+            const int expected = (n % 2) ? -1 : 1;
+            CHECK(compute_phase_single_excitation(d, h, p) == expected);
+            CHECK(compute_phase_single_excitation(s, h, p) == expected);
+        }
+    }
+
+    const uint64_t h[3] = {0, 63, 198};
+    const uint64_t p[3] = {62, 130, 1};
+    int phases[3];
+    compute_phase_single_excitations(s, h, p, 3, phases);
+    for (int k = 0; k < 3; k++)
+        CHECK(phases[k] == compute_phase_single_excitation(d, h[k], p[k]));
+}
+
+TEST_CASE("testing get_phase_double") {
+    // (2,0): |0 1 2 3 4> with 0,1 occupied, 0,1 -> 3,4
+    const spin_det_t d{"00011"};
+    CHECK(compute_phase_double_excitation(d, 0, 1, 3, 4) ==
+          compute_phase_single_excitation(d, 0, 3) *
+              compute_phase_single_excitation(spin_det_t{"01010"}, 1, 4));
+    // (1,1)
+    const det_t dd{spin_det_t{"01100"}, spin_det_t{"00101"}};
+    CHECK(compute_phase_double_excitation(dd, 2, 0, 4, 1) ==
+          compute_phase_single_excitation(dd[0], 2, 4) *
+              compute_phase_single_excitation(dd[1], 0, 1));
 }
 
-int compute_phase_double_excitation(det_t d, uint64_t h1, uint64_t h2, uint_64_t p1, uint_64_t p2) {
+TEST_CASE("testing phase masks") {
+    CHECK(get_phase_mask(spin_det_t{"0100110"}) == spin_det_t{"1100010"});
+    CHECK(get_phase_mask(static_spin_det_t<2>{"1"}).count() == 128);
 
-    // Cross channel excitations, i.e., (1,1)
-    // Assumes alpha are h1-p1, beta are h2-p2
-    int phase = compute_phase_single_excitation(d[0], h1, p1) *
-                compute_phase_single_excitation(d[1], h2, p2);
-    return phase;
+    // The O(1) mask phases agree with the popcount phases, including across blocks
+    const std::size_t n_orb = 150;
+    det_t d{spin_det_t(n_orb), spin_det_t(n_orb)};
+    for (std::size_t i = 0; i < n_orb; i++) {
+        d.alpha[i] = (i % 3 == 0);
+        d.beta[i] = (i % 5 < 2);
+    }
+    const phase_mask_t<spin_det_t> m(d);
+    for (uint64_t h : {0, 3, 63, 64, 129}) {
+        for (uint64_t p : {1, 2, 62, 65, 128, 149}) {
+            CHECK(compute_phase_single_excitation(m, 0, h, p) ==
+                  compute_phase_single_excitation(d.alpha, h, p));
+            CHECK(compute_phase_single_excitation(m, 1, h, p) ==
+                  compute_phase_single_excitation(d.beta, h, p));
+            CHECK(compute_phase_double_excitation(m, h, p, p, h) ==
+                  compute_phase_double_excitation(d, h, p, p, h));
+            CHECK(compute_phase_double_excitation(m, 1, h, 148, p, 147) ==
+                  compute_phase_double_excitation(d.beta, h, 148, p, 147));
+        }
+    }
+
+    std::vector<det_t> psi{d, det_t{d.beta, d.alpha}};
+    phase_mask_cache_t<spin_det_t> cache(psi.data(), psi.size());
+    CHECK(cache[1].alpha == m.beta);
+    CHECK(cache[0].beta == m.beta);
 }
 
-det_t exc_det(det_t &a, det_t &b) {
-    spin_det_t alpha = a[0] ^ b[0];
-    spin_det_t beta = a[1] ^ b[1];
-    return det_t(alpha, beta);
+TEST_CASE("testing static_spin_det_t") {
+    static_spin_det_t<2> d{"11000"};
+    CHECK(d.count() == 2);
+    CHECK(d.find_first() == 3);
+    CHECK(d.find_next(3) == 4);
+    CHECK(d.find_next(4) == d.npos);
+    d[100] = 1;
+    CHECK(d.find_next(4) == 100);
+    CHECK((d ^ static_spin_det_t<2>{"01000"}) == static_spin_det_t<2>{"10000"}.set(100));
+    CHECK(static_spin_det_t<2>{"01000"}.is_subset_of(d));
+    CHECK(static_spin_det_t<2>{"01000"} < static_spin_det_t<2>{"10000"});
+
+    CHECK(compute_phase_single_excitation(static_spin_det_t<1>{"11000"}, 4, 2) == -1);
+    CHECK(compute_phase_single_excitation(static_spin_det_t<1>{"10001"}, 4, 2) == 1);
+
+    static_det_t<1> s{static_spin_det_t<1>{"11000"}, static_spin_det_t<1>{"00001"}};
+    CHECK(apply_single_excitation(s, 0, 4, 1) ==
+          static_det_t<1>{static_spin_det_t<1>{"01010"}, static_spin_det_t<1>{"00001"}});
+}
+
+TEST_CASE("testing det_t hash") {
+    det_t a{spin_det_t{"11000"}, spin_det_t{"00011"}};
+    det_t b{spin_det_t{"00011"}, spin_det_t{"11000"}};
+    CHECK(std::hash<det_t>{}(a) == std::hash<det_t>{}(det_t{a}));
+    CHECK(std::hash<det_t>{}(a) != std::hash<det_t>{}(b));
+    CHECK(std::hash<spin_det_t>{}(a.alpha) != std::hash<spin_det_t>{}(a.beta));
+
+    // Only the blocks are hashed, so equal-width spin types agree
+    static_spin_det_t<1> s{"11000"};
+    CHECK(std::hash<static_spin_det_t<1>>{}(s) == std::hash<spin_det_t>{}(a.alpha));
 }
 
-det_t apply_single_excitation(det_t s, int spin, uint64_t h, uint64_t p) {
+TEST_CASE("testing dispatch_n_orb") {
+    auto n_words = [](std::size_t n_orb) {
+        return dispatch_n_orb(n_orb, [](auto tag) {
+            using D = typename decltype(tag)::type;
+            return D{}.alpha.num_blocks();
+        });
+    };
+    CHECK(n_words(64) == 1);
+    CHECK(n_words(100) == 2);
+    CHECK(n_words(256) == 4);
+    CHECK(n_words(512) == 8);
+    CHECK(n_words(513) == 0); // heap-backed det_t, default constructed empty
+}
+
+template <class spin_det_type>
+det_base_t<spin_det_type> exc_det(const det_base_t<spin_det_type> &a,
+                                  const det_base_t<spin_det_type> &b) {
+    spin_det_type alpha = a[0] ^ b[0];
+    spin_det_type beta = a[1] ^ b[1];
+    return det_base_t<spin_det_type>(alpha, beta);
+}
+
+TEST_CASE("testing get_excitation_info") {
+    const det_t d{spin_det_t{"00110011"}, spin_det_t{"00000111"}};
+    CHECK(d.exc_degree(d) == std::array<int, 2>{0, 0});
+
+    // (1,1): alpha 1 -> 6, beta 2 -> 3
+    const auto e = apply_double_excitation(d, {0, 1}, 1, 2, 6, 3);
+    auto exc = get_excitation_info(d, e);
+    CHECK(exc.degree == std::array<int, 2>{1, 1});
+    CHECK(exc.holes[0][0] == 1);
+    CHECK(exc.parts[0][0] == 6);
+    CHECK(exc.holes[1][0] == 2);
+    CHECK(exc.parts[1][0] == 3);
+    CHECK(exc.involves(0, 6));
+    CHECK(!exc.involves(0, 3));
+    CHECK(d.exc_degree(e) == exc.degree);
+
+    // (2,0) across blocks, holes and particles in increasing order
+    static_det_t<2> s{static_spin_det_t<2>{"1011"}, static_spin_det_t<2>{"1"}};
+    auto t = s;
+    t.alpha.set(0, false).set(3, false).set(70).set(127);
+    exc = get_excitation_info(s, t);
+    CHECK(exc.degree == std::array<int, 2>{2, 0});
+    CHECK(exc.holes[0] == std::array<uint64_t, 2>{0, 3});
+    CHECK(exc.parts[0] == std::array<uint64_t, 2>{70, 127});
+
+    // more than two excited orbitals: stops early
+    t.beta.set(0, false).set(1);
+    CHECK(get_excitation_info(s, t).order() > 2);
+    CHECK(get_excitation_info(d, det_t{d.beta, d.alpha}).order() > 2);
+}
+
+template <class spin_det_type>
+det_base_t<spin_det_type> apply_single_excitation(const det_base_t<spin_det_type> &s, int spin,
+                                                  uint64_t h, uint64_t p) {
     assert(s[spin][h] == 1);
     assert(s[spin][p] == 0);
 
-    auto s2 = det_t{s};
+    auto s2 = det_base_t<spin_det_type>{s};
     s2[spin][h] = 0;
     s2[spin][p] = 1;
     return s2;
 }
 
-spin_det_t apply_single_excitation(spin_det_t s, int spin, uint64_t h, uint64_t p) {
+template <class spin_det_type>
+spin_det_type apply_spin_single_excitation(const spin_det_type &s, uint64_t h, uint64_t p) {
     assert(s[h] == 1);
     assert(s[p] == 0);
 
-    auto s2 = spin_det_t{s};
+    auto s2 = spin_det_type{s};
     s2[h] = 0;
     s2[p] = 1;
     return s2;
@@ -70,46 +197,50 @@ TEST_CASE("testing apply_single_excitation") {
     CHECK(apply_single_excitation(s, 1, 0, 1) == det_t{spin_det_t{"11000"}, spin_det_t{"00010"}});
 }
 
-det_t apply_double_excitation(det_t s, std::pair<int> spin, uint64_t h1, uint64_t h2, uint64_t p1,
-                              uint64_t p2) {
+template <class spin_det_type>
+det_base_t<spin_det_type> apply_double_excitation(const det_base_t<spin_det_type> &s,
+                                                  std::pair<int, int> spin, uint64_t h1,
+                                                  uint64_t h2, uint64_t p1, uint64_t p2) {
     // Check if valid
     assert(s[spin.first][h1] == 1);
     assert(s[spin.second][h2] == 1);
     assert(s[spin.first][p1] == 0);
     assert(s[spin.second][p2] == 0);
 
-    auto s2 = det_t{s};
-    s[spin.first][h1] = 0;
-    s[spin.second][h2] = 0;
-    s[spin.first][p1] = 1;
-    s[spin.second][p2] = 1;
+    auto s2 = det_base_t<spin_det_type>{s};
+    s2[spin.first][h1] = 0;
+    s2[spin.second][h2] = 0;
+    s2[spin.first][p1] = 1;
+    s2[spin.second][p2] = 1;
     return s2;
 }
 
 TEST_CASE("testing apply_double_excitation") {
-    det_t s{spin_det_t{"11000000"}, spin_det_t{"10001000"}};
-    CHECK(apply_double_excitation(s, std::pair<int>{0, 0}, 0, 1, 4, 5) ==
-          det_t(spin_det_t{"00001100"}, spin_det_t{"10001000"}));
-    CHECK(apply_double_excitation(s, std::pair<int>{1, 1}, 0, 4, 1, 7) ==
-          det_t(spin_det_t{"11000000"}, spin_det_t{"01000001"}));
-    CHECK(apply_double_excitation(s, std::pair<int>{0, 1}, 1, 0, 2, 2) ==
-          det_t(spin_det_t{"10100000"}, spin_det_t{"00101000"}));
-}
-
-std::vector<det_t> get_singles_by_exc_mask(det_t d, int spin, spin_constraint_t h,
-                                           spin_constraint_t p) {
-    std::vector<det_t> res;
-    for (auto &i : h) {
-        for (auto &j : p) {
-            res.push_back(apply_single_excitation(d, spin, i, j));
-        }
-    }
+    // bit 0 is the rightmost character, as for apply_single_excitation
+    det_t s{spin_det_t{"00000011"}, spin_det_t{"00010001"}};
+    CHECK(apply_double_excitation(s, std::pair<int, int>{0, 0}, 0, 1, 4, 5) ==
+          det_t(spin_det_t{"00110000"}, spin_det_t{"00010001"}));
+    CHECK(apply_double_excitation(s, std::pair<int, int>{1, 1}, 0, 4, 1, 7) ==
+          det_t(spin_det_t{"00000011"}, spin_det_t{"10000010"}));
+    CHECK(apply_double_excitation(s, std::pair<int, int>{0, 1}, 1, 0, 2, 2) ==
+          det_t(spin_det_t{"00000101"}, spin_det_t{"00010100"}));
+}
+
+template <class spin_det_type>
+std::vector<det_base_t<spin_det_type>> get_singles_by_exc_mask(const det_base_t<spin_det_type> &d,
+                                                               int spin, const spin_constraint_t &h,
+                                                               const spin_constraint_t &p) {
+    std::vector<det_base_t<spin_det_type>> res(n_singles_by_exc_mask(h.size(), p.size()));
+    generate_singles_into(d, spin, h, p, res.data());
     return res;
 }
 
-std::vector<spin_det_t> get_spin_singles_by_exc_mask(spin_det_t d, spin_constraint_t h,
-                                                     spin_constraint_t p) {
-    std::vector<spin_det_t> res;
+template <class spin_det_type>
+std::vector<spin_det_type> get_spin_singles_by_exc_mask(const spin_det_type &d,
+                                                        const spin_constraint_t &h,
+                                                        const spin_constraint_t &p) {
+    std::vector<spin_det_type> res;
+    res.reserve(n_singles_by_exc_mask(h.size(), p.size()));
     for (auto &i : h) {
         for (auto &j : p) {
             res.push_back(apply_spin_single_excitation(d, i, j));
@@ -118,135 +249,311 @@ std::vector<spin_det_t> get_spin_singles_by_exc_mask(spin_det_t d, spin_constrai
     return res;
 }
 
-std::vector<det_t> get_ss_doubles_by_exc_mask(det_t d, int spin, spin_constraint_t h,
-                                              spin_constraint_t p) {
-
-    std::vector<det_t> res;
-    // h, p are sorted so h1 < h2; p1 < p2 always
-    for (auto h1 = 0; h1 < h.size() - 1; h1++) {
-        for (auto h2 = h1 + 1; h2 < h.size(); h2++) {
-            for (auto p1 = 0; p1 < p.size() - 1; p1++) {
-                for (auto p2 = p1 + 1; p2 < p.size(); p2++) {
-                    res.push_back(
-                        apply_double_excitation(d, std::pair<int>(spin, spin), h1, h2, p1, p2));
-                }
-            }
-        }
-    }
+template <class spin_det_type>
+std::vector<det_base_t<spin_det_type>>
+get_ss_doubles_by_exc_mask(const det_base_t<spin_det_type> &d, int spin, const spin_constraint_t &h,
+                           const spin_constraint_t &p) {
+    std::vector<det_base_t<spin_det_type>> res(n_ss_doubles_by_exc_mask(h.size(), p.size()));
+    generate_ss_doubles_into(d, spin, h, p, res.data());
     return res;
 }
 
-std::vector<det_t> get_constrained_singles(det_t d, exc_constraint_t constraint, uint64_t max_orb) {
-    std::vector<det_t> singles;
+TEST_CASE("testing generate_*_into") {
+    const det_t d{spin_det_t{"000111"}, spin_det_t{"000011"}};
+    const spin_constraint_t h{0, 2}, p{3, 4, 5};
+
+    std::vector<det_t> out(n_singles_by_exc_mask(h.size(), p.size()));
+    CHECK(generate_singles_into(d, 0, h, p, out.data()) == 6);
+    CHECK(out[0] == apply_single_excitation(d, 0, 0, 3));
+    CHECK(out[5] == apply_single_excitation(d, 0, 2, 5));
+
+    CHECK(n_ss_doubles_by_exc_mask(h.size(), p.size()) == 3);
+    CHECK(n_ss_doubles_by_exc_mask(1, p.size()) == 0);
+    out.resize(3);
+    CHECK(generate_ss_doubles_into(d, 0, h, p, out.data()) == 3);
+    CHECK(out[2] == apply_double_excitation(d, {0, 0}, 0, 2, 4, 5));
+
+    const spin_constraint_t h_b{1}, p_b{2, 3};
+    det_arena_t<static_spin_det_t<1>> arena;
+    const static_det_t<1> sd{static_spin_det_t<1>{"000111"}, static_spin_det_t<1>{"000011"}};
+    auto *buf = arena.reserve(n_singles_by_exc_mask(h.size(), p.size()) *
+                              n_singles_by_exc_mask(h_b.size(), p_b.size()));
+    CHECK(generate_os_doubles_into(sd, h, p, h_b, p_b, buf) == 12);
+    CHECK(buf[11] == apply_double_excitation(sd, {0, 1}, 2, 1, 5, 3));
+    CHECK(arena.reserve(4) == buf);
+}
+
+TEST_CASE("testing excitation_generator_t") {
+    const det_t d{spin_det_t{"000111"}, spin_det_t{"000011"}};
+    exc_lists_t<spin_det_t> lists;
+    lists.holes = {spin_constraint_t{0, 1, 2}, spin_constraint_t{0, 1}};
+    lists.parts = {spin_constraint_t{3, 4, 5}, spin_constraint_t{2, 5}};
+
+    // Same excitations, in the same order, as the eager generators
+    std::vector<det_t> expected;
+    auto append = [&](auto n, auto f) {
+        const auto n0 = expected.size();
+        expected.resize(n0 + n);
+        f(expected.data() + n0);
+    };
+    for (int spin = 0; spin < N_SPIN_SPECIES; spin++)
+        append(n_singles_by_exc_mask(lists.holes[spin].size(), lists.parts[spin].size()),
+               [&](det_t *out) {
+                   generate_singles_into(d, spin, lists.holes[spin], lists.parts[spin], out);
+               });
+    for (int spin = 0; spin < N_SPIN_SPECIES; spin++)
+        append(n_ss_doubles_by_exc_mask(lists.holes[spin].size(), lists.parts[spin].size()),
+               [&](det_t *out) {
+                   generate_ss_doubles_into(d, spin, lists.holes[spin], lists.parts[spin], out);
+               });
+    append(9 * 4, [&](det_t *out) {
+        generate_os_doubles_into(d, lists.holes[0], lists.parts[0], lists.holes[1],
+                                 lists.parts[1], out);
+    });
+
+    excitation_generator_t<spin_det_t> gen(d, lists);
+    CHECK(gen.size() == expected.size());
+
+    std::vector<det_t> streamed, block(7);
+    while (auto n = gen.next_block(block.data(), block.size()))
+        streamed.insert(streamed.end(), block.begin(), block.begin() + n);
+    CHECK(streamed == expected);
+
+    gen.reset();
+    det_t e;
+    CHECK(gen.next(e));
+    CHECK(e == expected[0]);
+
+    // Disabled kinds and empty lists are skipped
+    lists.holes[1].clear();
+    excitation_generator_t<spin_det_t> os_only(d, lists,
+                                               excitation_generator_t<spin_det_t>::EXC_OS_DOUBLES);
+    CHECK(os_only.size() == 0);
+    CHECK(!os_only.next(e));
+}
 
-    // convert constraints to bit masks
-    // TODO: test if faster to create empty bit mask and set bits
-    spin_det_t hole_mask(to_string(constraint.first, max_orb)); // where holes can be created
-    spin_det_t part_mask(to_string(constraint.second,
-                                   max_orb)); // where particles can be created
+TEST_CASE("testing get_constrained_exc_lists") {
+    CHECK(to_constraint(spin_det_t{"1010011"}) == spin_constraint_t{0, 1, 4, 6});
+
+    // holes: occupied orbitals of the hole mask; particles: virtual orbitals of the particle mask
+    const exc_constraint_t constraint{{0, 2, 5, 70, 130}, {1, 3, 4, 69, 70, 129}};
+    const static_det_t<4> sd{static_spin_det_t<4>{"0000100111"}, static_spin_det_t<4>{"000011"}};
+    auto lists = get_constrained_exc_lists(sd, constraint, 130);
+    CHECK(std::vector<uint64_t>(lists.holes[0].begin(), lists.holes[0].end()) ==
+          spin_constraint_t{0, 2, 5});
+    CHECK(std::vector<uint64_t>(lists.parts[0].begin(), lists.parts[0].end()) ==
+          spin_constraint_t{3, 4, 69, 70, 129});
+    CHECK(std::vector<uint64_t>(lists.holes[1].begin(), lists.holes[1].end()) ==
+          spin_constraint_t{0});
+    CHECK(lists.parts[1].size() == 5);
+
+    // same lists for the heap-backed spin type
+    const det_t d{spin_det_t(130, 0b100111), spin_det_t(130, 0b11)};
+    const auto dyn = get_constrained_exc_lists(d, constraint, 130);
+    CHECK(dyn.holes[0] == spin_constraint_t{0, 2, 5});
+    CHECK(dyn.parts[0] == spin_constraint_t{3, 4, 69, 70, 129});
+    CHECK(get_constrained_singles(d, constraint, 130).size() == 3 * 5 + 1 * 5);
+
+    CHECK(get_all_singles(sd, 10).size() == 4 * 6 + 2 * 8);
+}
 
-    // convert max orb to bit masks
-    // TODO: as above, test if faster to create empty bit mask, now with
-    // reserved size, and set bits
-    spin_det_t max_orb_mask(std::string(max_orb, '1'));
+template <class spin_det_type>
+exc_lists_t<spin_det_type> get_constrained_exc_lists(const det_base_t<spin_det_type> &d,
+                                                     const exc_constraint_t &constraint,
+                                                     uint64_t max_orb) {
+    // where holes and particles can be created
+    const auto hole_mask = to_constraint_mask(d[0], constraint.first, max_orb);
+    const auto part_mask = to_constraint_mask(d[0], constraint.second, max_orb);
+
+    // holes are occupied orbitals of the hole mask, particles virtual orbitals of the particle
+    // mask; both are clipped to max_orb word by word
+    exc_lists_t<spin_det_type> lists;
+    for (int spin = 0; spin < N_SPIN_SPECIES; spin++) {
+        extract_orbitals(d[spin], hole_mask, true, max_orb, lists.holes[spin]);
+        extract_orbitals(d[spin], part_mask, false, max_orb, lists.parts[spin]);
+    }
 
-    // apply bit masks and get final list
-    spin_constraint_t alpha_holes = to_constraint((~d[0] & hole_mask) & max_orb_mask);
-    spin_constraint_t alpha_parts = to_constraint((d[0] & part_mask) & max_orb_mask);
+    return lists;
+}
 
-    spin_constraint_t beta_holes = to_constraint((~d[1] & hole_mask) & max_orb_mask);
-    spin_constraint_t beta_parts = to_constraint((d[1] & part_mask) & max_orb_mask);
+template <class spin_det_type>
+std::vector<det_base_t<spin_det_type>>
+get_constrained_singles(const det_base_t<spin_det_type> &d, const exc_constraint_t &constraint,
+                        uint64_t max_orb) {
+    const auto lists = get_constrained_exc_lists(d, constraint, max_orb);
+    const auto &[alpha_holes, beta_holes] = lists.holes;
+    const auto &[alpha_parts, beta_parts] = lists.parts;
 
     // at this point, hole and particle bitsets are guaranteed to be disjoint
-    // iterate over product list and add to return vector
-    std::vector<det_t> alpha_singles = get_singles_by_exc_mask(d, 0, alpha_holes, alpha_parts);
-    std::vector<det_t> beta_singles = get_singles_by_exc_mask(d, 1, beta_holes, beta_parts);
-    singles.insert(singles.end(), alpha_singles.begin(), alpha_singles.end());
-    singles.insert(singles.end(), beta_singles.begin(), beta_singles.end());
+    // size the result once and generate both spins directly into it
+    const auto n_alpha = n_singles_by_exc_mask(alpha_holes.size(), alpha_parts.size());
+    const auto n_beta = n_singles_by_exc_mask(beta_holes.size(), beta_parts.size());
+    std::vector<det_base_t<spin_det_type>> singles(n_alpha + n_beta);
+    generate_singles_into(d, 0, alpha_holes, alpha_parts, singles.data());
+    generate_singles_into(d, 1, beta_holes, beta_parts, singles.data() + n_alpha);
 
     return singles;
 }
 
-std::vector<det_t> get_all_singles(det_t d) {
+template <class spin_det_type>
+std::vector<det_base_t<spin_det_type>> get_all_singles(const det_base_t<spin_det_type> &d,
+                                                       uint64_t max_orb) {
+    spin_constraint_t all(max_orb);
+    for (uint64_t i = 0; i < max_orb; i++)
+        all[i] = i;
+    return get_constrained_singles(d, {all, all}, max_orb);
+}
 
-    std::vector<det_t> singles;
-    std::vector<det_t> alpha_singles =
-        get_singles_by_exc_mask(d, 0, to_constraint(~d[0]), to_constraint(d[0]));
-    std::vector<det_t> beta_singles =
-        get_singles_by_exc_mask(d, 1, to_constraint(~d[1]), to_constraint(d[1]));
-    singles.insert(singles.end(), alpha_singles.begin(), alpha_singles.end());
-    singles.insert(singles.end(), beta_singles.begin(), beta_singles.end());
+template <class spin_det_type>
+std::vector<det_base_t<spin_det_type>>
+get_constrained_os_doubles(const det_base_t<spin_det_type> &d, const exc_constraint_t &constraint,
+                           uint64_t max_orb) {
+    const auto lists = get_constrained_exc_lists(d, constraint, max_orb);
+    const auto &[alpha_holes, beta_holes] = lists.holes;
+    const auto &[alpha_parts, beta_parts] = lists.parts;
+
+    // product of (1,0) X (0,1) to get (1,1), written directly in the result
+    std::vector<det_base_t<spin_det_type>> os_doubles(
+        n_singles_by_exc_mask(alpha_holes.size(), alpha_parts.size()) *
+        n_singles_by_exc_mask(beta_holes.size(), beta_parts.size()));
+    generate_os_doubles_into(d, alpha_holes, alpha_parts, beta_holes, beta_parts,
+                             os_doubles.data());
 
-    return singles;
+    return os_doubles;
 }
 
-// TODO: refactor, a lot of code re-use
-std::vector<det_t> get_constrained_os_doubles(det_t d, exc_constraint_t constraint,
-                                              uint64_t max_orb) {
-    std::vector<det_t> os_doubles;
-
-    // convert constraints to bit masks
-    // TODO: test if faster to create empty bit mask and set bits
-    spin_det_t hole_mask(to_string(constraint.first, max_orb)); // where holes can be created
-    spin_det_t part_mask(to_string(constraint.second,
-                                   max_orb)); // where particles can be created
+template <class spin_det_type>
+std::vector<det_base_t<spin_det_type>>
+get_constrained_ss_doubles(const det_base_t<spin_det_type> &d, const exc_constraint_t &constraint,
+                           uint64_t max_orb) {
+    const auto lists = get_constrained_exc_lists(d, constraint, max_orb);
+    const auto &[alpha_holes, beta_holes] = lists.holes;
+    const auto &[alpha_parts, beta_parts] = lists.parts;
 
-    // convert max orb to bit masks
-    // TODO: as above, test if faster to create empty bit mask, now with
-    // reserved size, and set bits
-    spin_det_t max_orb_mask(std::string(max_orb, '1'));
+    // at this point, hole and particle bitsets are guaranteed to be disjoint
+    // size the result once and generate both spins directly into it
+    const auto n_alpha = n_ss_doubles_by_exc_mask(alpha_holes.size(), alpha_parts.size());
+    const auto n_beta = n_ss_doubles_by_exc_mask(beta_holes.size(), beta_parts.size());
+    std::vector<det_base_t<spin_det_type>> ss_doubles(n_alpha + n_beta);
+    generate_ss_doubles_into(d, 0, alpha_holes, alpha_parts, ss_doubles.data());
+    generate_ss_doubles_into(d, 1, beta_holes, beta_parts, ss_doubles.data() + n_alpha);
 
-    // apply bit masks and get final list
-    spin_constraint_t alpha_holes = to_constraint((~d[0] & hole_mask) & max_orb_mask);
-    spin_constraint_t alpha_parts = to_constraint((d[0] & part_mask) & max_orb_mask);
+    return ss_doubles;
+}
 
-    spin_constraint_t beta_holes = to_constraint((~d[1] & hole_mask) & max_orb_mask);
-    spin_constraint_t beta_parts = to_constraint((d[1] & part_mask) & max_orb_mask);
+template <class spin_det_type>
+std::vector<det_base_t<spin_det_type>>
+get_triplet_constrained_singles(const det_base_t<spin_det_type> &d, const triplet_constraint_t &t,
+                                uint64_t n_orb, int spin) {
+    const triplet_constrained_exc_t<spin_det_type> exc(d, t, n_orb, spin);
+    std::vector<det_base_t<spin_det_type>> singles(exc.n_singles());
+    exc.singles_into(singles.data());
+    return singles;
+}
 
-    // get all singles and iterate over product of (1,0) X (0,1) to get (1,1)
-    std::vector<spin_det_t> alpha_singles =
-        get_spin_singles_by_exc_mask(d, 0, alpha_holes, alpha_parts);
-    std::vector<spin_det_t> beta_singles =
-        get_spin_singles_by_exc_mask(d, 1, beta_holes, beta_parts);
+template <class spin_det_type>
+std::vector<det_base_t<spin_det_type>>
+get_triplet_constrained_doubles(const det_base_t<spin_det_type> &d, const triplet_constraint_t &t,
+                                uint64_t n_orb, int spin) {
+    const triplet_constrained_exc_t<spin_det_type> exc(d, t, n_orb, spin);
+    std::vector<det_base_t<spin_det_type>> doubles(exc.n_doubles());
+    exc.doubles_into(doubles.data());
+    return doubles;
+}
 
-    for (auto &a : alpha_singles) {
-        for (auto &b : beta_singles) {
-            os_doubles.push_back(det_t(a, b));
+TEST_CASE("testing triplet_constrained_exc_t") {
+    // Compare against filtering every single and double of d by its three highest `spin` orbitals
+    const uint64_t n_orb = 10;
+    std::vector<uint64_t> all(n_orb);
+    for (uint64_t i = 0; i < n_orb; i++)
+        all[i] = i;
+    const exc_constraint_t unconstrained{all, all};
+
+    auto top3 = [](const spin_det_t &s) {
+        triplet_constraint_t t{};
+        int k = 0;
+        for (auto i = s.size(); i-- > 0 && k < 3;)
+            if (s[i])
+                t[k++] = i;
+        return t;
+    };
+    auto filtered = [&](std::vector<det_t> dets, const triplet_constraint_t &t, int spin) {
+        std::vector<det_t> res;
+        for (const auto &e : dets)
+            if (top3(e[spin]) == t)
+                res.push_back(e);
+        std::sort(res.begin(), res.end());
+        return res;
+    };
+    auto sorted = [](std::vector<det_t> v) {
+        std::sort(v.begin(), v.end());
+        return v;
+    };
+
+    const std::vector<det_t> psi{{spin_det_t{"0000011111"}, spin_det_t{"0000001111"}},
+                                 {spin_det_t{"0100101011"}, spin_det_t{"0001100101"}},
+                                 {spin_det_t{"1010000111"}, spin_det_t{"0000010111"}},
+                                 {spin_det_t{"0011100001"}, spin_det_t{"1100000011"}}};
+    const std::vector<triplet_constraint_t> triplets{{4, 3, 2}, {8, 6, 5}, {9, 7, 4},
+                                                     {5, 4, 3}, {7, 5, 3}, {9, 8, 1}};
+    std::size_t n_found = 0;
+    for (const auto &d : psi) {
+        auto doubles = get_constrained_ss_doubles(d, unconstrained, n_orb);
+        const auto os = get_constrained_os_doubles(d, unconstrained, n_orb);
+        doubles.insert(doubles.end(), os.begin(), os.end());
+        const auto singles = get_constrained_singles(d, unconstrained, n_orb);
+        for (const auto &t : triplets) {
+            for (int spin = 0; spin < N_SPIN_SPECIES; spin++) {
+                const auto s = get_triplet_constrained_singles(d, t, n_orb, spin);
+                const auto dd = get_triplet_constrained_doubles(d, t, n_orb, spin);
+                CHECK(sorted(s) == filtered(singles, t, spin));
+                CHECK(sorted(dd) == filtered(doubles, t, spin));
+                n_found += s.size() + dd.size();
+            }
         }
     }
-
-    return os_doubles;
+    CHECK(n_found > 0);
+
+    // static spin types produce the same excitations
+    const static_det_t<1> sd{static_spin_det_t<1>{"0100101011"},
+                             static_spin_det_t<1>{"0001100101"}};
+    const auto sds = get_triplet_constrained_doubles(sd, {8, 6, 5}, n_orb);
+    const auto ds = get_triplet_constrained_doubles(psi[1], {8, 6, 5}, n_orb);
+    REQUIRE(sds.size() == ds.size());
+    for (std::size_t i = 0; i < ds.size(); i++)
+        CHECK(sds[i].alpha.blocks[0] == ds[i].alpha.data()[0]);
 }
 
-std::vector<det_t> get_constrained_ss_doubles(det_t d, exc_constraint_t constraint,
-                                              uint64_t max_orb) {
-    std::vector<det_t> ss_doubles;
-
-    // convert constraints to bit masks
-    // TODO: test if faster to create empty bit mask and set bits
-    spin_det_t hole_mask(to_string(constraint.first, max_orb)); // where holes can be created
-    spin_det_t part_mask(to_string(constraint.second,
-                                   max_orb)); // where particles can be created
-
-    // convert max orb to bit masks
-    // TODO: as above, test if faster to create empty bit mask, now with
-    // reserved size, and set bits
-    spin_det_t max_orb_mask(std::string(max_orb, '1'));
-
-    // apply bit masks and get final list
-    spin_constraint_t alpha_holes = to_constraint((~d[0] & hole_mask) & max_orb_mask);
-    spin_constraint_t alpha_parts = to_constraint((d[0] & part_mask) & max_orb_mask);
-
-    spin_constraint_t beta_holes = to_constraint((~d[1] & hole_mask) & max_orb_mask);
-    spin_constraint_t beta_parts = to_constraint((d[1] & part_mask) & max_orb_mask);
-
-    // at this point, hole and particle bitsets are guaranteed to be disjoint
-    // iterate over product list and add to return vector
-    std::vector<det_t> alpha_ss_doubles =
-        get_ss_doubles_by_exc_mask(d, 0, alpha_holes, alpha_parts);
-    std::vector<det_t> beta_ss_doubles = get_ss_doubles_by_exc_mask(d, 1, beta_holes, beta_parts);
-    ss_doubles.insert(ss_doubles.end(), alpha_ss_doubles.begin(), alpha_ss_doubles.end());
-    ss_doubles.insert(ss_doubles.end(), beta_ss_doubles.begin(), beta_ss_doubles.end());
-
-    return ss_doubles;
-}
\ No newline at end of file
+// Explicit instantiations for every spin type dispatch_n_orb can select
+#define INSTANTIATE_DETERMINANT_ROUTINES(S)                                                        \
+    template det_base_t<S> exc_det(const det_base_t<S> &, const det_base_t<S> &);                \
+    template exc_lists_t<S> get_constrained_exc_lists(const det_base_t<S> &,                     \
+                                                      const exc_constraint_t &, uint64_t);       \
+    template det_base_t<S> apply_single_excitation(const det_base_t<S> &, int, uint64_t,         \
+                                                   uint64_t);                                    \
+    template S apply_spin_single_excitation(const S &, uint64_t, uint64_t);                      \
+    template det_base_t<S> apply_double_excitation(const det_base_t<S> &, std::pair<int, int>,   \
+                                                   uint64_t, uint64_t, uint64_t, uint64_t);     \
+    template std::vector<det_base_t<S>> get_constrained_singles(                                 \
+        const det_base_t<S> &, const exc_constraint_t &, uint64_t);                              \
+    template std::vector<det_base_t<S>> get_constrained_ss_doubles(                              \
+        const det_base_t<S> &, const exc_constraint_t &, uint64_t);                              \
+    template std::vector<det_base_t<S>> get_constrained_os_doubles(                              \
+        const det_base_t<S> &, const exc_constraint_t &, uint64_t);                              \
+    template std::vector<det_base_t<S>> get_singles_by_exc_mask(                                 \
+        const det_base_t<S> &, int, const spin_constraint_t &, const spin_constraint_t &);       \
+    template std::vector<S> get_spin_singles_by_exc_mask(const S &, const spin_constraint_t &,    \
+                                                         const spin_constraint_t &);             \
+    template std::vector<det_base_t<S>> get_ss_doubles_by_exc_mask(                              \
+        const det_base_t<S> &, int, const spin_constraint_t &, const spin_constraint_t &);       \
+    template std::vector<det_base_t<S>> get_all_singles(const det_base_t<S> &, uint64_t);       \
+    template std::vector<det_base_t<S>> get_triplet_constrained_singles(                         \
+        const det_base_t<S> &, const triplet_constraint_t &, uint64_t, int);                     \
+    template std::vector<det_base_t<S>> get_triplet_constrained_doubles(                         \
+        const det_base_t<S> &, const triplet_constraint_t &, uint64_t, int);
+
+INSTANTIATE_DETERMINANT_ROUTINES(spin_det_t)
+INSTANTIATE_DETERMINANT_ROUTINES(static_spin_det_t<1>)
+INSTANTIATE_DETERMINANT_ROUTINES(static_spin_det_t<2>)
+INSTANTIATE_DETERMINANT_ROUTINES(static_spin_det_t<4>)
+INSTANTIATE_DETERMINANT_ROUTINES(static_spin_det_t<8>)
@@ -0,0 +1,380 @@
+#if !defined(DOCTEST_CONFIG_DISABLE)
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#endif
+#include "fcidump.h"
+#include <algorithm>
+#include <bzlib.h>
+#include <charconv>
+#include <cstdio>
+#include <cstring>
+#include <doctest/doctest.h>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <parallel.h>
+#include <stdexcept>
+#include <zlib.h>
+
+namespace {
+
+// Decompressed text of a file: bzip2 for a .bz2 path, else through zlib, which also reads
+// uncompressed files as they are
+class text_source_t {
+  public:
+    explicit text_source_t(const std::string &path) {
+        const bool bz2 = path.size() > 4 && path.compare(path.size() - 4, 4, ".bz2") == 0;
+        if (bz2) {
+            int error;
+            if ((m_file = std::fopen(path.c_str(), "rb")))
+                m_bz = BZ2_bzReadOpen(&error, m_file, 0, 0, nullptr, 0);
+        } else {
+            m_gz = gzopen(path.c_str(), "rb");
+        }
+        if (!m_gz && !m_bz) {
+            // the destructor does not run for a throwing constructor
+            if (m_file)
+                std::fclose(m_file);
+            throw std::runtime_error("fcidump: cannot open " + path);
+        }
+    }
+    text_source_t(const text_source_t &) = delete;
+    text_source_t &operator=(const text_source_t &) = delete;
+
+    ~text_source_t() {
+        int error;
+        if (m_gz)
+            gzclose(m_gz);
+        if (m_bz)
+            BZ2_bzReadClose(&error, m_bz);
+        if (m_file)
+            std::fclose(m_file);
+    }
+
+    // Read up to n bytes into buf; returns the number read, 0 at the end of the text
+    std::size_t read(char *buf, std::size_t n) {
+        if (m_done)
+            return 0;
+        int count, error = BZ_OK;
+        if (m_gz)
+            count = gzread(m_gz, buf, n);
+        else
+            count = BZ2_bzRead(&error, m_bz, buf, n);
+        if (count < 0 || (error != BZ_OK && error != BZ_STREAM_END))
+            throw std::runtime_error("fcidump: read error");
+        m_done = (count == 0) || (error == BZ_STREAM_END);
+        return count;
+    }
+
+  private:
+    gzFile m_gz = nullptr;
+    FILE *m_file = nullptr;
+    BZFILE *m_bz = nullptr;
+    bool m_done = false;
+};
+
+struct two_e_record_t {
+    idx_t idx;
+    double val;
+};
+
+struct one_e_record_t {
+    idx_t i, k;
+    double val;
+};
+
+// Integrals parsed from a slice of lines, in file order
+struct parsed_t {
+    std::array<std::vector<two_e_record_t>, N_CATEGORIES> two_e;
+    std::vector<one_e_record_t> one_e;
+    bool has_E0 = false;
+    double E0 = 0;
+
+    void clear() {
+        for (auto &v : two_e)
+            v.clear();
+        one_e.clear();
+        has_E0 = false;
+    }
+};
+
+bool is_blank(const char c) { return c == ' ' || c == '\t' || c == '\r'; }
+
+[[noreturn]] void parse_error(const char *line, const char *end) {
+    throw std::runtime_error("fcidump: cannot parse line '" +
+                             std::string(line, std::find(line, end, '\n')) + "'");
+}
+
+// Parse the value of an integral, also with a Fortran exponent (1.0D-02)
+const char *parse_value(const char *p, const char *end, double &v) {
+    auto res = std::from_chars(p, end, v);
+    if (res.ec == std::errc() && res.ptr != end && (*res.ptr == 'D' || *res.ptr == 'd')) {
+        char token[64];
+        const char *token_end = res.ptr;
+        while (token_end < end && !is_blank(*token_end) && *token_end != '\n')
+            token_end++;
+        if (token_end - p >= (std::ptrdiff_t)sizeof(token))
+            return nullptr;
+        std::replace_copy_if(
+            p, token_end, token, [](char c) { return c == 'D' || c == 'd'; }, 'E');
+        const auto r = std::from_chars(token, token + (token_end - p), v);
+        return (r.ec == std::errc()) ? p + (r.ptr - token) : nullptr;
+    }
+    return (res.ec == std::errc()) ? res.ptr : nullptr;
+}
+
+// Parse the lines "value a b c d" of [p, end), which ends with a newline or the end of the file
+void parse_lines(const char *p, const char *end, const idx_t n_orb, parsed_t &out) {
+    while (p < end) {
+        const char *line = p;
+        while (p < end && is_blank(*p))
+            p++;
+        if (p == end)
+            break;
+        if (*p == '\n') {
+            p++;
+            continue;
+        }
+
+        double v;
+        idx_t a[4];
+        if (!(p = parse_value(p, end, v)))
+            parse_error(line, end);
+        for (auto &x : a) {
+            while (p < end && is_blank(*p))
+                p++;
+            const auto res = std::from_chars(p, end, x);
+            if (res.ec != std::errc() || x < 0 || x > n_orb)
+                parse_error(line, end);
+            p = res.ptr;
+        }
+        while (p < end && is_blank(*p))
+            p++;
+        if (p < end && *p++ != '\n')
+            parse_error(line, end);
+
+        // Mulliken (ik|jl) in the file, with i == 0 for the nuclear repulsion and j == l == 0
+        // for the one-electron integrals
+        const idx_t i = a[0], k = a[1], j = a[2], l = a[3];
+        if (i == 0) {
+            out.has_E0 = true;
+            out.E0 = v;
+        } else if (j == 0) {
+            out.one_e.push_back({i - 1, k - 1, v});
+        } else {
+            const ijkl_tuple c = canonical_idx4(i - 1, j - 1, k - 1, l - 1);
+            out.two_e[category_idx4(c)].push_back({compound_idx4(c), v});
+        }
+    }
+}
+
+// Parse the header (`&FCI NORB=..., ... /`) at the start of [p, end): returns the end of the
+// header, and sets n_orb
+const char *parse_header(const char *p, const char *end, idx_t &n_orb) {
+    const std::string_view text(p, end - p);
+    // the header ends with the first line containing '/' (or &END)
+    std::size_t stop = std::min(text.find('/'), text.find("&END"));
+    if (stop == text.npos)
+        throw std::runtime_error("fcidump: no end of header");
+    stop = text.find('\n', stop);
+    stop = (stop == text.npos) ? text.size() : stop + 1;
+
+    const auto norb = text.substr(0, stop).find("NORB");
+    const auto eq = text.find('=', norb);
+    if (norb == text.npos || eq >= stop)
+        throw std::runtime_error("fcidump: no NORB in header");
+    const char *q = p + eq + 1;
+    while (q < end && is_blank(*q))
+        q++;
+    if (std::from_chars(q, end, n_orb).ec != std::errc() || n_orb <= 0)
+        throw std::runtime_error("fcidump: bad NORB in header");
+    return p + stop;
+}
+
+} // namespace
+
+fcidump_t load_fcidump(const std::string &path, unsigned n_threads, std::size_t block_size) {
+    n_threads = std::max(1u, n_threads);
+    text_source_t source(path);
+    fcidump_t res;
+
+    // Parsed integrals, in file order
+    std::array<std::vector<two_e_record_t>, N_CATEGORIES> two_e;
+    std::vector<parsed_t> parsed(n_threads);
+
+    // not value-initialized: only the pages the text fills are touched
+    const std::unique_ptr<char[]> buf(new char[block_size]);
+    std::size_t filled = 0;
+    bool header = true, eof = false;
+    while (!eof) {
+        while (filled < block_size && !eof) {
+            const auto n = source.read(buf.get() + filled, block_size - filled);
+            eof = (n == 0);
+            filled += n;
+        }
+        const char *first = buf.get();
+        const char *last = first + filled;
+        if (!eof) {
+            // lines that do not end in this block go to the next one
+            while (last > first && last[-1] != '\n')
+                last--;
+            if (last == first)
+                throw std::runtime_error("fcidump: line longer than the block size");
+        }
+        if (header) {
+            first = parse_header(first, last, res.n_orb);
+            res.one_e.assign(res.n_orb * res.n_orb, 0);
+            header = false;
+        }
+
+        // one slice of lines per thread
+        std::vector<const char *> bounds(n_threads + 1, last);
+        bounds[0] = first;
+        for (unsigned t = 1; t < n_threads; t++) {
+            const char *b = std::max(bounds[t - 1], first + (last - first) * t / n_threads);
+            while (b > first && b < last && b[-1] != '\n')
+                b++;
+            bounds[t] = b;
+        }
+        parallel_slices(n_threads, n_threads, [&](unsigned t, std::size_t, std::size_t) {
+            parsed[t].clear();
+            parse_lines(bounds[t], bounds[t + 1], res.n_orb, parsed[t]);
+        });
+
+        for (const auto &p : parsed) {
+            for (int c = 0; c < N_CATEGORIES; c++)
+                two_e[c].insert(two_e[c].end(), p.two_e[c].begin(), p.two_e[c].end());
+            for (const auto &r : p.one_e)
+                res.one_e[r.i * res.n_orb + r.k] = res.one_e[r.k * res.n_orb + r.i] = r.val;
+            if (p.has_E0)
+                res.E0 = p.E0;
+        }
+
+        filled = buf.get() + filled - last;
+        std::memmove(buf.get(), last, filled);
+    }
+    if (header)
+        throw std::runtime_error("fcidump: empty file " + path);
+
+    // sort each category by compound index, the last value of a repeated index winning
+    parallel_slices(std::min(n_threads, (unsigned)N_CATEGORIES), N_CATEGORIES,
+                    [&](unsigned, std::size_t begin, std::size_t end) {
+                        for (auto c = begin; c < end; c++) {
+                            auto &records = two_e[c];
+                            std::stable_sort(records.begin(), records.end(),
+                                             [](const two_e_record_t &a, const two_e_record_t &b) {
+                                                 return a.idx < b.idx;
+                                             });
+                            auto &idx = res.two_e_idx[c];
+                            auto &val = res.two_e_val[c];
+                            for (const auto &r : records) {
+                                if (!idx.empty() && idx.back() == r.idx) {
+                                    val.back() = r.val;
+                                } else {
+                                    idx.push_back(r.idx);
+                                    val.push_back(r.val);
+                                }
+                            }
+                            records = std::vector<two_e_record_t>();
+                        }
+                    });
+    return res;
+}
+
+extern "C" fcidump_t *fcidump_load(const char *path, const int n_threads) {
+    try {
+        return new fcidump_t(
+            load_fcidump(path, n_threads > 0 ? n_threads : std::thread::hardware_concurrency()));
+    } catch (const std::exception &e) {
+        std::cerr << e.what() << '\n';
+        return nullptr;
+    }
+}
+
+extern "C" void fcidump_free(fcidump_t *f) { delete f; }
+extern "C" idx_t fcidump_n_orb(const fcidump_t *f) { return f->n_orb; }
+extern "C" double fcidump_E0(const fcidump_t *f) { return f->E0; }
+extern "C" const double *fcidump_one_e(const fcidump_t *f) { return f->one_e.data(); }
+extern "C" idx_t fcidump_two_e_size(const fcidump_t *f, const int category) {
+    return f->two_e_idx[category].size();
+}
+extern "C" const idx_t *fcidump_two_e_idx(const fcidump_t *f, const int category) {
+    return f->two_e_idx[category].data();
+}
+extern "C" const double *fcidump_two_e_val(const fcidump_t *f, const int category) {
+    return f->two_e_val[category].data();
+}
+
+namespace {
+
+const char *test_fcidump = " &FCI NORB=   4 , NELEC=  2 , MS2=   0 ,\n"
+                           "  ORBSYM=1,1,1,1,\n"
+                           "  ISYM=0,\n"
+                           " /\n"
+                           "   0.5           1           1           1           1\n"
+                           "  0.25           2           1           1           1\n"
+                           "  1.0D-01        1           3           2           4\n"
+                           " -2.5E-001       1           2           1           3\n"
+                           "\n"
+                           "   0.75          1           2           1           1\n"
+                           "  -1.5           1           1           0           0\n"
+                           "  -0.5           3           2           0           0\n"
+                           "   4.0           0           0           0           0\n";
+
+std::string write_test_file(const std::string &name, const std::string &text) {
+    const auto path = (std::filesystem::temp_directory_path() / name).string();
+    if (name.size() > 3 && name.compare(name.size() - 3, 3, ".gz") == 0) {
+        gzFile f = gzopen(path.c_str(), "wb");
+        gzwrite(f, text.data(), text.size());
+        gzclose(f);
+    } else if (name.size() > 4 && name.compare(name.size() - 4, 4, ".bz2") == 0) {
+        FILE *f = std::fopen(path.c_str(), "wb");
+        int error;
+        BZFILE *bz = BZ2_bzWriteOpen(&error, f, 9, 0, 0);
+        BZ2_bzWrite(&error, bz, const_cast<char *>(text.data()), text.size());
+        BZ2_bzWriteClose(&error, bz, 0, nullptr, nullptr);
+        std::fclose(f);
+    } else {
+        FILE *f = std::fopen(path.c_str(), "w");
+        std::fwrite(text.data(), 1, text.size(), f);
+        std::fclose(f);
+    }
+    return path;
+}
+
+} // namespace
+
+TEST_CASE("testing load_fcidump") {
+    const std::string text = test_fcidump;
+    for (const char *name : {"qe_test.fcidump", "qe_test.fcidump.gz", "qe_test.fcidump.bz2"}) {
+        const auto path = write_test_file(name, text);
+        for (const unsigned n_threads : {1u, 3u, 64u}) // 64: slices of less than a line
+            for (const std::size_t block_size : {std::size_t(200), std::size_t(1) << 20}) {
+                const auto f = load_fcidump(path, n_threads, block_size);
+                CHECK(f.n_orb == 4);
+                CHECK(f.E0 == 4.0);
+                std::vector<double> one_e(16);
+                one_e[0] = -1.5;
+                one_e[1 * 4 + 2] = one_e[2 * 4 + 1] = -0.5;
+                CHECK(f.one_e == one_e);
+
+                // <11|11> is A; <21|11> and <11|21> are the same D integral, the last value
+                // winning; <12|34> is G and <11|23> is E (Dirac notation, from 1)
+                CHECK(f.two_e_idx[IC_A] == std::vector<idx_t>{0});
+                CHECK(f.two_e_val[IC_A] == std::vector<double>{0.5});
+                CHECK(f.two_e_idx[IC_D] == std::vector<idx_t>{compound_idx4(0, 0, 0, 1)});
+                CHECK(f.two_e_val[IC_D] == std::vector<double>{0.75});
+                CHECK(f.two_e_idx[IC_G] == std::vector<idx_t>{compound_idx4(0, 1, 2, 3)});
+                CHECK(f.two_e_val[IC_G] == std::vector<double>{0.1});
+                CHECK(f.two_e_idx[IC_E] == std::vector<idx_t>{compound_idx4(0, 0, 1, 2)});
+                CHECK(f.two_e_val[IC_E] == std::vector<double>{-0.25});
+                for (const int c : {IC_B, IC_C, IC_F})
+                    CHECK(f.two_e_idx[c].empty());
+            }
+        std::filesystem::remove(path);
+    }
+
+    const auto bad = write_test_file("qe_bad.fcidump", text + " 1.0   1  x  1  1\n");
+    CHECK_THROWS_AS(load_fcidump(bad, 2), std::runtime_error);
+    std::filesystem::remove(bad);
+    CHECK_THROWS_AS(load_fcidump("/nonexistent/qe.fcidump"), std::runtime_error);
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+// Minimal allocator returning ALIGNMENT-byte aligned storage, e.g. so that every word slice of a
+// psi_block starts on a cache line and can be loaded with aligned vector instructions
+template <class T, std::size_t ALIGNMENT = 64> struct aligned_allocator_t {
+    typedef T value_type;
+
+    template <class U> struct rebind {
+        typedef aligned_allocator_t<U, ALIGNMENT> other;
+    };
+
+    aligned_allocator_t() = default;
+    template <class U> aligned_allocator_t(const aligned_allocator_t<U, ALIGNMENT> &) {}
+
+    T *allocate(std::size_t n) {
+        const std::size_t bytes = (n * sizeof(T) + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+        if (void *p = std::aligned_alloc(ALIGNMENT, bytes))
+            return static_cast<T *>(p);
+        throw std::bad_alloc();
+    }
+    void deallocate(T *p, std::size_t) { std::free(p); }
+
+    template <class U> bool operator==(const aligned_allocator_t<U, ALIGNMENT> &) const {
+        return true;
+    }
+    template <class U> bool operator!=(const aligned_allocator_t<U, ALIGNMENT> &) const {
+        return false;
+    }
+};
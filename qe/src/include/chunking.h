@@ -0,0 +1,95 @@
+#pragma once
+#include "integral_types.h"
+#include <algorithm>
+#include <vector>
+
+/*
+Native counterpart of JChunkFactory (qe/chunking.py). The compound indices of the integrals of a
+category are generated in the order of its A_idx_iter .. G_idx_iter generator, cut in batches of
+chunk_size indices (one batch when chunk_size < 1, each index then being distributed on its own),
+and the batches are split between n_ranks workers:
+    CHUNK_ROUND_ROBIN   batches rank, rank + n_ranks, ... as the islice of JChunkFactory
+    CHUNK_CONTIGUOUS    a contiguous range of batches, the ranges differing by at most one batch
+The values are then looked up in the sorted (compound index, value) arrays of the category, e.g.
+those of an fcidump_t or an integral_store_t.
+*/
+enum chunk_distribution_t { CHUNK_ROUND_ROBIN, CHUNK_CONTIGUOUS };
+
+// Number of distinct integrals of category c of n_orb orbitals
+idx_t category_size(j_category c, idx_t n_orb);
+
+// Integrals of one category given to a worker, as the (J, J_ind, N) arguments of its kernel in
+// integrals.h; the counterpart of the JChunk dataclass of qe/chunking.py
+template <class T> struct category_chunk_t {
+    j_category category;
+    std::vector<idx_t> J_ind;
+    std::vector<T> J;
+    idx_t size() const { return J_ind.size(); }
+};
+
+class JChunkFactory {
+  public:
+    JChunkFactory(idx_t N_orb, j_category category, idx_t chunk_size = -1, idx_t rank = 0,
+                  idx_t n_ranks = 1, chunk_distribution_t distribution = CHUNK_ROUND_ROBIN);
+
+    // Number of indices and of chunks of this worker
+    idx_t size() const;
+    idx_t n_chunks() const;
+
+    // The compound indices of this worker in generation order, chunk c being
+    // J_ind[offsets[c] .. offsets[c + 1])
+    void indices(idx_t *J_ind, idx_t *offsets) const;
+
+    // The chunks of this worker, with the values of the n sorted compound indices src_idx taken
+    // from src_val (zero for indices not listed, e.g. integrals absent from an FCIDUMP file)
+    template <class T>
+    std::vector<category_chunk_t<T>> get_chunks(const idx_t *src_idx, const T *src_val,
+                                                const idx_t src_n) const {
+        std::vector<idx_t> J_ind(size()), offsets(n_chunks() + 1);
+        indices(J_ind.data(), offsets.data());
+        std::vector<category_chunk_t<T>> chunks(n_chunks());
+        for (idx_t c = 0; c < n_chunks(); c++) {
+            auto &chunk = chunks[c];
+            chunk.category = m_category;
+            chunk.J_ind.assign(J_ind.begin() + offsets[c], J_ind.begin() + offsets[c + 1]);
+            chunk.J.resize(chunk.size());
+            fill_values(chunk.J_ind.data(), chunk.size(), src_idx, src_val, src_n,
+                        chunk.J.data());
+        }
+        return chunks;
+    }
+
+    // J[p] = value of J_ind[p] in the n sorted compound indices src_idx of values src_val
+    template <class T>
+    static void fill_values(const idx_t *J_ind, const idx_t n, const idx_t *src_idx,
+                            const T *src_val, const idx_t src_n, T *J) {
+        for (idx_t p = 0; p < n; p++) {
+            const idx_t *it = std::lower_bound(src_idx, src_idx + src_n, J_ind[p]);
+            J[p] = (it != src_idx + src_n && *it == J_ind[p]) ? src_val[it - src_idx] : T(0);
+        }
+    }
+
+  private:
+    // number of batches and of indices of the category, and the range of owned batches (for
+    // CHUNK_CONTIGUOUS)
+    idx_t n_batches() const { return (m_total + m_batch - 1) / m_batch; }
+    idx_t first_batch(idx_t rank) const;
+    bool owns_batch(idx_t b) const;
+
+    idx_t m_N_orb;
+    j_category m_category;
+    idx_t m_chunk_size, m_rank, m_n_ranks;
+    chunk_distribution_t m_distribution;
+    idx_t m_total, m_batch;
+};
+
+// C ABI for ctypes (qe/chunking.py): jchunk_factory_size returns the number of indices of the
+// worker and writes its number of chunks to n_chunks; jchunk_factory_fill writes its indices,
+// values and chunk offsets (n_chunks + 1 entries), src_val may be null for zero values. Both return
+// -1 (printing the reason) on invalid arguments.
+extern "C" idx_t jchunk_factory_size(idx_t N_orb, int category, idx_t chunk_size, idx_t rank,
+                                     idx_t n_ranks, int distribution, idx_t *n_chunks);
+extern "C" int jchunk_factory_fill(idx_t N_orb, int category, idx_t chunk_size, idx_t rank,
+                                   idx_t n_ranks, int distribution, const idx_t *src_idx,
+                                   const double *src_val, idx_t src_n, idx_t *J_ind, double *J,
+                                   idx_t *offsets);
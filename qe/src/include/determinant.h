@@ -1,44 +1,272 @@
 #pragma once
 
+#include <algorithm>
 #include <array>
+#include <cassert>
+#include <cstdint>
 #include <functional>
 #include <iostream>
+#include <limits>
 #include <string>
+#include <string_view>
 #include <sul/dynamic_bitset.hpp>
 #include <tuple>
 #include <utility>
 #include <vector>
 
+// Fixed-width spin determinant, stored as N_WORDS 64-bit blocks on the stack.
+// Mirrors the subset of the sul::dynamic_bitset API used by the determinant routines and kernels,
+// so that both can be used interchangeably as the spin type of a det_base_t. As with
+// dynamic_bitset, bit 0 is the rightmost character of the string representation.
+template <std::size_t N_WORDS> class static_spin_det_t {
+  public:
+    typedef uint64_t block_type;
+    typedef std::size_t size_type;
+    static constexpr size_type bits_per_block = 64;
+    static constexpr size_type npos = std::numeric_limits<size_type>::max();
+
+    // Proxy returned by the non-const operator[], so that `d[i] = 1` works as for dynamic_bitset
+    class reference {
+      public:
+        reference(block_type &block, size_type bit)
+            : m_block(block), m_mask(block_type(1) << bit) {}
+
+        reference &operator=(bool v) {
+            m_block = v ? (m_block | m_mask) : (m_block & ~m_mask);
+            return *this;
+        }
+        reference &operator=(const reference &other) { return *this = bool(other); }
+
+        operator bool() const { return (m_block & m_mask) != 0; }
+        bool operator~() const { return (m_block & m_mask) == 0; }
+
+      private:
+        block_type &m_block;
+        block_type m_mask;
+    };
+
+    std::array<block_type, N_WORDS> blocks{};
+
+    static_spin_det_t() = default;
+
+    // `n_orb` is only checked against the capacity, the width is fixed by N_WORDS
+    explicit static_spin_det_t(size_type n_orb, block_type init_val = 0) {
+        assert(n_orb <= size());
+        blocks[0] = init_val;
+    }
+
+    explicit static_spin_det_t(std::string_view str) {
+        assert(str.size() <= size());
+        const size_type n = str.size();
+        for (size_type i = 0; i < n; i++)
+            set(i, str[n - 1 - i] == '1');
+    }
+
+    static constexpr size_type size() { return N_WORDS * bits_per_block; }
+    static constexpr size_type num_blocks() { return N_WORDS; }
+    block_type *data() { return blocks.data(); }
+    const block_type *data() const { return blocks.data(); }
+
+    bool test(size_type pos) const { return (blocks[pos / 64] >> (pos % 64)) & 1; }
+    bool operator[](size_type pos) const { return test(pos); }
+    reference operator[](size_type pos) { return reference(blocks[pos / 64], pos % 64); }
+
+    static_spin_det_t &set(size_type pos, bool value = true) {
+        (*this)[pos] = value;
+        return *this;
+    }
+    // Set the `len` bits starting at `pos` to `value`
+    static_spin_det_t &set(size_type pos, size_type len, bool value) {
+        for (size_type i = pos; i < pos + len; i++)
+            set(i, value);
+        return *this;
+    }
+    static_spin_det_t &set() {
+        blocks.fill(~block_type(0));
+        return *this;
+    }
+    static_spin_det_t &reset(size_type pos) { return set(pos, false); }
+    static_spin_det_t &reset() {
+        blocks.fill(0);
+        return *this;
+    }
+    static_spin_det_t &flip(size_type pos) {
+        blocks[pos / 64] ^= block_type(1) << (pos % 64);
+        return *this;
+    }
+
+    size_type count() const {
+        size_type c = 0;
+        for (const auto &b : blocks)
+            c += __builtin_popcountll(b);
+        return c;
+    }
+    bool any() const {
+        for (const auto &b : blocks)
+            if (b)
+                return true;
+        return false;
+    }
+    bool none() const { return !any(); }
+
+    bool is_subset_of(const static_spin_det_t &other) const {
+        for (size_type w = 0; w < N_WORDS; w++)
+            if (blocks[w] & ~other.blocks[w])
+                return false;
+        return true;
+    }
+
+    size_type find_first() const { return find_from(0); }
+    size_type find_next(size_type prev) const {
+        return (prev + 1 >= size()) ? npos : find_from(prev + 1);
+    }
+
+    static_spin_det_t &operator&=(const static_spin_det_t &other) {
+        for (size_type w = 0; w < N_WORDS; w++)
+            blocks[w] &= other.blocks[w];
+        return *this;
+    }
+    static_spin_det_t &operator|=(const static_spin_det_t &other) {
+        for (size_type w = 0; w < N_WORDS; w++)
+            blocks[w] |= other.blocks[w];
+        return *this;
+    }
+    static_spin_det_t &operator^=(const static_spin_det_t &other) {
+        for (size_type w = 0; w < N_WORDS; w++)
+            blocks[w] ^= other.blocks[w];
+        return *this;
+    }
+    static_spin_det_t operator~() const {
+        static_spin_det_t res;
+        for (size_type w = 0; w < N_WORDS; w++)
+            res.blocks[w] = ~blocks[w];
+        return res;
+    }
+
+    friend static_spin_det_t operator&(static_spin_det_t lhs, const static_spin_det_t &rhs) {
+        return lhs &= rhs;
+    }
+    friend static_spin_det_t operator|(static_spin_det_t lhs, const static_spin_det_t &rhs) {
+        return lhs |= rhs;
+    }
+    friend static_spin_det_t operator^(static_spin_det_t lhs, const static_spin_det_t &rhs) {
+        return lhs ^= rhs;
+    }
+    friend bool operator==(const static_spin_det_t &lhs, const static_spin_det_t &rhs) {
+        return lhs.blocks == rhs.blocks;
+    }
+    friend bool operator!=(const static_spin_det_t &lhs, const static_spin_det_t &rhs) {
+        return !(lhs == rhs);
+    }
+    // Same ordering as dynamic_bitset: compare as unsigned integers, most significant block first
+    friend bool operator<(const static_spin_det_t &lhs, const static_spin_det_t &rhs) {
+        for (size_type w = N_WORDS; w-- > 0;)
+            if (lhs.blocks[w] != rhs.blocks[w])
+                return lhs.blocks[w] < rhs.blocks[w];
+        return false;
+    }
+
+    std::string to_string() const {
+        std::string s(size(), '0');
+        for (size_type i = 0; i < size(); i++)
+            if (test(i))
+                s[size() - 1 - i] = '1';
+        return s;
+    }
+
+    friend std::ostream &operator<<(std::ostream &os, const static_spin_det_t &s) {
+        return os << s.to_string();
+    }
+
+  private:
+    size_type find_from(size_type pos) const {
+        size_type w = pos / 64;
+        if (w >= N_WORDS)
+            return npos;
+        block_type b = blocks[w] & (~block_type(0) << (pos % 64));
+        while (true) {
+            if (b)
+                return w * 64 + __builtin_ctzll(b);
+            if (++w == N_WORDS)
+                return npos;
+            b = blocks[w];
+        }
+    }
+};
+
 typedef sul::dynamic_bitset<> spin_det_t;
 
+// wyhash-style mixing: fold the 128-bit product of the two operands into 64 bits
+inline uint64_t hash_mix(uint64_t a, uint64_t b) {
+    __uint128_t r = static_cast<__uint128_t>(a) * b;
+    return static_cast<uint64_t>(r) ^ static_cast<uint64_t>(r >> 64);
+}
+
+// Hash the raw 64-bit blocks of a spin determinant, without going through to_string().
+// Works for both spin_det_t and static_spin_det_t; `seed` is used to chain the two spins of a det.
+template <class spin_det_type>
+inline std::size_t hash_spin_det(const spin_det_type &s, uint64_t seed = 0) {
+    constexpr uint64_t p0 = 0xa0761d6478bd642full;
+    constexpr uint64_t p1 = 0xe7037ed1a0b428dbull;
+    const auto *blocks = s.data();
+    const std::size_t n = s.num_blocks();
+
+    uint64_t h = seed;
+    for (std::size_t i = 0; i < n; i++)
+        h = hash_mix(static_cast<uint64_t>(blocks[i]) ^ p0, h ^ p1);
+    return hash_mix(h ^ p0, n ^ p1);
+}
+
 template <> struct std::hash<spin_det_t> {
-    std::size_t operator()(spin_det_t const &s) const noexcept {
-        return std::hash<std::string>()(s.to_string());
+    std::size_t operator()(spin_det_t const &s) const noexcept { return hash_spin_det(s); }
+};
+
+template <std::size_t N_WORDS> struct std::hash<static_spin_det_t<N_WORDS>> {
+    std::size_t operator()(static_spin_det_t<N_WORDS> const &s) const noexcept {
+        return hash_spin_det(s);
     }
 };
 
 #define N_SPIN_SPECIES 2
 
-class det_t { // The class
+// Number of orbitals whose occupation differs between two spin determinants, accumulated one
+// word at a time so that no temporary bitset is built
+template <class spin_det_type>
+int count_differences(const spin_det_type &a, const spin_det_type &b) {
+    const auto *x = a.data();
+    const auto *y = b.data();
+    int n = 0;
+    for (std::size_t w = 0; w < a.num_blocks(); w++)
+        n += __builtin_popcountll(x[w] ^ y[w]);
+    return n;
+}
+
+// Determinant templated over its spin type, either the heap-backed spin_det_t (any number of
+// orbitals) or a static_spin_det_t<N_WORDS> (up to 64 * N_WORDS orbitals, no allocation).
+template <class spin_det_type> class det_base_t { // The class
 
   public: // Access specifier
-    spin_det_t alpha;
-    spin_det_t beta;
+    typedef spin_det_type spin_type;
+
+    spin_det_type alpha;
+    spin_det_type beta;
 
-    det_t(spin_det_t _alpha, spin_det_t _beta) {
+    det_base_t() = default;
+
+    det_base_t(spin_det_type _alpha, spin_det_type _beta) {
         alpha = _alpha;
         beta = _beta;
     }
 
-    bool operator<(const det_t &b) const {
+    bool operator<(const det_base_t &b) const {
         if (alpha == b.alpha)
             return (beta < b.beta);
         return (alpha < b.alpha);
     }
 
-    bool operator==(const det_t &b) const { return (alpha == b.alpha) && (beta == b.beta); }
+    bool operator==(const det_base_t &b) const { return (alpha == b.alpha) && (beta == b.beta); }
 
-    spin_det_t &operator[](unsigned i) {
+    spin_det_type &operator[](unsigned i) {
         assert(i < N_SPIN_SPECIES);
         switch (i) {
         case 0:
@@ -51,29 +279,54 @@ class det_t { // The class
     }
     // https://stackoverflow.com/a/27830679/7674852 seem to recommand doing the
     // other way arround
-    const spin_det_t &operator[](unsigned i) const { return (*this)[i]; }
+    const spin_det_type &operator[](unsigned i) const {
+        return const_cast<det_base_t &>(*this)[i];
+    }
 
     // get excitation degree between self and other determinant
-    std::array<int, N_SPIN_SPECIES> exc_degree(const det_t &b) {
-        auto ed_alpha = (*this.alpha ^ b.alpha).count() / 2;
-        auto ed_beta = (*this.beta ^ b.beta).count() / 2;
+    std::array<int, N_SPIN_SPECIES> exc_degree(const det_base_t &b) const {
+        int ed_alpha = count_differences(alpha, b.alpha) / 2;
+        int ed_beta = count_differences(beta, b.beta) / 2;
         return std::array<int, N_SPIN_SPECIES>{ed_alpha, ed_beta};
     }
 };
 
-template <> struct std::hash<det_t> {
-    std::size_t operator()(det_t const &s) const noexcept {
-        std::size_t h1 = std::hash<spin_det_t>{}(s.alpha);
-        std::size_t h2 = std::hash<spin_det_t>{}(s.beta);
-        return h1 ^ (h2 << 1);
+typedef det_base_t<spin_det_t> det_t;
+
+template <std::size_t N_WORDS> using static_det_t = det_base_t<static_spin_det_t<N_WORDS>>;
+
+// Beta is hashed with the alpha hash as seed, so swapping the spins gives a different hash
+template <class spin_det_type> struct std::hash<det_base_t<spin_det_type>> {
+    std::size_t operator()(det_base_t<spin_det_type> const &s) const noexcept {
+        return hash_spin_det(s.beta, hash_spin_det(s.alpha));
     }
 };
 
 // Should be moved in the cpp of det
-inline std::ostream &operator<<(std::ostream &os, const det_t &obj) {
+template <class spin_det_type>
+inline std::ostream &operator<<(std::ostream &os, const det_base_t<spin_det_type> &obj) {
     return os << "(" << obj.alpha << "," << obj.beta << ")";
 }
 
+template <class T> struct det_type_tag {
+    typedef T type;
+};
+
+// Call `f` with a det_type_tag of the narrowest determinant type able to hold `n_orb` orbitals:
+// static_det_t for up to 64/128/256/512 orbitals, the heap-backed det_t above that.
+// Usage: dispatch_n_orb(n_orb, [&](auto tag) { using D = typename decltype(tag)::type; ... });
+template <class F> decltype(auto) dispatch_n_orb(std::size_t n_orb, F &&f) {
+    if (n_orb <= 64)
+        return f(det_type_tag<static_det_t<1>>{});
+    if (n_orb <= 128)
+        return f(det_type_tag<static_det_t<2>>{});
+    if (n_orb <= 256)
+        return f(det_type_tag<static_det_t<4>>{});
+    if (n_orb <= 512)
+        return f(det_type_tag<static_det_t<8>>{});
+    return f(det_type_tag<det_t>{});
+}
+
 typedef sul::dynamic_bitset<> spin_occupancy_mask_t;
 typedef std::array<spin_occupancy_mask_t, N_SPIN_SPECIES> occupancy_mask_t;
 
@@ -82,61 +335,801 @@ typedef std::array<spin_unoccupancy_mask_t, N_SPIN_SPECIES> unoccupancy_mask_t;
 
 typedef std::array<uint64_t, 4> eri_4idx_t;
 
-det_t exc_det(det_t &a, det_t &b);
+// The routines below are templated over the spin type (spin_det_t or static_spin_det_t<N_WORDS>)
+// and explicitly instantiated in determinant.cpp for each type returned by dispatch_n_orb.
+template <class spin_det_type>
+det_base_t<spin_det_type> exc_det(const det_base_t<spin_det_type> &a,
+                                  const det_base_t<spin_det_type> &b);
+
+/*
+Excitation between two determinants, computed in a single pass over their words.
+
+degree[spin] is the number of holes of that spin; holes are occupied only in the first
+determinant, particles only in the second, both in increasing order (only the first
+degree[spin] entries are meaningful). The pass stops as soon as more than two orbitals have been
+excited, in which case order() > 2 and the hole/particle lists are incomplete.
+*/
+struct excitation_info_t {
+    std::array<int, N_SPIN_SPECIES> degree{};
+    std::array<std::array<uint64_t, 2>, N_SPIN_SPECIES> holes;
+    std::array<std::array<uint64_t, 2>, N_SPIN_SPECIES> parts;
+
+    int order() const { return degree[0] + degree[1]; }
+
+    // Whether orbital o is a hole or a particle of the given spin
+    bool involves(int spin, uint64_t o) const {
+        for (int k = 0; k < degree[spin]; k++)
+            if (holes[spin][k] == o || parts[spin][k] == o)
+                return true;
+        return false;
+    }
+};
+
+template <class spin_det_type>
+excitation_info_t get_excitation_info(const det_base_t<spin_det_type> &a,
+                                      const det_base_t<spin_det_type> &b) {
+    excitation_info_t exc;
+    int n_h = 0;
+    for (int spin = 0; spin < N_SPIN_SPECIES; spin++) {
+        const auto *x = a[spin].data();
+        const auto *y = b[spin].data();
+        int n_p = 0;
+        for (std::size_t w = 0; w < a[spin].num_blocks(); w++) {
+            const uint64_t diff = x[w] ^ y[w];
+            if (!diff)
+                continue;
+            uint64_t h = diff & x[w], p = diff & y[w];
+            const int dh = __builtin_popcountll(h), dp = __builtin_popcountll(p);
+            if (n_h + dh > 2 || n_p + dp > 2) {
+                exc.degree[spin] = 3; // early exit, not connected
+                return exc;
+            }
+            for (; h; h &= h - 1)
+                exc.holes[spin][exc.degree[spin]++] = 64 * w + __builtin_ctzll(h);
+            for (; p; p &= p - 1)
+                exc.parts[spin][n_p++] = 64 * w + __builtin_ctzll(p);
+            n_h += dh;
+        }
+    }
+    return exc;
+}
+
+// Slice of the bit mask [0, x) falling in block `w`, computed without branching on x
+inline uint64_t mask_below(uint64_t x, std::size_t w) {
+    const uint64_t lo = 64 * w;
+    const uint64_t s = std::min(std::max(x, lo), lo + 64) - lo; // in [0, 64]
+    return (s == 64) ? ~uint64_t(0) : (uint64_t(1) << s) - 1;
+}
+
+// Parity of the number of occupied orbitals strictly between h and p.
+// The masked blocks are XOR-folded before a single popcount, since only the parity is needed.
+template <class spin_det_type>
+inline bool excitation_parity(const spin_det_type &d, uint64_t h, uint64_t p) {
+    const uint64_t i = std::min(h, p) + 1;
+    const uint64_t j = std::max(h, p);
+    const auto *blocks = d.data();
+    uint64_t folded = 0;
+    for (std::size_t w = 0; w < d.num_blocks(); w++)
+        folded ^= static_cast<uint64_t>(blocks[w]) & (mask_below(j, w) & ~mask_below(i, w));
+    return __builtin_popcountll(folded) & 1;
+}
 
-int compute_phase_single_excitation(spin_det_t d, uint64_t h, uint64_t p);
-int compute_phase_double_excitation(spin_det_t d, uint64_t h1, uint64_t h2, uint64_t p1,
-                                    uint64_t p2);
-int compute_phase_double_excitation(det_t d, uint64_t h1, uint64_t h2, uint64_t p1, uint64_t p2);
+template <class spin_det_type>
+inline int compute_phase_single_excitation(const spin_det_type &d, uint64_t h, uint64_t p) {
+    return 1 - 2 * static_cast<int>(excitation_parity(d, h, p));
+}
+
+// Batched form: phases[n] of the n single excitations h[n] -> p[n] of the same spin determinant
+template <class spin_det_type>
+inline void compute_phase_single_excitations(const spin_det_type &d, const uint64_t *h,
+                                             const uint64_t *p, std::size_t n, int *phases) {
+    for (std::size_t k = 0; k < n; k++)
+        phases[k] = compute_phase_single_excitation(d, h[k], p[k]);
+}
+
+template <class spin_det_type>
+inline int compute_phase_double_excitation(const spin_det_type &d, uint64_t h1, uint64_t h2,
+                                           uint64_t p1, uint64_t p2) {
+    // Single spin channel excitations, i.e., (2,0) or (0,2)
+    const bool parity = excitation_parity(d, h1, p1) ^ excitation_parity(d, h2, p2) ^ (h2 < p1) ^
+                        (p2 < h1);
+    return 1 - 2 * static_cast<int>(parity);
+}
 
 // overload phase compute for (1,1) excitations
-det_t apply_single_excitation(det_t s, int spin, uint64_t hole, uint64_t particle);
+template <class spin_det_type>
+inline int compute_phase_double_excitation(const det_base_t<spin_det_type> &d, uint64_t h1,
+                                           uint64_t h2, uint64_t p1, uint64_t p2) {
+    // Cross channel excitations, i.e., (1,1)
+    // Assumes alpha are h1-p1, beta are h2-p2
+    const bool parity = excitation_parity(d[0], h1, p1) ^ excitation_parity(d[1], h2, p2);
+    return 1 - 2 * static_cast<int>(parity);
+}
+
+// Prefix parity of a spin determinant: bit k is the parity of the occupied orbitals in [0, k].
+// The XOR-shift scan runs within each block, and the parity of the lower blocks is carried over.
+template <class spin_det_type> spin_det_type get_phase_mask(spin_det_type d) {
+    auto *blocks = d.data();
+    uint64_t carry = 0;
+    for (std::size_t w = 0; w < d.num_blocks(); w++) {
+        uint64_t x = blocks[w];
+        x ^= x << 1;
+        x ^= x << 2;
+        x ^= x << 4;
+        x ^= x << 8;
+        x ^= x << 16;
+        x ^= x << 32;
+        x ^= carry;
+        carry = uint64_t(0) - (x >> 63);
+        // keep the bits past size() cleared, as dynamic_bitset expects
+        blocks[w] = x & mask_below(d.size(), w);
+    }
+    return d;
+}
+
+// Cached prefix-parity masks of both spins of a determinant. With them the parity of any range of
+// orbitals is two bit lookups and an XOR, so single and double phases become O(1).
+template <class spin_det_type> class phase_mask_t {
+  public:
+    spin_det_type alpha;
+    spin_det_type beta;
+
+    phase_mask_t() = default;
+    explicit phase_mask_t(const det_base_t<spin_det_type> &d)
+        : alpha(get_phase_mask(d.alpha)), beta(get_phase_mask(d.beta)) {}
+
+    const spin_det_type &operator[](unsigned i) const {
+        assert(i < N_SPIN_SPECIES);
+        return i ? beta : alpha;
+    }
+
+    // Parity of the occupied orbitals strictly between h and p in `spin`
+    bool parity(int spin, uint64_t h, uint64_t p) const {
+        const auto &[i, j] = std::minmax(h, p);
+        const auto &m = (*this)[spin];
+        return m[j - 1] ^ m[i];
+    }
+};
+
+template <class spin_det_type>
+inline int compute_phase_single_excitation(const phase_mask_t<spin_det_type> &m, int spin,
+                                           uint64_t h, uint64_t p) {
+    return 1 - 2 * static_cast<int>(m.parity(spin, h, p));
+}
+
+// Same spin (2,0) or (0,2) doubles
+template <class spin_det_type>
+inline int compute_phase_double_excitation(const phase_mask_t<spin_det_type> &m, int spin,
+                                           uint64_t h1, uint64_t h2, uint64_t p1, uint64_t p2) {
+    const bool parity =
+        m.parity(spin, h1, p1) ^ m.parity(spin, h2, p2) ^ (h2 < p1) ^ (p2 < h1);
+    return 1 - 2 * static_cast<int>(parity);
+}
+
+// Opposite spin (1,1) doubles, alpha are h1-p1, beta are h2-p2
+template <class spin_det_type>
+inline int compute_phase_double_excitation(const phase_mask_t<spin_det_type> &m, uint64_t h1,
+                                           uint64_t h2, uint64_t p1, uint64_t p2) {
+    const bool parity = m.parity(0, h1, p1) ^ m.parity(1, h2, p2);
+    return 1 - 2 * static_cast<int>(parity);
+}
+
+// Companion array of phase masks for a whole wavefunction (e.g. psi_int). A mask is built the
+// first time its determinant is accessed and then reused, so a kernel can share the cache across
+// all the integrals of its chunk. Not thread safe: use one cache per thread, or build_all() first.
+template <class spin_det_type> class phase_mask_cache_t {
+  public:
+    phase_mask_cache_t(const det_base_t<spin_det_type> *psi, std::size_t N)
+        : m_psi(psi), m_masks(N), m_built(N, false) {}
+
+    const phase_mask_t<spin_det_type> &operator[](std::size_t i) {
+        if (!m_built[i]) {
+            m_masks[i] = phase_mask_t<spin_det_type>(m_psi[i]);
+            m_built[i] = true;
+        }
+        return m_masks[i];
+    }
+
+    void build_all() {
+        for (std::size_t i = 0; i < m_masks.size(); i++)
+            (*this)[i];
+    }
+
+    std::size_t size() const { return m_masks.size(); }
+
+  private:
+    const det_base_t<spin_det_type> *m_psi;
+    std::vector<phase_mask_t<spin_det_type>> m_masks;
+    std::vector<bool> m_built;
+};
+
+template <class spin_det_type>
+det_base_t<spin_det_type> apply_single_excitation(const det_base_t<spin_det_type> &s, int spin,
+                                                  uint64_t hole, uint64_t particle);
 
-spin_det_t apply_spin_single_excitation(spin_det_t s, uint64_t hole, uint64_t particle);
+template <class spin_det_type>
+spin_det_type apply_spin_single_excitation(const spin_det_type &s, uint64_t hole,
+                                           uint64_t particle);
 
-det_t apply_double_excitation(det_t s, std::pair<int> spin, uint64_t h1, uint64_t h2, uint64_t p1,
-                              uint64_t p2);
+template <class spin_det_type>
+det_base_t<spin_det_type> apply_double_excitation(const det_base_t<spin_det_type> &s,
+                                                  std::pair<int, int> spin, uint64_t h1,
+                                                  uint64_t h2, uint64_t p1, uint64_t p2);
 
 typedef std::vector<uint64_t> spin_constraint_t;
 typedef std::pair<spin_constraint_t, spin_constraint_t> exc_constraint_t;
 
-std::string to_string(const spin_constraint_t &c, uint64_t max_orb) {
-    std::string s(max_orb, '0');
+/*
+Word-parallel hole/particle extraction.
 
+A constraint is turned into a bit mask of the same spin type as the determinant by setting its bits
+directly, the occupied (or virtual) orbitals it allows are selected one 64-bit word at a time, and
+their indices are peeled off each word lowest bit first (tzcnt, then clear it with x & (x - 1)).
+*/
+template <class spin_det_type>
+spin_det_type to_constraint_mask(const spin_det_type &like, const spin_constraint_t &c,
+                                 uint64_t max_orb) {
+    spin_det_type mask(like.size());
     for (const auto &i : c)
-        s[i] = '1';
-    return s;
+        if (i < max_orb)
+            mask.set(i);
+    return mask;
 }
 
-spin_constraint_t to_constraint(const spin_det_t &c) {
-    spin_constraint_t res;
-    auto npos = c.npos;
-    auto c_pos = c.find_next(0);
-    while (c_pos < npos) {
-        res.push_back(c_pos);
-        c_pos = c.find_next(0);
+// Append to `out` the orbitals below max_orb that are set in `mask` and occupied (or, if
+// `occupied` is false, unoccupied) in `d`
+template <class spin_det_type, class idx_list_t>
+void extract_orbitals(const spin_det_type &d, const spin_det_type &mask, bool occupied,
+                      uint64_t max_orb, idx_list_t &out) {
+    const uint64_t flip = occupied ? uint64_t(0) : ~uint64_t(0);
+    const auto *b = d.data();
+    const auto *m = mask.data();
+    for (std::size_t w = 0; w < d.num_blocks(); w++) {
+        uint64_t x = (b[w] ^ flip) & m[w] & mask_below(max_orb, w);
+        while (x) {
+            out.push_back(64 * w + __builtin_ctzll(x));
+            x &= x - 1;
+        }
     }
+}
+
+// Indices of the set bits of `c`, in increasing order
+template <class spin_det_type> spin_constraint_t to_constraint(const spin_det_type &c) {
+    spin_constraint_t res;
+    extract_orbitals(c, c, true, c.size(), res);
     return res;
 }
 
-std::vector<det_t> get_constrained_determinants(det_t d, exc_constraint_t constraint,
-                                                uint64_t max_orb);
+// Fixed-capacity list of orbital indices; holds the holes or particles of one spin without
+// touching the heap
+template <std::size_t CAPACITY> class orbital_list_t {
+  public:
+    typedef uint16_t value_type;
+
+    std::size_t size() const { return m_n; }
+    bool empty() const { return m_n == 0; }
+    void clear() { m_n = 0; }
+    void push_back(uint64_t i) {
+        assert(m_n < CAPACITY);
+        m_idx[m_n++] = static_cast<value_type>(i);
+    }
+    uint64_t operator[](std::size_t i) const { return m_idx[i]; }
+    const value_type *begin() const { return m_idx.data(); }
+    const value_type *end() const { return m_idx.data() + m_n; }
+
+  private:
+    std::array<value_type, CAPACITY> m_idx;
+    std::size_t m_n = 0;
+};
+
+// Orbital list used for a spin type: fixed capacity when the number of orbitals is bounded at
+// compile time, a vector for the heap-backed spin_det_t
+template <class spin_det_type> struct orbital_list_type {
+    typedef spin_constraint_t type;
+};
+
+template <std::size_t N_WORDS> struct orbital_list_type<static_spin_det_t<N_WORDS>> {
+    typedef orbital_list_t<64 * N_WORDS> type;
+};
+
+// Hole (occupied) and particle (virtual) orbitals of each spin allowed by an excitation constraint
+template <class spin_det_type> struct exc_lists_t {
+    typedef typename orbital_list_type<spin_det_type>::type list_type;
+    std::array<list_type, N_SPIN_SPECIES> holes;
+    std::array<list_type, N_SPIN_SPECIES> parts;
+};
+
+template <class spin_det_type>
+exc_lists_t<spin_det_type> get_constrained_exc_lists(const det_base_t<spin_det_type> &d,
+                                                     const exc_constraint_t &constraint,
+                                                     uint64_t max_orb);
+
+// Exact number of determinants written by the generate_*_into routines below, so that callers
+// can size their output buffer once per batch
+inline std::size_t n_singles_by_exc_mask(std::size_t n_holes, std::size_t n_particles) {
+    return n_holes * n_particles;
+}
+
+inline std::size_t n_ss_doubles_by_exc_mask(std::size_t n_holes, std::size_t n_particles) {
+    return (n_holes * (n_holes - 1) / 2) * (n_particles * (n_particles - 1) / 2);
+}
+
+/*
+Allocation-free excitation generators.
+
+Each routine writes its excitations of `d` to out[0 .. n), where n is given by the matching
+n_*_by_exc_mask function and must fit in `out`, and returns n. The output determinants are
+assigned in place, so reusing the same buffer (e.g. a det_arena_t) across calls does not allocate,
+even for the heap-backed det_t. `h` and `p` are any indexable lists of hole and particle orbitals.
+*/
+template <class spin_det_type, class idx_list_t>
+std::size_t generate_singles_into(const det_base_t<spin_det_type> &d, int spin, const idx_list_t &h,
+                                  const idx_list_t &p, det_base_t<spin_det_type> *out) {
+    std::size_t n = 0;
+    for (std::size_t i = 0; i < h.size(); i++) {
+        for (std::size_t j = 0; j < p.size(); j++) {
+            auto &e = out[n++];
+            e = d;
+            e[spin][h[i]] = 0;
+            e[spin][p[j]] = 1;
+        }
+    }
+    return n;
+}
+
+template <class spin_det_type, class idx_list_t>
+std::size_t generate_ss_doubles_into(const det_base_t<spin_det_type> &d, int spin,
+                                     const idx_list_t &h, const idx_list_t &p,
+                                     det_base_t<spin_det_type> *out) {
+    std::size_t n = 0;
+    // h, p are sorted so h1 < h2; p1 < p2 always
+    for (std::size_t h1 = 0; h1 < h.size(); h1++) {
+        for (auto h2 = h1 + 1; h2 < h.size(); h2++) {
+            for (std::size_t p1 = 0; p1 < p.size(); p1++) {
+                for (auto p2 = p1 + 1; p2 < p.size(); p2++) {
+                    auto &e = out[n++];
+                    e = d;
+                    e[spin][h[h1]] = 0;
+                    e[spin][h[h2]] = 0;
+                    e[spin][p[p1]] = 1;
+                    e[spin][p[p2]] = 1;
+                }
+            }
+        }
+    }
+    return n;
+}
+
+// (1,1) doubles: every alpha single h_a -> p_a combined with every beta single h_b -> p_b.
+// Writes n_singles_by_exc_mask(alpha) * n_singles_by_exc_mask(beta) determinants.
+template <class spin_det_type, class idx_list_t>
+std::size_t generate_os_doubles_into(const det_base_t<spin_det_type> &d, const idx_list_t &h_a,
+                                     const idx_list_t &p_a, const idx_list_t &h_b,
+                                     const idx_list_t &p_b, det_base_t<spin_det_type> *out) {
+    std::size_t n = 0;
+    for (std::size_t ia = 0; ia < h_a.size(); ia++) {
+        for (std::size_t ja = 0; ja < p_a.size(); ja++) {
+            for (std::size_t ib = 0; ib < h_b.size(); ib++) {
+                for (std::size_t jb = 0; jb < p_b.size(); jb++) {
+                    auto &e = out[n++];
+                    e = d;
+                    e[0][h_a[ia]] = 0;
+                    e[0][p_a[ja]] = 1;
+                    e[1][h_b[ib]] = 0;
+                    e[1][p_b[jb]] = 1;
+                }
+            }
+        }
+    }
+    return n;
+}
+
+// Reusable output buffer for the generators. It only grows, so once it has reached the largest
+// batch size, generating into it performs no allocation.
+template <class spin_det_type> class det_arena_t {
+  public:
+    det_base_t<spin_det_type> *reserve(std::size_t n) {
+        if (m_dets.size() < n)
+            m_dets.resize(n);
+        return m_dets.data();
+    }
+
+    det_base_t<spin_det_type> *data() { return m_dets.data(); }
+    std::size_t capacity() const { return m_dets.size(); }
+
+  private:
+    std::vector<det_base_t<spin_det_type>> m_dets;
+};
+
+/*
+Lazy excitation generator.
+
+Yields the excitations of one determinant one at a time (next) or in fixed-size blocks
+(next_block), in the order: alpha singles, beta singles, alpha-alpha doubles, beta-beta doubles,
+alpha-beta doubles. Only the hole and particle lists are stored, so the connected space (in
+particular the alpha x beta product of opposite spin doubles) is never materialized and a PT2
+pipeline can stream it through a kernel with a bounded buffer:
+
+    excitation_generator_t<spin_det_t> gen(d, constraint, max_orb);
+    std::vector<det_t> block(1024);
+    while (auto n = gen.next_block(block.data(), block.size()))
+        kernel(block.data(), n);
+*/
+template <class spin_det_type> class excitation_generator_t {
+  public:
+    enum exc_kind_e {
+        EXC_SINGLES = 1,
+        EXC_SS_DOUBLES = 2,
+        EXC_OS_DOUBLES = 4,
+        EXC_ALL = EXC_SINGLES | EXC_SS_DOUBLES | EXC_OS_DOUBLES
+    };
+
+    excitation_generator_t(const det_base_t<spin_det_type> &d, exc_lists_t<spin_det_type> lists,
+                           unsigned kinds = EXC_ALL)
+        : m_det(d), m_lists(std::move(lists)), m_kinds(kinds) {
+        reset();
+    }
+
+    excitation_generator_t(const det_base_t<spin_det_type> &d, const exc_constraint_t &constraint,
+                           uint64_t max_orb, unsigned kinds = EXC_ALL)
+        : excitation_generator_t(d, get_constrained_exc_lists(d, constraint, max_orb), kinds) {}
+
+    // Total number of excitations the generator yields from the start
+    std::size_t size() const {
+        std::size_t n = 0;
+        for (int spin = 0; spin < N_SPIN_SPECIES; spin++) {
+            const auto n_h = m_lists.holes[spin].size(), n_p = m_lists.parts[spin].size();
+            n += (m_kinds & EXC_SINGLES) ? n_singles_by_exc_mask(n_h, n_p) : 0;
+            n += (m_kinds & EXC_SS_DOUBLES) ? n_ss_doubles_by_exc_mask(n_h, n_p) : 0;
+        }
+        if (m_kinds & EXC_OS_DOUBLES)
+            n += n_singles_by_exc_mask(m_lists.holes[0].size(), m_lists.parts[0].size()) *
+                 n_singles_by_exc_mask(m_lists.holes[1].size(), m_lists.parts[1].size());
+        return n;
+    }
+
+    void reset() {
+        m_stage = STAGE_SINGLES_A;
+        start_stage();
+    }
+
+    // Write the next excitation to `out`; return false once exhausted
+    bool next(det_base_t<spin_det_type> &out) {
+        if (m_stage == STAGE_DONE)
+            return false;
+        emit(out);
+        if (!advance()) {
+            m_stage++;
+            start_stage();
+        }
+        return true;
+    }
+
+    // Write up to `n` excitations to out[0 .. n); return how many were written (0 once exhausted)
+    std::size_t next_block(det_base_t<spin_det_type> *out, std::size_t n) {
+        std::size_t k = 0;
+        while (k < n && next(out[k]))
+            k++;
+        return k;
+    }
+
+  private:
+    enum stage_e {
+        STAGE_SINGLES_A,
+        STAGE_SINGLES_B,
+        STAGE_DOUBLES_AA,
+        STAGE_DOUBLES_BB,
+        STAGE_DOUBLES_AB,
+        STAGE_DONE
+    };
+
+    det_base_t<spin_det_type> m_det;
+    exc_lists_t<spin_det_type> m_lists;
+    unsigned m_kinds;
+    int m_stage;
+    // odometer over the hole/particle lists of the current stage
+    std::array<std::size_t, 4> m_idx;
+
+    typedef typename exc_lists_t<spin_det_type>::list_type list_type;
+    const list_type &h(int spin) const { return m_lists.holes[spin]; }
+    const list_type &p(int spin) const { return m_lists.parts[spin]; }
+
+    bool stage_enabled() const {
+        switch (m_stage) {
+        case STAGE_SINGLES_A:
+        case STAGE_SINGLES_B:
+            return m_kinds & EXC_SINGLES;
+        case STAGE_DOUBLES_AA:
+        case STAGE_DOUBLES_BB:
+            return m_kinds & EXC_SS_DOUBLES;
+        default:
+            return m_kinds & EXC_OS_DOUBLES;
+        }
+    }
+
+    // Move to the first non-empty enabled stage at or after m_stage
+    void start_stage() {
+        for (; m_stage != STAGE_DONE; m_stage++) {
+            if (!stage_enabled())
+                continue;
+            bool empty;
+            switch (m_stage) {
+            case STAGE_SINGLES_A:
+            case STAGE_SINGLES_B: {
+                const int spin = m_stage - STAGE_SINGLES_A;
+                m_idx = {0, 0, 0, 0};
+                empty = h(spin).empty() || p(spin).empty();
+                break;
+            }
+            case STAGE_DOUBLES_AA:
+            case STAGE_DOUBLES_BB: {
+                const int spin = m_stage - STAGE_DOUBLES_AA;
+                m_idx = {0, 1, 0, 1};
+                empty = h(spin).size() < 2 || p(spin).size() < 2;
+                break;
+            }
+            default:
+                m_idx = {0, 0, 0, 0};
+                empty = h(0).empty() || p(0).empty() || h(1).empty() || p(1).empty();
+            }
+            if (!empty)
+                return;
+        }
+    }
+
+    void emit(det_base_t<spin_det_type> &out) const {
+        out = m_det;
+        const auto &[i0, i1, i2, i3] = m_idx;
+        switch (m_stage) {
+        case STAGE_SINGLES_A:
+        case STAGE_SINGLES_B: {
+            const int spin = m_stage - STAGE_SINGLES_A;
+            out[spin][h(spin)[i0]] = 0;
+            out[spin][p(spin)[i1]] = 1;
+            break;
+        }
+        case STAGE_DOUBLES_AA:
+        case STAGE_DOUBLES_BB: {
+            const int spin = m_stage - STAGE_DOUBLES_AA;
+            out[spin][h(spin)[i0]] = 0;
+            out[spin][h(spin)[i1]] = 0;
+            out[spin][p(spin)[i2]] = 1;
+            out[spin][p(spin)[i3]] = 1;
+            break;
+        }
+        default:
+            out[0][h(0)[i0]] = 0;
+            out[0][p(0)[i1]] = 1;
+            out[1][h(1)[i2]] = 0;
+            out[1][p(1)[i3]] = 1;
+        }
+    }
+
+    // Step the odometer, same order as the generate_*_into routines; false when the stage is over
+    bool advance() {
+        auto &[i0, i1, i2, i3] = m_idx;
+        switch (m_stage) {
+        case STAGE_SINGLES_A:
+        case STAGE_SINGLES_B: {
+            const int spin = m_stage - STAGE_SINGLES_A;
+            if (++i1 < p(spin).size())
+                return true;
+            i1 = 0;
+            return ++i0 < h(spin).size();
+        }
+        case STAGE_DOUBLES_AA:
+        case STAGE_DOUBLES_BB: {
+            const int spin = m_stage - STAGE_DOUBLES_AA;
+            const auto n_h = h(spin).size(), n_p = p(spin).size();
+            if (++i3 < n_p)
+                return true;
+            if (++i2 + 1 < n_p) {
+                i3 = i2 + 1;
+                return true;
+            }
+            i2 = 0;
+            i3 = 1;
+            if (++i1 < n_h)
+                return true;
+            if (++i0 + 1 < n_h) {
+                i1 = i0 + 1;
+                return true;
+            }
+            return false;
+        }
+        default:
+            if (++i3 < p(1).size())
+                return true;
+            i3 = 0;
+            if (++i2 < h(1).size())
+                return true;
+            i2 = 0;
+            if (++i1 < p(0).size())
+                return true;
+            i1 = 0;
+            return ++i0 < h(0).size();
+        }
+    }
+};
+
+/*
+Triplet-constrained excitations.
+
+For a triplet T = (a0, a1, a2) of orbitals of spin `spin`, enumerates exactly the singles and
+doubles J of d whose three highest occupied `spin` orbitals are T, i.e.
+J[spin] & [min(T), n_orb) == T. This is the selection used by
+Powerplant_manager.psi_external_pt2 (see Determinant.triplet_constrained_*_excitations_from_det
+in fundamental_types.py), without post-filtering:
+
+  - the occupied orbitals >= min(T) not in T (X) must all be holes, the orbitals of T that are
+    unoccupied (M) must all be particles; they are applied once to build `m_base`
+  - any other hole or particle of the constrained spin lies below min(T), those of the other spin
+    are unrestricted
+
+so an excitation of degree (k_c, k_o) on (constrained, other) spin picks k_c - |X| free holes and
+k_c - |M| free particles of the constrained spin and k_o of each of the other spin.
+Singles are yielded as (1,0), (0,1) and doubles as (2,0), (0,2), (1,1), as in the Python routines.
+*/
+typedef std::array<uint64_t, 3> triplet_constraint_t;
+
+template <class spin_det_type> class triplet_constrained_exc_t {
+  public:
+    triplet_constrained_exc_t(const det_base_t<spin_det_type> &d, const triplet_constraint_t &t,
+                              uint64_t n_orb, int spin = 0)
+        : m_base(d), m_spin(spin) {
+        const int c = spin, o = 1 - spin;
+        const uint64_t a_min = *std::min_element(t.begin(), t.end());
+
+        spin_det_type t_mask(d[c].size());
+        for (const auto &a : t)
+            t_mask.set(a);
+        const spin_det_type all_mask = ~spin_det_type(d[c].size());
+
+        spin_det_type x_mask = ~t_mask; // orbitals above a_min outside T
+        for (std::size_t w = 0; w < x_mask.num_blocks(); w++)
+            x_mask.data()[w] &= ~mask_below(a_min, w);
+
+        // forced holes X and forced particles M (the unoccupied orbitals of T)
+        orbital_list_type_t forced_h, forced_p;
+        extract_orbitals(d[c], x_mask, true, n_orb, forced_h);
+        extract_orbitals(d[c], t_mask, false, n_orb, forced_p);
+        m_n_forced_h = forced_h.size();
+        m_n_forced_p = forced_p.size();
+        for (const auto &x : forced_h)
+            m_base[c][x] = 0;
+        for (const auto &x : forced_p)
+            m_base[c][x] = 1;
+
+        // free orbitals: below a_min for the constrained spin, anywhere for the other one
+        extract_orbitals(d[c], all_mask, true, a_min, m_h[c]);
+        extract_orbitals(d[c], all_mask, false, a_min, m_p[c]);
+        extract_orbitals(d[o], all_mask, true, n_orb, m_h[o]);
+        extract_orbitals(d[o], all_mask, false, n_orb, m_p[o]);
+    }
+
+    std::size_t n_singles() const { return count(1, 0) + count(0, 1); }
+    std::size_t n_doubles() const { return count(2, 0) + count(0, 2) + count(1, 1); }
+
+    // Write the n_singles() (resp. n_doubles()) excitations to out[0 .. n) and return n
+    std::size_t singles_into(det_base_t<spin_det_type> *out) const {
+        std::size_t n = generate(1, 0, out);
+        return n + generate(0, 1, out + n);
+    }
+
+    std::size_t doubles_into(det_base_t<spin_det_type> *out) const {
+        std::size_t n = generate(2, 0, out);
+        n += generate(0, 2, out + n);
+        return n + generate(1, 1, out + n);
+    }
+
+  private:
+    typedef typename orbital_list_type<spin_det_type>::type orbital_list_type_t;
+
+    det_base_t<spin_det_type> m_base;
+    int m_spin;
+    int m_n_forced_h, m_n_forced_p;
+    std::array<orbital_list_type_t, N_SPIN_SPECIES> m_h, m_p;
+
+    static std::size_t n_choices(std::size_t n, int r) {
+        return (r == 0) ? 1 : (r == 1) ? n : n * (n - 1) / 2;
+    }
+
+    std::size_t count(int k_c, int k_o) const {
+        const int c = m_spin, o = 1 - m_spin;
+        const int r_h = k_c - m_n_forced_h, r_p = k_c - m_n_forced_p;
+        if (r_h < 0 || r_p < 0)
+            return 0;
+        return n_choices(m_h[c].size(), r_h) * n_choices(m_p[c].size(), r_p) *
+               n_choices(m_h[o].size(), k_o) * n_choices(m_p[o].size(), k_o);
+    }
+
+    // Set `r` <= 2 orbitals of `l` in e[spin] to `value` in every possible way, calling f() on each
+    template <class F>
+    static void for_each_choice(det_base_t<spin_det_type> &e, int spin,
+                                const orbital_list_type_t &l, int r, bool value, F &&f) {
+        auto &&s = e[spin];
+        if (r == 0) {
+            f();
+            return;
+        }
+        for (std::size_t i = 0; i < l.size(); i++) {
+            s[l[i]] = value;
+            if (r == 1) {
+                f();
+            } else {
+                for (auto j = i + 1; j < l.size(); j++) {
+                    s[l[j]] = value;
+                    f();
+                    s[l[j]] = !value;
+                }
+            }
+            s[l[i]] = !value;
+        }
+    }
+
+    std::size_t generate(int k_c, int k_o, det_base_t<spin_det_type> *out) const {
+        const int c = m_spin, o = 1 - m_spin;
+        const int r_h = k_c - m_n_forced_h, r_p = k_c - m_n_forced_p;
+        if (r_h < 0 || r_p < 0)
+            return 0;
+        std::size_t n = 0;
+        auto e = m_base;
+        for_each_choice(e, c, m_h[c], r_h, 0, [&] {
+            for_each_choice(e, c, m_p[c], r_p, 1, [&] {
+                for_each_choice(e, o, m_h[o], k_o, 0, [&] {
+                    for_each_choice(e, o, m_p[o], k_o, 1, [&] { out[n++] = e; });
+                });
+            });
+        });
+        return n;
+    }
+};
+
+template <class spin_det_type>
+std::vector<det_base_t<spin_det_type>>
+get_triplet_constrained_singles(const det_base_t<spin_det_type> &d, const triplet_constraint_t &t,
+                                uint64_t n_orb, int spin = 0);
+
+template <class spin_det_type>
+std::vector<det_base_t<spin_det_type>>
+get_triplet_constrained_doubles(const det_base_t<spin_det_type> &d, const triplet_constraint_t &t,
+                                uint64_t n_orb, int spin = 0);
+
+template <class spin_det_type>
+std::vector<det_base_t<spin_det_type>>
+get_constrained_determinants(const det_base_t<spin_det_type> &d, const exc_constraint_t &constraint,
+                             uint64_t max_orb);
 
-std::vector<det_t> get_constrained_singles(det_t d, exc_constraint_t constraint, uint64_t max_orb);
+template <class spin_det_type>
+std::vector<det_base_t<spin_det_type>>
+get_constrained_singles(const det_base_t<spin_det_type> &d, const exc_constraint_t &constraint,
+                        uint64_t max_orb);
 
-std::vector<det_t> get_constrained_ss_doubles(det_t d, exc_constraint_t constraint,
-                                              uint64_t max_orb);
+template <class spin_det_type>
+std::vector<det_base_t<spin_det_type>>
+get_constrained_ss_doubles(const det_base_t<spin_det_type> &d, const exc_constraint_t &constraint,
+                           uint64_t max_orb);
 
-std::vector<det_t> get_constrained_os_doubles(det_t d, exc_constraint_t constraint,
-                                              uint64_t max_orb);
+template <class spin_det_type>
+std::vector<det_base_t<spin_det_type>>
+get_constrained_os_doubles(const det_base_t<spin_det_type> &d, const exc_constraint_t &constraint,
+                           uint64_t max_orb);
 
-std::vector<det_t> get_singles_by_exc_mask(det_t d, int spin, spin_constraint_t h,
-                                           spin_constraint_t p);
+template <class spin_det_type>
+std::vector<det_base_t<spin_det_type>> get_singles_by_exc_mask(const det_base_t<spin_det_type> &d,
+                                                               int spin, const spin_constraint_t &h,
+                                                               const spin_constraint_t &p);
 
-std::vector<spin_det_t> get_spin_singles_by_exc_mask(spin_det_t d, spin_constraint_t h,
-                                                     spin_constraint_t p);
+template <class spin_det_type>
+std::vector<spin_det_type> get_spin_singles_by_exc_mask(const spin_det_type &d,
+                                                        const spin_constraint_t &h,
+                                                        const spin_constraint_t &p);
 
-std::vector<det_t> get_ss_doubles_by_exc_mask(det_t d, int spin, spin_constraint_t h,
-                                              spin_constraint_t p);
+template <class spin_det_type>
+std::vector<det_base_t<spin_det_type>>
+get_ss_doubles_by_exc_mask(const det_base_t<spin_det_type> &d, int spin, const spin_constraint_t &h,
+                           const spin_constraint_t &p);
 
-std::vector<det_t> get_all_singles(det_t d);
+template <class spin_det_type>
+std::vector<det_base_t<spin_det_type>> get_all_singles(const det_base_t<spin_det_type> &d,
+                                                       uint64_t max_orb);
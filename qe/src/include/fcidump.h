@@ -0,0 +1,44 @@
+#pragma once
+#include "integral_types.h"
+#include <array>
+#include <string>
+#include <thread>
+#include <vector>
+
+/*
+Hamiltonian integrals of an FCIDUMP file, in arrays.
+
+The one-electron integrals are a dense, symmetric n_orb x n_orb matrix. The two-electron
+integrals are split by category: two_e_idx[c] holds the distinct compound indices of category c
+in increasing order, and two_e_val[c] their values. As in qe/io.py, the last value read wins when
+an integral appears more than once.
+*/
+struct fcidump_t {
+    idx_t n_orb = 0;
+    double E0 = 0;
+    // one_e[i * n_orb + k] = <i|h|k>
+    std::vector<double> one_e;
+    std::array<std::vector<idx_t>, N_CATEGORIES> two_e_idx;
+    std::array<std::vector<double>, N_CATEGORIES> two_e_val;
+};
+
+/*
+Read an FCIDUMP file, plain or compressed with gzip or bzip2 (by .bz2 extension).
+
+The decompressed text is streamed through a buffer of block_size bytes. Each block, cut at its
+last newline, is parsed by n_threads threads, each taking a slice of its lines. Throws
+std::runtime_error when the file cannot be read or a line cannot be parsed.
+*/
+fcidump_t load_fcidump(const std::string &path,
+                       unsigned n_threads = std::thread::hardware_concurrency(),
+                       std::size_t block_size = std::size_t(1) << 26);
+
+// C ABI over load_fcidump for ctypes: fcidump_load returns nullptr (and prints the reason) on error
+extern "C" fcidump_t *fcidump_load(const char *path, int n_threads);
+extern "C" void fcidump_free(fcidump_t *f);
+extern "C" idx_t fcidump_n_orb(const fcidump_t *f);
+extern "C" double fcidump_E0(const fcidump_t *f);
+extern "C" const double *fcidump_one_e(const fcidump_t *f);
+extern "C" idx_t fcidump_two_e_size(const fcidump_t *f, int category);
+extern "C" const idx_t *fcidump_two_e_idx(const fcidump_t *f, int category);
+extern "C" const double *fcidump_two_e_val(const fcidump_t *f, int category);
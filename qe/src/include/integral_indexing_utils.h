@@ -1,11 +1,24 @@
 #pragma once
 #include <cmath>
+#include <cstdint>
+#include <vector>
 
 typedef long long int idx_t;
 
 enum j_category { IC_A, IC_B, IC_C, IC_D, IC_E, IC_F, IC_G };
 
-idx_t isqrt(const idx_t i) { return (idx_t)std::sqrt(i); }
+// Exact floor(sqrt(n)) for 0 <= n < 2^63. The double precision square root is correctly rounded,
+// hence exact below 2^52; above, n itself is rounded and the estimate, within one of the result,
+// is corrected with integer arithmetic
+inline idx_t isqrt(const idx_t n) {
+    const uint64_t u = n;
+    uint64_t r = (idx_t)std::sqrt((double)n);
+    if (n >= ((idx_t)1 << 52)) {
+        r -= r * r > u;
+        r += (r + 1) * (r + 1) <= u;
+    }
+    return r;
+}
 
 extern "C" idx_t compound_idx2(const idx_t i, const idx_t j);
 
@@ -49,6 +62,51 @@ struct ijkl_perms {
     struct ijkl_tuple jkli;
 };
 
+// Inline forms of compound_idx2_reverse and compound_idx4_reverse below, for the kernels.
+// Exact for ij < 2^60.
+inline ij_tuple idx2_reverse(const idx_t ij) {
+    // j(j + 1) / 2 in unsigned arithmetic, which GCC vectorizes in loops
+    const uint64_t j = (isqrt(1 + 8 * ij) - 1) / 2;
+    return {(idx_t)(ij - j * (j + 1) / 2), (idx_t)j};
+}
+
+inline ijkl_tuple idx4_reverse(const idx_t ijkl) {
+    const ij_tuple ik_jl = idx2_reverse(ijkl);
+    const ij_tuple ik = idx2_reverse(ik_jl.i);
+    const ij_tuple jl = idx2_reverse(ik_jl.j);
+    return {ik.i, jl.i, ik.j, jl.j};
+}
+
+/*
+Reverse compound indices of a fixed number of orbitals with a table of the n_orb (n_orb + 1) / 2
+orbital pairs: compound_idx4_reverse then takes one square root (for the pair of pairs) and two
+table loads instead of three square roots.
+*/
+class compound_idx_table_t {
+  public:
+    compound_idx_table_t(const idx_t n_orb) : m_pairs(n_orb * (n_orb + 1) / 2) {
+        for (idx_t j = 0; j < n_orb; j++)
+            for (idx_t i = 0; i <= j; i++)
+                m_pairs[j * (j + 1) / 2 + i] = {i, j};
+    }
+
+    idx_t n_pairs() const { return m_pairs.size(); }
+
+    // ij < n_pairs()
+    const ij_tuple &idx2_reverse(const idx_t ij) const { return m_pairs[ij]; }
+
+    // ijkl < n_pairs() * (n_pairs() + 1) / 2
+    ijkl_tuple idx4_reverse(const idx_t ijkl) const {
+        const ij_tuple ik_jl = ::idx2_reverse(ijkl);
+        const ij_tuple &ik = m_pairs[ik_jl.i];
+        const ij_tuple &jl = m_pairs[ik_jl.j];
+        return {ik.i, jl.i, ik.j, jl.j};
+    }
+
+  private:
+    std::vector<ij_tuple> m_pairs;
+};
+
 // Would like to use std::tuple here but not handled in ctypes. Easier to use
 // structs for now.
 extern "C" struct ijkl_tuple canonical_idx4(const idx_t i, const idx_t j, const idx_t k,
@@ -61,4 +119,19 @@ extern "C" struct ijkl_tuple compound_idx4_reverse(const idx_t ijkl);
 extern "C" struct ijkl_perms compound_idx4_reverse_all(const idx_t ijkl);
 
 idx_t compound_idx4(const ijkl_tuple ijkl);
+
+// Element-wise forms of the functions above over arrays of n indices
+extern "C" void compound_idx2_batch(const idx_t *i, const idx_t *j, idx_t *ij, const idx_t n);
+
+extern "C" void compound_idx4_batch(const idx_t *i, const idx_t *j, const idx_t *k,
+                                    const idx_t *l, idx_t *ijkl, const idx_t n);
+
+extern "C" void canonical_idx4_batch(const idx_t *i, const idx_t *j, const idx_t *k,
+                                     const idx_t *l, idx_t *out_i, idx_t *out_j, idx_t *out_k,
+                                     idx_t *out_l, const idx_t n);
+
+extern "C" void compound_idx2_reverse_batch(const idx_t *ij, idx_t *i, idx_t *j, const idx_t n);
+
+extern "C" void compound_idx4_reverse_batch(const idx_t *ijkl, idx_t *i, idx_t *j, idx_t *k,
+                                            idx_t *l, const idx_t n);
 // extern "C" int get_unique_idx4(ijkl_tuple* u_idx, const ijkl_perms all_idx);
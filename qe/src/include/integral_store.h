@@ -0,0 +1,79 @@
+#pragma once
+#include "fcidump.h"
+#include <cstdint>
+#include <string>
+
+/*
+Binary integral store: the content of an fcidump_t, written once and memory-mapped afterwards.
+
+Layout (native endianness, every section 64-byte aligned):
+    integral_store_header_t
+    one-electron integrals: n_orb * n_orb doubles
+    for each category A-G: count compound indices (int64), then count values (double)
+The header records the offset of each section, so readers need no other knowledge of the layout.
+INTEGRAL_STORE_VERSION changes with any change of the layout.
+*/
+constexpr uint64_t INTEGRAL_STORE_VERSION = 1;
+constexpr char INTEGRAL_STORE_MAGIC[8] = {'Q', 'E', 'I', 'N', 'T', 'S', 0, 0};
+
+struct integral_store_header_t {
+    char magic[8];
+    uint64_t version;
+    uint64_t file_size;
+    int64_t n_orb;
+    double E0;
+    uint64_t one_e_offset;
+    struct {
+        uint64_t count;
+        uint64_t idx_offset;
+        uint64_t val_offset;
+    } categories[N_CATEGORIES];
+};
+
+// Write f to path (through a temporary file renamed at the end). Throws std::runtime_error.
+void write_integral_store(const std::string &path, const fcidump_t &f);
+
+// The integrals of one category, sorted by compound index
+struct two_e_section_t {
+    const idx_t *idx = nullptr;
+    const double *val = nullptr;
+    idx_t size = 0;
+};
+
+/*
+Read-only shared mapping of a store: the arrays are views of the mapped pages, which processes
+mapping the same file share. Throws std::runtime_error for a missing, truncated or incompatible
+file.
+*/
+class integral_store_t {
+  public:
+    explicit integral_store_t(const std::string &path);
+    ~integral_store_t();
+    integral_store_t(const integral_store_t &) = delete;
+    integral_store_t &operator=(const integral_store_t &) = delete;
+
+    idx_t n_orb() const { return header().n_orb; }
+    double E0() const { return header().E0; }
+    // one_e()[i * n_orb() + k] = <i|h|k>
+    const double *one_e() const { return at<double>(header().one_e_offset); }
+    two_e_section_t two_e(int category) const {
+        const auto &c = header().categories[category];
+        return {at<idx_t>(c.idx_offset), at<double>(c.val_offset), (idx_t)c.count};
+    }
+
+  private:
+    const integral_store_header_t &header() const {
+        return *static_cast<const integral_store_header_t *>(m_data);
+    }
+    template <class T> const T *at(uint64_t offset) const {
+        return reinterpret_cast<const T *>(static_cast<const char *>(m_data) + offset);
+    }
+
+    void *m_data = nullptr;
+    std::size_t m_size = 0;
+};
+
+// C ABI for ctypes. integral_store_write_fcidump converts an FCIDUMP file to a store and returns
+// 0, or -1 (printing the reason) on error.
+extern "C" int integral_store_write_fcidump(const char *fcidump_path, const char *store_path,
+                                            int n_threads);
@@ -1,7 +1,61 @@
+#pragma once
 #include "integral_indexing_utils.h"
+#include <array>
 
 // Could make this a member function of the ijkl tuple, if subclassed into
 // canonical vs non-canonical tuples
 extern "C" char integral_category(idx_t i, idx_t j, idx_t k, idx_t l);
 
-template <typename T> int sgn(T val) { return (T(0) < val) - (val < T(0)); }
\ No newline at end of file
+constexpr int N_CATEGORIES = IC_G + 1;
+
+template <typename T> int sgn(T val) { return (T(0) < val) - (val < T(0)); }
+
+/*
+Category of a canonical (i, j, k, l) as a function of which of its indices are equal: bit 0 is
+i == j, then i == k, i == l, j == k, j == l and k == l. The table holds the category of each of the
+64 equality masks, so classification is six comparisons and a load.
+*/
+constexpr std::array<j_category, 64> make_category_table() {
+    std::array<j_category, 64> table{};
+    for (int m = 0; m < 64; m++) {
+        const bool ij = m & 1, ik = m & 2, il = m & 4, jk = m & 8, jl = m & 16, kl = m & 32;
+        if (il)
+            table[m] = IC_A;
+        else if (ik && jl)
+            table[m] = IC_B;
+        else if (ik || jl)
+            table[m] = jk ? IC_D : IC_C;
+        else if (jk)
+            table[m] = IC_E;
+        else if (ij && kl)
+            table[m] = IC_F;
+        else if (ij || kl)
+            table[m] = IC_E;
+        else
+            table[m] = IC_G;
+    }
+    return table;
+}
+
+inline constexpr std::array<j_category, 64> category_table = make_category_table();
+
+inline j_category category_idx4(const idx_t i, const idx_t j, const idx_t k, const idx_t l) {
+    const int m = (i == j) | (i == k) << 1 | (i == l) << 2 | (j == k) << 3 | (j == l) << 4 |
+                  (k == l) << 5;
+    return category_table[m];
+}
+
+inline j_category category_idx4(const ijkl_tuple &t) { return category_idx4(t.i, t.j, t.k, t.l); }
+
+// Categories of the n compound indices ijkl (j_category is a 32-bit int)
+extern "C" void integral_category_batch(const idx_t *ijkl, j_category *cat, const idx_t n);
+
+// Categories of the n tuples (i[x], j[x], k[x], l[x]), taken in canonical order. Returns the number
+// of tuples that were not canonical.
+extern "C" idx_t integral_category_ijkl_batch(const idx_t *i, const idx_t *j, const idx_t *k,
+                                              const idx_t *l, j_category *cat, const idx_t n);
+
+// Stable partition of the n compound indices ijkl by category: the indices of category c are
+// written to out[offsets[c] .. offsets[c + 1]), offsets holding IC_G + 2 entries
+extern "C" void integral_category_partition(const idx_t *ijkl, const idx_t n, idx_t *out,
+                                            idx_t *offsets);
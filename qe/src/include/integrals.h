@@ -1,74 +1,200 @@
 #pragma once
+#include <algorithm>
 #include <array>
 #include <determinant.h>
-#include <integral_indexing_utils.h>
+#include <integral_types.h>
+#include <psi_block.h>
+#include <psi_index.h>
+#include <stdexcept>
 #include <tuple>
 
-// Abstract storage object for 1 and 2 electron integrals
+/*
+Abstract storage object for 1 and 2 electron integrals: a chunk owns the compound indices
+[sidx, eidx), stored densely in `integrals`. Lookups of indices it does not own give null_J.
+orbital_mask and active_orbitals hold the orbitals appearing in the owned integrals, so that
+determinants the chunk cannot touch are skipped with det_in_chunk.
+*/
 template <class T> class JChunk {
 
   public:
-    std::vector<T> integrals;           // this will break, how to create constructor?
+    std::vector<T> integrals;           // integrals[ij - sidx] is integral ij
     spin_det_t orbital_mask;            // cheap bit mask filter for owned orbitals
-    std::vector<idx_T> active_orbitals; // list of owned orbitals
+    std::vector<idx_t> active_orbitals; // list of owned orbitals
     idx_t N_orb;                        // number of orbitals
+    idx_t sidx, eidx;                   // owned compound indices [sidx, eidx)
     T null_J = 0;
 
-    bool det_in_chunk(const spin_det_t &s) { return (active_orbitals & s).any(); }
+    bool det_in_chunk(const spin_det_t &s) const { return orbital_mask.intersects(s); }
 
-    bool owns_index(const idx_t i){return (i >= sidx) && (i < eidx)};
-}
+    bool owns_index(const idx_t i) const { return (i >= sidx) && (i < eidx); }
+
+    // Set the n integrals of compound indices idx to val (e.g. the arrays of an fcidump_t or an
+    // integral_store_t), skipping the ones not owned
+    void assign(const idx_t *idx, const T *val, const idx_t n) {
+        for (idx_t p = 0; p < n; p++)
+            if (owns_index(idx[p]))
+                integrals[idx[p] - sidx] = val[p];
+    }
+
+  protected:
+    JChunk(const idx_t N_orb, const idx_t sidx, const idx_t eidx, const idx_t n_idx)
+        : orbital_mask(N_orb), N_orb(N_orb), sidx(sidx), eidx(eidx) {
+        if (N_orb < 0 || sidx < 0 || sidx > eidx || eidx > n_idx)
+            throw std::invalid_argument("JChunk: invalid range of compound indices");
+        integrals.resize(eidx - sidx);
+    }
+
+    void set_active_orbitals() {
+        for (idx_t o = 0; o < N_orb; o++)
+            if (orbital_mask[o])
+                active_orbitals.push_back(o);
+    }
+};
 
 // one electron integrals
-template <class T>
-JChunk : OEJ {
+template <class T> class OEJ : public JChunk<T> {
   public:
-    T &operator[](idx_t ij) { return integrals[ij]; }
-    const T &operator[](const idx_t ij) const { return integrals[ij]; }
+    using JChunk<T>::owns_index;
 
-    T &operator()(idx_t i, idx_t j) {
-        idx_t ij = compound_idx2(i, j);
-        return integrals[ij];
-        // return owns_idx(ij) ? integrals[ij] : null_J;
+    static idx_t n_integrals(const idx_t N_orb) { return N_orb * (N_orb + 1) / 2; }
+
+    explicit OEJ(const idx_t N_orb) : OEJ(N_orb, 0, n_integrals(N_orb)) {}
+    OEJ(const idx_t N_orb, const idx_t sidx, const idx_t eidx)
+        : JChunk<T>(N_orb, sidx, eidx, n_integrals(N_orb)) {
+        for (idx_t ij = sidx; ij < eidx; ij++) {
+            const ij_tuple o = idx2_reverse(ij);
+            this->orbital_mask.set(o.i);
+            this->orbital_mask.set(o.j);
+        }
+        this->set_active_orbitals();
+    }
+
+    // Take the owned integrals from a dense N_orb x N_orb matrix (e.g. fcidump_t::one_e)
+    void assign_dense(const T *one_e) {
+        for (idx_t ij = this->sidx; ij < this->eidx; ij++) {
+            const ij_tuple o = idx2_reverse(ij);
+            (*this)[ij] = one_e[o.i * this->N_orb + o.j];
+        }
     }
+
+    T &operator[](idx_t ij) { return this->integrals[ij - this->sidx]; }
+    const T &operator[](const idx_t ij) const { return this->integrals[ij - this->sidx]; }
+
     const T &operator()(const idx_t i, const idx_t j) const {
         idx_t ij = compound_idx2(i, j);
-        return integrals[ij];
-        // return owns_idx(ij) ? integrals[ij] : null_J;
+        return owns_index(ij) ? (*this)[ij] : this->null_J;
     }
 
     // in practice, likely that one electron integrals will be owned by a single worker
-    bool owns_index(const idx_t i, const idx_t j) {
+    bool owns_index(const idx_t i, const idx_t j) const {
         idx_t ij = compound_idx2(i, j);
         return owns_index(ij);
     }
-}
+};
 
 // two electron integrals
-// integrals are packaged
-template <class T> JChunk : TEJ {
+// integrals are packaged by compound index, so a chunk can hold integrals of several categories
+template <class T> class TEJ : public JChunk<T> {
 
   public:
-    std::tuple<j_category> owned_categories; // identities of chunk for dispatching
+    using JChunk<T>::owns_index;
 
-    T &operator[](idx_t ijkl) { return integrals[ijkl - internal_offset]; }
-    const T &operator[](const idx_t ijkl) const { return integrals[ijkl - internal_offset]; }
+    // identities of chunk for dispatching: owned_categories[c] when the chunk holds integrals of
+    // category c
+    std::array<bool, N_CATEGORIES> owned_categories{};
 
-    T &operator()(idx_t i, idx_t j, idx_t k, idx_t l) {
-        idx_t ijkl = compound_idx4(i, j, k, l);
-        return owns_idx(ijkl) ? integrals[ijkl] : null_J;
+    static idx_t n_integrals(const idx_t N_orb) {
+        const idx_t n_pairs = N_orb * (N_orb + 1) / 2;
+        return n_pairs * (n_pairs + 1) / 2;
+    }
+
+    explicit TEJ(const idx_t N_orb) : TEJ(N_orb, 0, n_integrals(N_orb)) {}
+    TEJ(const idx_t N_orb, const idx_t sidx, const idx_t eidx)
+        : JChunk<T>(N_orb, sidx, eidx, n_integrals(N_orb)) {
+        for (idx_t ijkl = sidx; ijkl < eidx; ijkl++) {
+            const ijkl_tuple o = idx4_reverse(ijkl);
+            for (const idx_t orb : {o.i, o.j, o.k, o.l})
+                this->orbital_mask.set(orb);
+            owned_categories[category_idx4(o)] = true;
+        }
+        this->set_active_orbitals();
     }
+
+    T &operator[](idx_t ijkl) { return this->integrals[ijkl - this->sidx]; }
+    const T &operator[](const idx_t ijkl) const { return this->integrals[ijkl - this->sidx]; }
+
     const T &operator()(const idx_t i, const idx_t j, const idx_t k, const idx_t l) const {
         idx_t ijkl = compound_idx4(i, j, k, l);
-        return owns_idx(ijkl) ? integrals[ijkl] : null_J;
+        return owns_index(ijkl) ? (*this)[ijkl] : this->null_J;
     }
 
-    bool owns_index(const idx_t i, const idx_t j, const idx_t k, const idx_t l) {
-        struct ijkl_tuple ijkl = canonical_idx(i, j, k, l);
+    bool owns_index(const idx_t i, const idx_t j, const idx_t k, const idx_t l) const {
+        return owns_index(compound_idx4(i, j, k, l));
+    }
+};
 
-        return owns_index(compound_idx4(ijkl));
+/*
+Non-owning two electron integrals of one category: the sorted compound indices and values of a
+section of an integral store (integral_store_t::two_e(c)), of an fcidump_t or of a sparse_tej_t,
+used in place. J(), J_ind() and size() are the (J, J_ind, N) arguments of the category's kernel,
+so a memory-mapped store feeds the kernels without copying any integral. Lookups are binary
+searches; the orbital mask and list are built from the indices on construction, as for TEJ.
+*/
+template <class T> class TEJView {
+  public:
+    spin_det_t orbital_mask;            // cheap bit mask filter for owned orbitals
+    std::vector<idx_t> active_orbitals; // list of owned orbitals
+    idx_t N_orb;                        // number of orbitals
+    j_category category;
+    T null_J = 0;
+
+    TEJView(const idx_t N_orb, const j_category category, const idx_t *J_ind, const T *J,
+            const idx_t N)
+        : orbital_mask(N_orb), N_orb(N_orb), category(category), m_J_ind(J_ind), m_J(J), m_N(N) {
+        if (N_orb < 0 || category < IC_A || category > IC_G || N < 0)
+            throw std::invalid_argument("TEJView: invalid arguments");
+        for (idx_t p = 0; p < N; p++) {
+            const ijkl_tuple o = idx4_reverse(J_ind[p]);
+            for (const idx_t orb : {o.i, o.j, o.k, o.l})
+                orbital_mask.set(orb);
+        }
+        for (idx_t o = 0; o < N_orb; o++)
+            if (orbital_mask[o])
+                active_orbitals.push_back(o);
+    }
+
+    // A section with members idx, val and size, e.g. a two_e_section_t
+    template <class section_type>
+    TEJView(const idx_t N_orb, const j_category category, const section_type &section)
+        : TEJView(N_orb, category, section.idx, section.val, section.size) {}
+
+    const T *J() const { return m_J; }
+    const idx_t *J_ind() const { return m_J_ind; }
+    idx_t size() const { return m_N; }
+
+    bool det_in_chunk(const spin_det_t &s) const { return orbital_mask.intersects(s); }
+
+    bool owns_index(const idx_t ijkl) const { return find(ijkl) != m_N; }
+    bool owns_index(const idx_t i, const idx_t j, const idx_t k, const idx_t l) const {
+        return owns_index(compound_idx4(i, j, k, l));
+    }
+
+    const T &operator()(const idx_t i, const idx_t j, const idx_t k, const idx_t l) const {
+        const idx_t p = find(compound_idx4(i, j, k, l));
+        return p != m_N ? m_J[p] : null_J;
     }
-}
+
+  private:
+    // position of ijkl in J_ind, or size()
+    idx_t find(const idx_t ijkl) const {
+        const idx_t *it = std::lower_bound(m_J_ind, m_J_ind + m_N, ijkl);
+        return (it != m_J_ind + m_N && *it == ijkl) ? it - m_J_ind : m_N;
+    }
+
+    const idx_t *m_J_ind;
+    const T *m_J;
+    idx_t m_N;
+};
 
 /*
  Kernels for performing integral driven calculations
@@ -79,6 +205,14 @@ template <class T> JChunk : TEJ {
  root worker will iterate through all of its work and everyone else will just dispatch to G kernel
 */
 
+// d with orbitals a and b of `spin` flipped, i.e. the determinant reached by the single a <-> b
+template <class spin_det_type>
+det_base_t<spin_det_type> flip_pair(det_base_t<spin_det_type> d, int spin, idx_t a, idx_t b) {
+    d[spin].flip(a);
+    d[spin].flip(b);
+    return d;
+}
+
 // One electron contributions
 template <class T>
 void e_pt2_ii_OE(T *J, idx_t N_orb, const T E0, det_t *psi_ext, idx_t N_ext, T *res) {
@@ -99,36 +233,35 @@ void e_pt2_ij_OE(T *J, idx_t N, det_t *psi_int, idx_t N_int, det_t *psi_ext, idx
     // Contribution to numerator from one electron integrals
     for (auto i = 0; i < N; i++) { // loop over all integrals
 
-        struct ij_tuple ij = compound_idx2_reverse(i);
+        struct ij_tuple ij = idx2_reverse(i);
         // loop over internal determinants and check if orb_i is occupied in either spin
         for (auto det_i = 0; det_i < N_int; det_i++) {
+            auto &int_det = psi_int[det_i];
 
             // i must be occupied only in int_det; j only in det_j
-            bool i_alpha = int_det.alpha[ij.i] && ~int_det.alpha[ij.j];
-            bool i_beta = int_det.beta[ij.i] && ~int_det.beta[ij.j];
+            bool i_alpha = int_det.alpha[ij.i] && !int_det.alpha[ij.j];
+            bool i_beta = int_det.beta[ij.i] && !int_det.beta[ij.j];
             if (!(i_alpha || i_beta))
                 continue;
 
             // loop over external determinants
-            for (auto det_j = 0; det_j < N; det_j++) {
+            for (auto det_j = 0; det_j < N_ext; det_j++) {
                 auto &ext_det = psi_ext[det_j];
-                std::array<int, N_species> exc_degree = int_det.exc_degree(ext_det);
-                if ((exc_degree[0] + exc_degree[1]) != 1)
+                const auto exc = get_excitation_info(int_det, ext_det);
+                if (exc.order() != 1)
                     continue; // determinants not related by single exc
 
-                bool j_check = exc_degree[0] ? (~ext_det.alpha[ij.i] && ext_det.alpha[ij.j])
-                                             : (~ext_det.beta[ij.i] && ext_det.beta[ij.j]);
-                if (~j_check)
+                // i must be the hole and j the particle
+                const int spin = exc.degree[1];
+                if ((idx_t)exc.holes[spin][0] != ij.i || (idx_t)exc.parts[spin][0] != ij.j)
                     continue; // integral doesn't apply
 
-                int phase = compute_phase_single_excitation(int_det[exc_degree[1]], ij.i, ij.j);
+                int phase = compute_phase_single_excitation(int_det[spin], ij.i, ij.j);
                 res[det_j] += phase * J[i];
             }
         }
     }
-
-    return res;
-};
+}
 
 // Two electron contributions
 /*
@@ -158,7 +291,7 @@ TODO: determine level of const needed
 A: J_qqqq only has one contribution (to the denominator), when q is occupied in both spins
 Contribution is part of product terms
 */
-template <class T> void A_pt2_kernel(T *J, idx_t N, det_t *psi_ext, idx_t N_ext, T *res) {
+template <class T> void A_pt2_kernel(const T *J, idx_t N, det_t *psi_ext, idx_t N_ext, T *res) {
     // Contributes to denominator of pt2 energy
 
     // iterate over external determinants first since A chunk is almost always smaller
@@ -173,6 +306,18 @@ template <class T> void A_pt2_kernel(T *J, idx_t N, det_t *psi_ext, idx_t N_ext,
     }
 }
 
+// A kernel over a structure-of-arrays block: integral i only reads word i / 64 of each spin, so the
+// loop over determinants is contiguous and vectorizes
+template <class T, std::size_t N_WORDS>
+void A_pt2_kernel(const T *J, idx_t N, const psi_block_view<N_WORDS> &psi_ext, T *res) {
+    for (auto i = 0; i < N; i++) {
+        const uint64_t *a = psi_ext.alpha(i / 64), *b = psi_ext.beta(i / 64);
+        const int shift = i % 64;
+        for (std::size_t d_e = 0; d_e < psi_ext.size(); d_e++)
+            res[d_e] += ((a[d_e] & b[d_e]) >> shift & 1) * J[i];
+    }
+}
+
 /*
 B: J_qqrr has the following contributions (to the denominator):
     B_1) q_a -> q_a, r_b -> r_b
@@ -180,11 +325,11 @@ B: J_qqrr has the following contributions (to the denominator):
 
 Contributions are part of combination terms
 */
-temp template <class T>
-void B_pt2_kernel(T *J, idx_t *J_ind, idx_t N, det_t *psi_ext, idx_t N_ext, T *res) {
+template <class T>
+void B_pt2_kernel(const T *J, const idx_t *J_ind, idx_t N, det_t *psi_ext, idx_t N_ext, T *res) {
     // Contributes to denominator of pt2 energy
     for (auto i = 0; i < N; i++) {
-        struct ijkl_tuple c_idx = compound_idx4_reverse(J_ind[i]);
+        struct ijkl_tuple c_idx = idx4_reverse(J_ind[i]);
 
         // index already in standard form: J_ijij -> J_qrqr
         idx_t q, r;
@@ -200,7 +345,30 @@ void B_pt2_kernel(T *J, idx_t *J_ind, idx_t N, det_t *psi_ext, idx_t N_ext, T *r
     }
 }
 
-void map_idx_C(const ijkl_tuple idx, idx_t &q, idx_t &r, idx_t &s) {
+// Occupation of both q and r in one spin of every determinant of a block, written to occ[0 .. n)
+template <std::size_t N_WORDS>
+void pair_occupation(const psi_block_view<N_WORDS> &psi, int spin, idx_t q, idx_t r,
+                     uint8_t *occ) {
+    const uint64_t *x = psi.spin(spin, q / 64), *y = psi.spin(spin, r / 64);
+    const int sq = q % 64, sr = r % 64;
+    for (std::size_t d = 0; d < psi.size(); d++)
+        occ[d] = (x[d] >> sq) & (y[d] >> sr) & 1;
+}
+
+template <class T, std::size_t N_WORDS>
+void B_pt2_kernel(const T *J, const idx_t *J_ind, idx_t N, const psi_block_view<N_WORDS> &psi_ext,
+                  T *res) {
+    std::vector<uint8_t> occ_a(psi_ext.size()), occ_b(psi_ext.size());
+    for (auto i = 0; i < N; i++) {
+        struct ijkl_tuple c_idx = idx4_reverse(J_ind[i]);
+        pair_occupation(psi_ext, 0, c_idx.i, c_idx.j, occ_a.data());
+        pair_occupation(psi_ext, 1, c_idx.i, c_idx.j, occ_b.data());
+        for (std::size_t d_e = 0; d_e < psi_ext.size(); d_e++)
+            res[d_e] += (occ_a[d_e] + occ_b[d_e]) * J[i];
+    }
+}
+
+inline void map_idx_C(const ijkl_tuple idx, idx_t &q, idx_t &r, idx_t &s) {
     if (idx.i == idx.k) {
         q = idx.i;
         r = idx.j;
@@ -212,6 +380,23 @@ void map_idx_C(const ijkl_tuple idx, idx_t &q, idx_t &r, idx_t &s) {
     }
 }
 
+/*
+Internal determinants of a block in array-of-structures form, and for each the external
+determinants it is connected to by a single or a double excitation, found once with the SIMD
+filter_connected for all the integrals of a chunk
+*/
+template <std::size_t N_WORDS>
+void connect_blocks(const psi_block_view<N_WORDS> &psi_int, const psi_block_view<N_WORDS> &psi_ext,
+                    std::vector<static_det_t<N_WORDS>> &dets_int,
+                    std::vector<connected_idx_t> &connected) {
+    dets_int.resize(psi_int.size());
+    connected.assign(psi_int.size(), connected_idx_t{});
+    for (std::size_t d_i = 0; d_i < psi_int.size(); d_i++) {
+        dets_int[d_i] = psi_int[d_i];
+        filter_connected(dets_int[d_i], psi_ext, connected[d_i]);
+    }
+}
+
 /*
 C: J_qrqs has the following contributions, singles of form hipi:
     C1s) r_a -> s_a; q occupied in a
@@ -223,9 +408,32 @@ C: J_qrqs has the following contributions, singles of form hipi:
     C4s) s_b -> r_b; q occupied in a
     C4o) s_b -> r_b; q occupied in b
 */
+// Factor of J_qrqs in the contribution of d_int to d_ext, given the flags c13, c24 of d_int
+template <class det_type>
+int C_pt2_coefficient(const det_type &d_int, const det_type &d_ext, idx_t q, idx_t r, idx_t s,
+                      bool c13, bool c24) {
+    const bool q_a = d_ext[0][q] && d_int[0][q];
+    const bool q_b = d_ext[1][q] && d_int[1][q];
+    if (!(q_a || q_b)) // q must be occupied in beta/alpha simultaneously
+        return 0;
+
+    // degree, holes and particles in one pass, stopping early once above a single
+    const auto exc = get_excitation_info(d_int, d_ext);
+    if (exc.order() != 1) // |d_i> and |d_e> not related by a single excitation
+        return 0;
+
+    // TODO: consider branchless? Profile and see
+    int coefficient = 0;
+    if (c13 && exc.involves(0, r) && exc.involves(0, s))
+        coefficient += (q_a + q_b) * compute_phase_single_excitation(d_int[0], r, s);
+    if (c24 && exc.involves(1, r) && exc.involves(1, s))
+        coefficient += (q_a + q_b) * compute_phase_single_excitation(d_int[1], r, s);
+    return coefficient;
+}
+
 template <class T>
-void C_pt2_kernel(T *J, idx_t *J_ind, idx_t N, det_t *psi_int, idx_t N_int, det_t *psi_ext,
-                  idx_t N_ext, T *res) {
+void C_pt2_kernel(const T *J, const idx_t *J_ind, idx_t N, det_t *psi_int, idx_t N_int,
+                  det_t *psi_ext, idx_t N_ext, T *res) {
     /*
     J is array of integral values
     J_ind is array of integral compound indices
@@ -241,7 +449,7 @@ void C_pt2_kernel(T *J, idx_t *J_ind, idx_t N, det_t *psi_int, idx_t N_int, det_
     for (auto i = 0; i < N; i++) {
 
         // by construction of the chunks, this should be the canonical index
-        struct ijkl_tuple c_idx = compound_idx4_reverse(J_ind[i]);
+        struct ijkl_tuple c_idx = idx4_reverse(J_ind[i]);
 
         // map index to standard form: J_ijil, J_ijkj -> J_qrqs
         idx_t q, r, s;
@@ -259,42 +467,38 @@ void C_pt2_kernel(T *J, idx_t *J_ind, idx_t N, det_t *psi_int, idx_t N_int, det_
             if (!(c13 || c24)) // J[i] has no contribution for this internal det
                 continue;
             // iterate over external determinants
-            for (auto d_e = 0; d_e < N_ext; d_e++) {
-                det_t &d_ext = psi_ext[d_e];
-                bool q_a = d_ext[0][q] && q_ai;
-                bool q_b = d_ext[1][q] && q_bi;
-                if (!(q_a || q_b)) // q must be occupied in beta/alpha simultaneously
-                    continue;
+            for (auto d_e = 0; d_e < N_ext; d_e++)
+                res[d_e] += J[i] * C_pt2_coefficient(d_int, psi_ext[d_e], q, r, s, c13, c24);
+        }
+    }
+}
 
-                // Can probably optimize for early exit: will need to check many things overall
-                // But for now, will need to get excitations for every contribution anyway
-                // and it is a definite exit point
-                det_t exc = exc_det(d_int, d_ext);
-                auto degree = (exc[0].count() + exc[1].count()) / 2;
-                if (degree != 1) // |d_i> and |d_e> not related by a single excitation
-                    continue;
+// C kernel over structure-of-arrays blocks: each internal det only visits its singles
+template <class T, std::size_t N_WORDS>
+void C_pt2_kernel(const T *J, const idx_t *J_ind, idx_t N, const psi_block_view<N_WORDS> &psi_int,
+                  const psi_block_view<N_WORDS> &psi_ext, T *res) {
+    std::vector<static_det_t<N_WORDS>> dets_int;
+    std::vector<connected_idx_t> connected;
+    connect_blocks(psi_int, psi_ext, dets_int, connected);
 
-                // TODO: consider branchless? Profile and see
-                int phase;
-                if (c13 && exc[0][r] && exc[0][s]) {
-                    phase = compute_phase_single_excitation(det_i[0], r, s);
-                    res[d_e] += q_a * J[i] * phase;
-                    res[d_e] += q_b * J[i] * phase;
-                }
-
-                if (c24 && exc[1][r] && exc[1][s]) {
-                    phase = compute_phase_single_excitation(det_i[1], r, s);
-                    res[d_e] += q_a * J[i] * phase;
-                    res[d_e] += q_b * J[i] * phase;
-                }
-            }
+    for (auto i = 0; i < N; i++) {
+        idx_t q, r, s;
+        map_idx_C(idx4_reverse(J_ind[i]), q, r, s);
+
+        for (std::size_t d_i = 0; d_i < dets_int.size(); d_i++) {
+            const auto &d_int = dets_int[d_i];
+            const bool q_i = d_int[0][q] || d_int[1][q];
+            const bool c13 = (d_int[0][r] != d_int[0][s]) && q_i;
+            const bool c24 = (d_int[1][r] != d_int[1][s]) && q_i;
+            if (!(c13 || c24))
+                continue;
+            for (const auto d_e : connected[d_i].singles)
+                res[d_e] += J[i] * C_pt2_coefficient(d_int, psi_ext[d_e], q, r, s, c13, c24);
         }
     }
+}
 
-    return res;
-};
-
-void map_idx_D(const ijkl_tuple idx, idx_t &q, idx_t &r) {
+inline void map_idx_D(const ijkl_tuple idx, idx_t &q, idx_t &r) {
     if (idx.i == idx.j) {
         q = idx.i;
         r = idx.l;
@@ -311,15 +515,37 @@ D: J_qqqr has the following contributions, singles of form hipi(o):
     D_3) r_a -> q_a; q_occupied in b
     D_4) r_b -> q_b; q occupied in a
 */
+// Factor of J_qqqr in the contribution of d_int to d_ext, given the flags d13, d24 of d_int
+template <class det_type>
+int D_pt2_coefficient(const det_type &d_int, const det_type &d_ext, idx_t q, idx_t r, bool d13,
+                      bool d24) {
+    const bool q_a = d_ext[0][q] && d_int[0][q];
+    const bool q_b = d_ext[1][q] && d_int[1][q];
+    if (!(q_a || q_b)) // q must be occupied in beta/alpha simultaneously
+        return 0;
+
+    const auto exc = get_excitation_info(d_int, d_ext);
+    if (exc.order() != 1) // |d_i> and |d_e> not related by a single excitation
+        return 0;
+
+    int coefficient = 0;
+    // include q_(a/b) in check since there is only one contribution
+    if (d13 && q_b && exc.involves(0, q) && exc.involves(0, r))
+        coefficient += compute_phase_single_excitation(d_int[0], q, r);
+    if (d24 && q_a && exc.involves(1, q) && exc.involves(1, r))
+        coefficient += compute_phase_single_excitation(d_int[1], q, r);
+    return coefficient;
+}
+
 template <class T>
-void D_pt2_kernel(T *J, idx_t *J_ind, idx_t N, det_t *psi_int, idx_t N_int, det_t *psi_ext,
-                  idx_t N_ext, T *res) {
+void D_pt2_kernel(const T *J, const idx_t *J_ind, idx_t N, det_t *psi_int, idx_t N_int,
+                  det_t *psi_ext, idx_t N_ext, T *res) {
 
     // Iterate over all integrals in chunk
     for (auto i = 0; i < N; i++) {
 
         // by construction of the chunks, this should be the canonical index
-        struct ijkl_tuple c_idx = compound_idx4_reverse(J_ind[i]);
+        struct ijkl_tuple c_idx = idx4_reverse(J_ind[i]);
 
         // map index to standard form: J_iiil, J_ijjj -> J_qqqr
         idx_t q, r;
@@ -338,40 +564,42 @@ void D_pt2_kernel(T *J, idx_t *J_ind, idx_t N, det_t *psi_int, idx_t N_int, det_
                 continue;
 
             // iterate over external determinants
-            for (auto d_e = 0; d_e < N_ext; d_e++) {
-                det_t &d_ext = psi_ext[d_e];
-                bool q_a = d_ext[0][q] && q_ai;
-                bool q_b = d_ext[1][q] && q_bi;
-                if (!(q_a || q_b)) // q must be occupied in beta/alpha simultaneously
-                    continue;
+            for (auto d_e = 0; d_e < N_ext; d_e++)
+                res[d_e] += J[i] * D_pt2_coefficient(d_int, psi_ext[d_e], q, r, d13, d24);
+        }
+    }
+}
 
-                det_t exc = exc_det(d_int, d_ext);
-                auto degree = (exc[0].count() + exc[1].count()) / 2;
-                if (degree != 1) // |d_i> and |d_e> not related by a single excitation
-                    continue;
+// D kernel over structure-of-arrays blocks: each internal det only visits its singles
+template <class T, std::size_t N_WORDS>
+void D_pt2_kernel(const T *J, const idx_t *J_ind, idx_t N, const psi_block_view<N_WORDS> &psi_int,
+                  const psi_block_view<N_WORDS> &psi_ext, T *res) {
+    std::vector<static_det_t<N_WORDS>> dets_int;
+    std::vector<connected_idx_t> connected;
+    connect_blocks(psi_int, psi_ext, dets_int, connected);
 
-                int phase;
-                // include q_(a/b) in check since there is only one contribution
-                if (d13 && q_b && exc[0][q] && exc[0][r]) {
-                    phase = compute_phase_single_excitation(det_i[0], q, r);
-                    res[d_e] += J[i] * phase;
-                }
+    for (auto i = 0; i < N; i++) {
+        idx_t q, r;
+        map_idx_D(idx4_reverse(J_ind[i]), q, r);
 
-                if (d24 && q_a && exc[1][q] && exc[1][r]) {
-                    phase = compute_phase_single_excitation(det_i[1], q, r);
-                    res[d_e] += J[i] * phase;
-                }
-            }
+        for (std::size_t d_i = 0; d_i < dets_int.size(); d_i++) {
+            const auto &d_int = dets_int[d_i];
+            const bool d13 = (d_int[0][q] != d_int[0][r]) && d_int[1][q];
+            const bool d24 = (d_int[1][q] != d_int[1][r]) && d_int[0][q];
+            if (!(d13 || d24))
+                continue;
+            for (const auto d_e : connected[d_i].singles)
+                res[d_e] += J[i] * D_pt2_coefficient(d_int, psi_ext[d_e], q, r, d13, d24);
         }
     }
 }
 
-void map_idx_E(const ijkl_tuple idx, idx_t &q, idx_t &r, idx_t &s) {
+inline void map_idx_E(const ijkl_tuple idx, idx_t &q, idx_t &r, idx_t &s) {
     if (idx.i == idx.j) {
         q = idx.i;
         r = idx.k;
         s = idx.l;
-    } else if (idx.j == idx_k) {
+    } else if (idx.j == idx.k) {
         q = idx.j;
         r = idx.i;
         s = idx.l;
@@ -402,15 +630,51 @@ E: J_qqrs has the following contributions,
         E_h) q_a -> s_a | r_b -> q_b
 
 */
+// Factor of J_qqrs in the contribution of d_int to d_ext, given the flags e13, e24 of d_int
+template <class det_type>
+int E_pt2_coefficient(const det_type &d_int, const det_type &d_ext, idx_t q, idx_t r, idx_t s,
+                      bool e13, bool e24) {
+    // early exit on exc degree is probably simplest
+    const auto exc = get_excitation_info(d_int, d_ext);
+    const auto degree = exc.order();
+    if (degree == 1) {
+        const bool q_a = d_ext[0][q] && d_int[0][q];
+        const bool q_b = d_ext[1][q] && d_int[1][q];
+        if (!(q_a || q_b)) // q must be occupied in beta/alpha simultaneously
+            return 0;
+
+        int coefficient = 0;
+        if (e13 && q_a && exc.involves(0, r) && exc.involves(0, s))
+            coefficient -= compute_phase_single_excitation(d_int[0], r, s);
+        if (e24 && q_b && exc.involves(1, r) && exc.involves(1, s))
+            coefficient -= compute_phase_single_excitation(d_int[1], r, s);
+        return coefficient;
+    }
+    // |d_i> and |d_e> not connnected (assumes d_i != d_e), or not by an opposite spin double
+    if (degree != 2 || exc.degree[0] != 1)
+        return 0;
+    if (!(exc.involves(0, q) && exc.involves(1, q))) // q involved in both spins
+        return 0;
+
+    int coefficient = 0;
+    // adeg
+    if (exc.involves(0, r) && exc.involves(1, s))
+        coefficient += compute_phase_double_excitation(d_int, q, q, r, s);
+    // bcfh
+    if (exc.involves(0, s) && exc.involves(1, r))
+        coefficient += compute_phase_double_excitation(d_int, q, q, s, r);
+    return coefficient;
+}
+
 template <class T>
-void E_pt2_kernel(T *J, idx_t *J_ind, idx_t N, det_t *psi_int, idx_t N_int, det_t *psi_ext,
-                  idx_t N_ext, T *res) {
+void E_pt2_kernel(const T *J, const idx_t *J_ind, idx_t N, det_t *psi_int, idx_t N_int,
+                  det_t *psi_ext, idx_t N_ext, T *res) {
 
     // Iterate over all integrals in chunk
     for (auto i = 0; i < N; i++) {
 
         // by construction of the chunks, this should be the canonical index
-        struct ijkl_tuple c_idx = compound_idx4_reverse(J_ind[i]);
+        struct ijkl_tuple c_idx = idx4_reverse(J_ind[i]);
 
         // map index to standard form: J_iikl, J_ijjl, J_ijkk -> J_qqrs
         idx_t q, r, s;
@@ -422,61 +686,83 @@ void E_pt2_kernel(T *J, idx_t *J_ind, idx_t N, det_t *psi_int, idx_t N_int, det_
             bool e13, e24, e_adeg, e_bcfh, q_ai, q_bi;
             q_ai = d_int[0][q];
             q_bi = d_int[1][q];
-            e_13 = (d_int[0][r] != d_int[0][s]) && q_ai;
-            e_24 = (d_int[1][r] != d_int[1][s]) && q_bi;
+            e13 = (d_int[0][r] != d_int[0][s]) && q_ai;
+            e24 = (d_int[1][r] != d_int[1][s]) && q_bi;
 
             e_adeg = (d_int[0][q] != d_int[0][r]) && (d_int[1][q] != d_int[1][s]);
-            e_bcfh = (d_int[0][q] != d_int[0][r]) && (d_int[1][q] != d_int[1][s]);
+            e_bcfh = (d_int[0][q] != d_int[0][s]) && (d_int[1][q] != d_int[1][r]);
 
-            if (!(e_13 || e_24 || e_adeg || e_bcfh)) // J[i] has no contribution
+            if (!(e13 || e24 || e_adeg || e_bcfh)) // J[i] has no contribution
                 continue;
 
             // iterate over external determinants
-            for (auto d_e = 0; d_e < N_ext; d_e++) {
-                det_t &d_ext = psi_ext[d_e];
+            for (auto d_e = 0; d_e < N_ext; d_e++)
+                res[d_e] += J[i] * E_pt2_coefficient(d_int, psi_ext[d_e], q, r, s, e13, e24);
+        }
+    }
+}
 
-                // early exit on exc degree is probably simplest
-                det_t exc = exc_det(d_int, d_ext);
-                auto degree = (exc[0].count() + exc[1].count()) / 2;
-                if (degree > 2) // |d_i> and |d_e> not connnected, assumes d_i != d_e
+// E kernel over structure-of-arrays blocks: each internal det only visits its singles and doubles
+template <class T, std::size_t N_WORDS>
+void E_pt2_kernel(const T *J, const idx_t *J_ind, idx_t N, const psi_block_view<N_WORDS> &psi_int,
+                  const psi_block_view<N_WORDS> &psi_ext, T *res) {
+    std::vector<static_det_t<N_WORDS>> dets_int;
+    std::vector<connected_idx_t> connected;
+    connect_blocks(psi_int, psi_ext, dets_int, connected);
+
+    for (auto i = 0; i < N; i++) {
+        idx_t q, r, s;
+        map_idx_E(idx4_reverse(J_ind[i]), q, r, s);
+
+        for (std::size_t d_i = 0; d_i < dets_int.size(); d_i++) {
+            const auto &d_int = dets_int[d_i];
+            const bool e13 = (d_int[0][r] != d_int[0][s]) && d_int[0][q];
+            const bool e24 = (d_int[1][r] != d_int[1][s]) && d_int[1][q];
+            const bool e_adeg = (d_int[0][q] != d_int[0][r]) && (d_int[1][q] != d_int[1][s]);
+            const bool e_bcfh = (d_int[0][q] != d_int[0][s]) && (d_int[1][q] != d_int[1][r]);
+            if (!(e13 || e24 || e_adeg || e_bcfh))
+                continue;
+            for (const auto &ext : {&connected[d_i].singles, &connected[d_i].doubles})
+                for (const auto d_e : *ext)
+                    res[d_e] += J[i] * E_pt2_coefficient(d_int, psi_ext[d_e], q, r, s, e13, e24);
+        }
+    }
+}
+
+/*
+E kernel over an alpha/beta factorized external space. Each internal determinant connects through
+J_qqrs to at most two singles (r <-> s in a spin where q is occupied) and two opposite spin doubles
+(q <-> r | q <-> s and q <-> s | q <-> r), which are looked up in the index instead of being
+searched for in all of psi_ext.
+*/
+template <class T, class spin_det_type>
+void E_pt2_kernel(const T *J, const idx_t *J_ind, idx_t N, const det_base_t<spin_det_type> *psi_int,
+                  idx_t N_int, const psi_index<spin_det_type> &psi_ext, T *res) {
+    for (auto i = 0; i < N; i++) {
+        struct ijkl_tuple c_idx = idx4_reverse(J_ind[i]);
+        idx_t q, r, s;
+        map_idx_E(c_idx, q, r, s);
+
+        for (auto d_i = 0; d_i < N_int; d_i++) {
+            const auto &d_int = psi_int[d_i];
+
+            // E_1 .. E_4
+            for (int spin = 0; spin < N_SPIN_SPECIES; spin++) {
+                if (!d_int[spin][q] || (d_int[spin][r] == d_int[spin][s]))
                     continue;
+                const auto d_e = psi_ext.find(flip_pair(d_int, spin, r, s));
+                if (d_e != psi_ext.npos)
+                    res[d_e] -= J[i] * compute_phase_single_excitation(d_int[spin], r, s);
+            }
 
-                int phase;
-                if (degree == 1) {
-                    bool q_a = d_ext[0][q] && q_ai;
-                    bool q_b = d_ext[1][q] && q_bi;
-                    if (!(q_a || q_b)) // q must be occupied in beta/alpha simultaneously
-                        continue;
-
-                    if (e13 && q_a && exc[0][r] && exc[0][s]) {
-                        phase = compute_phase_single_excitation(det_i[0], r, s);
-                        res[d_e] += J[i] * phase * -1;
-                    }
-
-                    if (e24 && q_b && exc[1][r] && exc[1][s]) {
-                        phase = compute_phase_single_excitation(det_i[0], r, s);
-                        res[d_e] += J[i] * phase * -1;
-                    }
-                } else if (degree == 2) {
-
-                    if (exc[0].count() == 0 || exc[1].count() == 0) // must be opp. spin double
-                        continue;
-
-                    if (!(exc[0][q] && exc[1][q])) // q must be involved in both spins
-                        continue;
-
-                    // adeg
-                    if (exc[0][r] && exc[1][s]) {
-                        phase = compute_phase_double_excitation(d_int, q, q, r, s);
-                        res[d_e] += J[i] * phase;
-                    }
-
-                    // bcfh
-                    if (exc[0][s] && exc[1][r]) {
-                        phase = compute_phase_double_excitation(d_int, q, q, s, r);
-                        res[d_e] += J[i] * phase;
-                    }
-                }
+            // E_adeg (alpha q <-> r, beta q <-> s), then E_bcfh (alpha q <-> s, beta q <-> r)
+            for (const auto &[p_a, p_b] :
+                 {std::array<idx_t, 2>{r, s}, std::array<idx_t, 2>{s, r}}) {
+                if ((d_int[0][q] == d_int[0][p_a]) || (d_int[1][q] == d_int[1][p_b]))
+                    continue;
+                const auto d_e = psi_ext.find(flip_pair(flip_pair(d_int, 0, q, p_a), 1, q, p_b));
+                if (d_e != psi_ext.npos)
+                    res[d_e] += J[i] * compute_phase_double_excitation(d_int, q, q, p_a, p_b);
             }
         }
     }
@@ -490,14 +776,14 @@ F: J_qqrr has the following (off diagonal) contributions, all opposite spin doub
     F_4) r_a -> q_a | q_b -> r_b
 */
 template <class T>
-void F_pt2_kernel(T *J, idx_t *J_ind, idx_t N, det_t *psi_int, idx_t N_int, det_t *psi_ext,
-                  idx_t N_ext, T *res) {
+void F_pt2_kernel(const T *J, const idx_t *J_ind, idx_t N, det_t *psi_int, idx_t N_int,
+                  det_t *psi_ext, idx_t N_ext, T *res) {
 
     // Iterate over all integrals in chunk
     for (auto i = 0; i < N; i++) {
 
         // by construction of the chunks, this should be the canonical index
-        struct ijkl_tuple c_idx = compound_idx4_reverse(J_ind[i]);
+        struct ijkl_tuple c_idx = idx4_reverse(J_ind[i]);
 
         // index already in standard form: J_iikk -> J_qqrr
         idx_t q, r;
@@ -516,13 +802,12 @@ void F_pt2_kernel(T *J, idx_t *J_ind, idx_t N, det_t *psi_int, idx_t N_int, det_
             // iterate over external determinants
             for (auto d_e = 0; d_e < N_ext; d_e++) {
                 det_t &d_ext = psi_ext[d_e];
-                det_t exc = exc_det(d_int, d_ext);
-                auto a_degree = exc[1].count() / 2;
-                auto b_degree = exc[0].count() / 2;
-                if (!((a_degree == 1) && (b_degree == 1))) // must be opp. spin double
+                const auto exc = get_excitation_info(d_int, d_ext);
+                if (!((exc.degree[0] == 1) && (exc.degree[1] == 1))) // must be opp. spin double
                     continue;
 
-                if (exc[0][q] && exc[0][r] && exc[1][q] && exc[1][r]) {
+                if (exc.involves(0, q) && exc.involves(0, r) && exc.involves(1, q) &&
+                    exc.involves(1, r)) {
                     int phase = compute_phase_double_excitation(d_int, q, q, r, r);
                     res[d_e] += J[i] * phase;
                 }
@@ -531,15 +816,36 @@ void F_pt2_kernel(T *J, idx_t *J_ind, idx_t N, det_t *psi_int, idx_t N_int, det_
     }
 }
 
+// F kernel over an alpha/beta factorized external space: the only determinant F_1 .. F_4 connect
+// to d_int is d_int with q and r flipped in both spins, looked up in the index
+template <class T, class spin_det_type>
+void F_pt2_kernel(const T *J, const idx_t *J_ind, idx_t N, const det_base_t<spin_det_type> *psi_int,
+                  idx_t N_int, const psi_index<spin_det_type> &psi_ext, T *res) {
+    for (auto i = 0; i < N; i++) {
+        struct ijkl_tuple c_idx = idx4_reverse(J_ind[i]);
+        const idx_t q = c_idx.i, r = c_idx.k;
+
+        for (auto d_i = 0; d_i < N_int; d_i++) {
+            const auto &d_int = psi_int[d_i];
+            if (!((d_int[0][q] != d_int[0][r]) && (d_int[1][q] != d_int[1][r])))
+                continue;
+            const auto d_e = psi_ext.find(flip_pair(flip_pair(d_int, 0, q, r), 1, q, r));
+            if (d_e != psi_ext.npos)
+                res[d_e] += J[i] * compute_phase_double_excitation(d_int, q, q, r, r);
+        }
+    }
+}
+
 template <class T>
-void F_pt2_kernel_denom(T *J, idx_t *J_ind, idx_t N, det_t *psi_ext, idx_t N_ext, T *res) {
+void F_pt2_kernel_denom(const T *J, const idx_t *J_ind, idx_t N, det_t *psi_ext, idx_t N_ext,
+                        T *res) {
     // Contributions to combination terms in denominator
 
     // Iterate over all integrals in chunk
     for (auto i = 0; i < N; i++) {
 
         // by construction of the chunks, this should be the canonical index
-        struct ijkl_tuple c_idx = compound_idx4_reverse(J_ind[i]);
+        struct ijkl_tuple c_idx = idx4_reverse(J_ind[i]);
 
         // index already in standard form: J_iikk -> J_qqrr
         idx_t q, r;
@@ -555,6 +861,19 @@ void F_pt2_kernel_denom(T *J, idx_t *J_ind, idx_t N, det_t *psi_ext, idx_t N_ext
     }
 }
 
+template <class T, std::size_t N_WORDS>
+void F_pt2_kernel_denom(const T *J, const idx_t *J_ind, idx_t N,
+                        const psi_block_view<N_WORDS> &psi_ext, T *res) {
+    std::vector<uint8_t> occ_a(psi_ext.size()), occ_b(psi_ext.size());
+    for (auto i = 0; i < N; i++) {
+        struct ijkl_tuple c_idx = idx4_reverse(J_ind[i]);
+        pair_occupation(psi_ext, 0, c_idx.i, c_idx.k, occ_a.data());
+        pair_occupation(psi_ext, 1, c_idx.i, c_idx.k, occ_b.data());
+        for (std::size_t d_e = 0; d_e < psi_ext.size(); d_e++)
+            res[d_e] -= (occ_a[d_e] + occ_b[d_e]) * J[i]; // phase implicit in -=
+    }
+}
+
 /*
 This is the most expensive kernel, and by far where most compute time will be spent.
 At 64 MOs, G integrals comprise ~88% of all unique integrals (C, E ~5.8% ea.)
@@ -589,15 +908,74 @@ G:
               s,r -> q,t | B
 
 */
+// Same-spin flags of G_pt2_kernel for one internal determinant: bit `spin` of g[n] is set when
+// d_int can undergo the same-spin double G_nn of that spin
+template <class det_type>
+std::array<int, 4> G_same_spin_flags(const det_type &d_int, idx_t q, idx_t r, idx_t s, idx_t t) {
+    std::array<int, 4> g{0, 0, 0, 0};
+    for (auto spin = 0; spin < N_SPIN_SPECIES; spin++) {
+        const auto &d = d_int[spin];
+        g[0] |= ((d[q] && d[r]) && (!d[s] && !d[t])) << spin;
+        g[1] |= ((d[s] && d[t]) && (!d[q] && !d[r])) << spin;
+        g[2] |= ((d[q] && d[t]) && (!d[s] && !d[r])) << spin;
+        g[3] |= ((d[r] && d[s]) && (!d[q] && !d[t])) << spin;
+    }
+    return g;
+}
+
+// Sum of the phases with which J_qrst couples d_int to a determinant related to it by `exc`
+// (0 when it does not contribute); `pm` are the phase masks of d_int
+template <class phase_mask_type>
+int G_pt2_phase(const excitation_info_t &exc, const phase_mask_type &pm,
+                const std::array<int, 4> &g, idx_t q, idx_t r, idx_t s, idx_t t) {
+    if (exc.order() != 2) // not connnected by double exc.
+        return 0;
+
+    // TODO: profile branching
+    int phase = 0;
+    if (exc.degree[0] == 1) {
+        // aceg
+        if (exc.involves(0, q) && exc.involves(0, s) && exc.involves(1, r) && exc.involves(1, t))
+            phase += compute_phase_double_excitation(pm, q, r, s, t);
+
+        // bdfh
+        if (exc.involves(0, r) && exc.involves(0, t) && exc.involves(1, q) && exc.involves(1, s))
+            phase += compute_phase_double_excitation(pm, r, q, t, s);
+        return phase;
+    }
+
+    // (2,0) or (0,2): q, r, s, t must all be excited
+    const int spin = (exc.degree[0] == 0) ? 1 : 0;
+    if (!(exc.involves(spin, q) && exc.involves(spin, r) && exc.involves(spin, s) &&
+          exc.involves(spin, t)))
+        return 0;
+
+    // now must be one of g_11, g_22, g_33, g_44
+    const int bit = 1 << spin;
+    if (g[0] & bit)
+        return compute_phase_double_excitation(pm, spin, q, r, s, t);
+    if (g[1] & bit)
+        return compute_phase_double_excitation(pm, spin, s, t, q, r);
+    if (g[2] & bit)
+        return compute_phase_double_excitation(pm, spin, q, t, s, r);
+    if (g[3] & bit)
+        return compute_phase_double_excitation(pm, spin, r, s, q, t);
+    return 0; // q s -> r t or r t -> q s belong to another integral
+}
+
 template <class T>
-void G_pt2_kernel(T *J, idx_t *J_ind, idx_t N, det_t *psi_int, idx_t N_int, det_t *psi_ext,
-                  idx_t N_ext, T *res) {
+void G_pt2_kernel(const T *J, const idx_t *J_ind, idx_t N, det_t *psi_int, idx_t N_int,
+                  det_t *psi_ext, idx_t N_ext, T *res) {
+
+    // prefix-parity masks of the internal determinants, built on first use and shared by all
+    // integrals of the chunk so that every phase below is O(1)
+    phase_mask_cache_t<spin_det_t> phase_masks(psi_int, N_int);
 
     // Iterate over all integrals in chunk
     for (auto i = 0; i < N; i++) {
 
         // by construction of the chunks, this should be the canonical index
-        struct ijkl_tuple c_idx = compound_idx4_reverse(J_ind[i]);
+        struct ijkl_tuple c_idx = idx4_reverse(J_ind[i]);
 
         // index already in standard form: J_ijkl -> J_qrst
         idx_t q, r, s, t;
@@ -616,87 +994,98 @@ void G_pt2_kernel(T *J, idx_t *J_ind, idx_t N, det_t *psi_int, idx_t N_int, det_
             g_bdfh = (d_int[0][r] != d_int[0][t]) && (d_int[1][q] != d_int[1][s]);
 
             // checks for same spin doubles
-            // g_ii in (0,1,2,3) :
-            // 0 - none, 1 - only alpha 2- only beta 3 - both alpha and beta
-            int g_11, g_22, g_33, g_44 = 0;
-            for (auto spin = 0; spin < N_SPIN_SPECIES; spin++) {
-                g_11 = (spin + 1) *
-                       ((d_int[spin][q] && d_int[spin][r]) && (!d_int[spin][s] && !d_int[spin][t]));
-                g_22 = (spin + 1) *
-                       ((d_int[spin][s] && d_int[spin][t]) && (!d_int[spin][q] && !d_int[spin][r]));
-                g_33 = (spin + 1) *
-                       ((d_int[spin][q] && d_int[spin][t]) && (!d_int[spin][s] && !d_int[spin][r]));
-                g_44 = (spin + 1) *
-                       ((d_int[spin][r] && d_int[spin][s]) && (!d_int[spin][q] && !d_int[spin][t]));
-            }
+            const auto g = G_same_spin_flags(d_int, q, r, s, t);
 
-            if (!(g_aceg || g_bdfh || ((g_11 + g_22 + g_33 + g44) > 0))) // J[i] has no contribution
+            if (!(g_aceg || g_bdfh || (g[0] | g[1] | g[2] | g[3]))) // J[i] has no contribution
                 continue;
 
             // iterate over external determinants
+            const auto &pm = phase_masks[d_i];
             for (auto d_e = 0; d_e < N_ext; d_e++) {
-                det_t &d_ext = psi_ext[d_e];
+                const auto exc = get_excitation_info(d_int, psi_ext[d_e]);
+                res[d_e] += J[i] * G_pt2_phase(exc, pm, g, q, r, s, t);
+            }
+        }
+    }
+}
 
-                det_t exc = exc_det(d_int, d_ext);
-                auto a_degree = exc[0].count() / 2;
-                auto degree = a_degree + exc[1].count() / 2;
-                if (degree != 2) // |d_i> and |d_e> not connnected by double exc.
-                    continue;
+/*
+G kernel over structure-of-arrays blocks.
 
-                // TODO: profile branching
-                // e.g., default phase = 0 and then always add into result?
-                // using checks to make phase nonzero?
-
-                // TODO: profile some form of inlining for phase computations
-                int phase;
-                if (a_degree == 1) {
-                    // aceg
-                    if (exc[0][q] && exc[0][s] && exc[1][r] && exc[1][t]) {
-                        phase = compute_phase_double_excitation(d_int, q, r, s, t);
-                        res[d_e] += J[i] * phase;
-                    }
-
-                    // bdfh
-                    if (exc[0][r] && exc[0][t] && exc[1][q] && exc[1][s]) {
-                        phase = compute_phase_double_excitation(d_int, r, q, t, s);
-                        res[d_e] += J[i] * phase;
-                    }
-                } else if (a_degree == 0) {
-                    // (0,2) : g_ii >= 2 is criterion for acceptance
-                    bool aa_check = exc[0][q] && exc[0][r] && exc[0][s] && exc[0][t];
-                    if (!aa_check)
-                        continue;
-
-                    // now must be one of g_11, g_22, g_33, g_44
-                    if (g_11 >= 2) {
-                        phase = compute_phase_double_excitation(d_int[0], q, r, s, t);
-                    } else if (g_22 >= 2) {
-                        phase = compute_phase_double_excitation(d_int[0], s, t, q, r);
-                    } else if (g_33 >= 2) {
-                        phase = compute_phase_double_excitation(d_int[0], q, t, s, r);
-                    } else {
-                        phase = compute_phase_double_excitation(d_int[0], r, s, q, t);
-                    }
-                    res[d_e] += J[i] * phase;
-                } else {
-                    // (2,0) : g_ii % 2 is criterion for acceptance
-                    bool bb_check = exc[1][q] && exc[1][r] && exc[1][s] && exc[1][t];
-                    if (!bb_check)
-                        continue;
-
-                    // now must be one of g_11, g_22, g_33, g_44
-                    if (g_11 % 2) {
-                        phase = compute_phase_double_excitation(d_int[1], q, r, s, t);
-                    } else if (g_22 % 2) {
-                        phase = compute_phase_double_excitation(d_int[1], s, t, q, r);
-                    } else if (g_33 % 2) {
-                        phase = compute_phase_double_excitation(d_int[1], q, t, s, r);
-                    } else {
-                        phase = compute_phase_double_excitation(d_int[1], r, s, q, t);
-                    }
-                    res[d_e] += J[i] * phase;
-                }
+The doubles of every internal determinant are found once, with the SIMD filter_connected, for all
+the integrals of the chunk; each integral then only visits those candidates instead of the whole
+external block.
+*/
+template <class T, std::size_t N_WORDS>
+void G_pt2_kernel(const T *J, const idx_t *J_ind, idx_t N, const psi_block_view<N_WORDS> &psi_int,
+                  const psi_block_view<N_WORDS> &psi_ext, T *res) {
+    std::vector<static_det_t<N_WORDS>> dets_int;
+    std::vector<connected_idx_t> connected;
+    connect_blocks(psi_int, psi_ext, dets_int, connected);
+    phase_mask_cache_t<static_spin_det_t<N_WORDS>> phase_masks(dets_int.data(), dets_int.size());
+
+    for (auto i = 0; i < N; i++) {
+        struct ijkl_tuple c_idx = idx4_reverse(J_ind[i]);
+        const idx_t q = c_idx.i, r = c_idx.j, s = c_idx.k, t = c_idx.l;
+
+        for (std::size_t d_i = 0; d_i < psi_int.size(); d_i++) {
+            const auto &d_int = dets_int[d_i];
+            const bool g_aceg = (d_int[0][q] != d_int[0][s]) && (d_int[1][r] != d_int[1][t]);
+            const bool g_bdfh = (d_int[0][r] != d_int[0][t]) && (d_int[1][q] != d_int[1][s]);
+            const auto g = G_same_spin_flags(d_int, q, r, s, t);
+            if (!(g_aceg || g_bdfh || (g[0] | g[1] | g[2] | g[3])))
+                continue;
+
+            const auto &pm = phase_masks[d_i];
+            for (const auto d_e : connected[d_i].doubles) {
+                const auto exc = get_excitation_info(d_int, psi_ext[d_e]);
+                res[d_e] += J[i] * G_pt2_phase(exc, pm, g, q, r, s, t);
             }
         }
     }
-}
\ No newline at end of file
+}
+
+/*
+G kernel over an alpha/beta factorized external space. The external determinants J_qrst connects
+d_int to are d_int with
+    - q, s flipped in alpha and r, t in beta (G_a, c, e, g),
+    - r, t flipped in alpha and q, s in beta (G_b, d, f, h),
+    - q, r, s, t flipped in the spin of a same spin double G_11 .. G_44,
+so at most four lookups in the index replace the scan of psi_ext.
+*/
+template <class T, class spin_det_type>
+void G_pt2_kernel(const T *J, const idx_t *J_ind, idx_t N, const det_base_t<spin_det_type> *psi_int,
+                  idx_t N_int, const psi_index<spin_det_type> &psi_ext, T *res) {
+    phase_mask_cache_t<spin_det_type> phase_masks(psi_int, N_int);
+
+    for (auto i = 0; i < N; i++) {
+        struct ijkl_tuple c_idx = idx4_reverse(J_ind[i]);
+        const idx_t q = c_idx.i, r = c_idx.j, s = c_idx.k, t = c_idx.l;
+
+        for (auto d_i = 0; d_i < N_int; d_i++) {
+            const auto &d_int = psi_int[d_i];
+            const bool g_aceg = (d_int[0][q] != d_int[0][s]) && (d_int[1][r] != d_int[1][t]);
+            const bool g_bdfh = (d_int[0][r] != d_int[0][t]) && (d_int[1][q] != d_int[1][s]);
+            const auto g = G_same_spin_flags(d_int, q, r, s, t);
+            const int same_spin = g[0] | g[1] | g[2] | g[3];
+            if (!(g_aceg || g_bdfh || same_spin))
+                continue;
+
+            const auto &pm = phase_masks[d_i];
+            auto add = [&](const det_base_t<spin_det_type> &d) {
+                const auto d_e = psi_ext.find(d);
+                if (d_e == psi_ext.npos)
+                    return;
+                const auto exc = get_excitation_info(d_int, d);
+                res[d_e] += J[i] * G_pt2_phase(exc, pm, g, q, r, s, t);
+            };
+            if (g_aceg)
+                add(flip_pair(flip_pair(d_int, 0, q, s), 1, r, t));
+            if (g_bdfh)
+                add(flip_pair(flip_pair(d_int, 0, r, t), 1, q, s));
+            for (int spin = 0; spin < N_SPIN_SPECIES; spin++)
+                if (same_spin & (1 << spin))
+                    add(flip_pair(flip_pair(d_int, spin, q, r), spin, s, t));
+        }
+    }
+}
@@ -0,0 +1,118 @@
+#pragma once
+#include <algorithm>
+#include <aligned_allocator.h>
+#include <integral_indexing_utils.h>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/*
+Dense two-electron integrals with the 8-fold permutational symmetry folded out: the integral of
+canonical compound index ijkl (see compound_idx4) is stored at ijkl - first() of one contiguous,
+64-byte aligned array.
+
+The lookup of (i, j, k, l) is two loads from a pair table, a min/max, a load from a row table and
+an add, where compound_idx4 evaluates three triangular numbers p (p + 1) / 2. The multiplications
+left, i * n_orb + k and j * n_orb + l, only form the pair table offsets:
+    pair[i * n_orb + k] = compound_idx2(i, k)              n_orb^2 entries
+    row[p]              = p (p + 1) / 2, start of row p     n_orb (n_orb + 1) / 2 entries
+    ijkl                = row[max(ik, jl)] + min(ik, jl)
+Both tables are built once and are small next to the ~n_orb^4 / 8 integrals, so they stay in cache
+while the integral loads (which index() or prefetch() can issue ahead of use) go to memory.
+
+packed_tej_t holds every integral. packed_tej_slice_t holds the compound indices [first, last) of
+a chunk of a distributed tensor (see owner_range): integrals outside the range read as zero and are
+skipped by assign.
+*/
+template <class T, bool SLICE> class basic_packed_tej_t {
+  public:
+    typedef std::vector<T, aligned_allocator_t<T>> storage_type;
+
+    // number of distinct integrals of n_orb orbitals
+    static idx_t n_integrals(const idx_t n_orb) {
+        const idx_t n_pairs = n_orb * (n_orb + 1) / 2;
+        return n_pairs * (n_pairs + 1) / 2;
+    }
+
+    // [first, last) of worker `rank` out of n_ranks: contiguous ranges differing by at most one
+    static std::pair<idx_t, idx_t> owner_range(const idx_t n_orb, const idx_t rank,
+                                               const idx_t n_ranks) {
+        const idx_t n = n_integrals(n_orb);
+        const auto bound = [&](idx_t r) { return n / n_ranks * r + std::min(r, n % n_ranks); };
+        return {bound(rank), bound(rank + 1)};
+    }
+
+    // All integrals, zero-initialized
+    explicit basic_packed_tej_t(const idx_t n_orb)
+        : basic_packed_tej_t(n_orb, 0, n_integrals(n_orb), 0) {}
+
+    // The integrals [first, last), zero-initialized
+    template <bool S = SLICE, std::enable_if_t<S, int> = 0>
+    basic_packed_tej_t(const idx_t n_orb, const idx_t first, const idx_t last)
+        : basic_packed_tej_t(n_orb, first, last, 0) {}
+
+    idx_t n_orb() const { return m_n_orb; }
+    idx_t first() const { return m_first; }
+    idx_t last() const { return m_first + size(); }
+    idx_t size() const { return m_data.size(); }
+    T *data() { return m_data.data(); }
+    const T *data() const { return m_data.data(); }
+
+    bool owns_index(const idx_t ijkl) const { return !SLICE || (ijkl >= m_first && ijkl < last()); }
+
+    // compound_idx4(i, j, k, l)
+    idx_t index(const idx_t i, const idx_t j, const idx_t k, const idx_t l) const {
+        const idx_t ik = m_pair[i * m_n_orb + k];
+        const idx_t jl = m_pair[j * m_n_orb + l];
+        return m_row[std::max(ik, jl)] + std::min(ik, jl);
+    }
+
+    T operator()(const idx_t i, const idx_t j, const idx_t k, const idx_t l) const {
+        const idx_t ijkl = index(i, j, k, l);
+        if constexpr (SLICE)
+            return owns_index(ijkl) ? m_data[ijkl - m_first] : T(0);
+        else
+            return m_data[ijkl];
+    }
+
+    // Integral of an owned compound index
+    T &operator[](const idx_t ijkl) { return m_data[ijkl - m_first]; }
+    const T &operator[](const idx_t ijkl) const { return m_data[ijkl - m_first]; }
+
+    void prefetch(const idx_t i, const idx_t j, const idx_t k, const idx_t l) const {
+        const idx_t ijkl = index(i, j, k, l);
+        if (owns_index(ijkl))
+            __builtin_prefetch(m_data.data() + (ijkl - m_first));
+    }
+
+    // Set the n integrals of compound indices idx to val, e.g. a category of an fcidump_t or an
+    // integral_store_t. Indices outside the slice are skipped.
+    void assign(const idx_t *idx, const T *val, const idx_t n) {
+        for (idx_t p = 0; p < n; p++)
+            if (owns_index(idx[p]))
+                m_data[idx[p] - m_first] = val[p];
+    }
+
+  private:
+    basic_packed_tej_t(const idx_t n_orb, const idx_t first, const idx_t last, int)
+        : m_n_orb(n_orb), m_first(first), m_pair(n_orb * n_orb), m_row(n_orb * (n_orb + 1) / 2) {
+        if (n_orb < 0 || first < 0 || first > last || last > n_integrals(n_orb))
+            throw std::invalid_argument("packed_tej_t: invalid range of compound indices");
+        m_data.resize(last - first);
+        for (idx_t i = 0; i < n_orb; i++)
+            for (idx_t k = 0; k < n_orb; k++)
+                m_pair[i * n_orb + k] = compound_idx2(i, k);
+        for (idx_t p = 0; p < (idx_t)m_row.size(); p++)
+            m_row[p] = p * (p + 1) / 2;
+    }
+
+    idx_t m_n_orb;
+    idx_t m_first;
+    std::vector<idx_t, aligned_allocator_t<idx_t>> m_pair;
+    std::vector<idx_t, aligned_allocator_t<idx_t>> m_row;
+    storage_type m_data;
+};
+
+template <class T> using packed_tej_t = basic_packed_tej_t<T, false>;
+template <class T> using packed_tej_slice_t = basic_packed_tej_t<T, true>;
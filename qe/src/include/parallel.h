@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstddef>
+#include <exception>
+#include <thread>
+#include <vector>
+
+// Run f(t, begin, end) on n_threads contiguous slices of [0, n), one std::thread each. The first
+// exception thrown by f is rethrown once all threads have joined.
+template <class F> void parallel_slices(unsigned n_threads, std::size_t n, F f) {
+    if (n_threads <= 1) {
+        f(0, 0, n);
+        return;
+    }
+    std::vector<std::exception_ptr> errors(n_threads);
+    std::vector<std::thread> workers;
+    for (unsigned t = 0; t < n_threads; t++)
+        workers.emplace_back([&, t] {
+            try {
+                f(t, t * n / n_threads, (t + 1) * n / n_threads);
+            } catch (...) {
+                errors[t] = std::current_exception();
+            }
+        });
+    for (auto &w : workers)
+        w.join();
+    for (auto &e : errors)
+        if (e)
+            std::rethrow_exception(e);
+}
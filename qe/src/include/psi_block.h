@@ -0,0 +1,236 @@
+#pragma once
+
+#include <algorithm>
+#include <aligned_allocator.h>
+#include <array>
+#include <cstdint>
+#include <determinant.h>
+#include <stdexcept>
+#include <vector>
+
+/*
+Structure-of-arrays block of determinants.
+
+Word w of the alpha (beta) spin determinant of det i is stored at alpha(w)[i] (beta(w)[i]): each
+word is a contiguous, 64-byte aligned slice, padded to a multiple of PAD dets, so that kernels can
+process PAD consecutive determinants with one vector load per word.
+
+The whole block is one C-contiguous uint64 array of shape (2, N_WORDS, capacity()), the layout of
+a NumPy array built from data(), numpy_shape() and numpy_strides() without copying; conversely a
+psi_block_view can be laid over such an array coming from Python, provided it has the same
+alignment and padding: the kernels load PAD dets at a time with aligned vector loads.
+*/
+template <std::size_t N_WORDS> class psi_block_view {
+  public:
+    typedef static_det_t<N_WORDS> det_type;
+
+    psi_block_view() = default;
+    // `words` holds 2 * N_WORDS slices of `stride` dets, of which the first `n` are used. Throws
+    // std::invalid_argument unless `words` is 64-byte aligned and `stride` a multiple of PAD (8)
+    // not below n, as the SIMD kernels read whole groups of PAD dets.
+    psi_block_view(const uint64_t *words, std::size_t n, std::size_t stride)
+        : m_words(words), m_size(n), m_stride(stride) {
+        if (reinterpret_cast<std::uintptr_t>(words) % 64 || stride % 8 || stride < n)
+            throw std::invalid_argument("psi_block_view: words must be 64-byte aligned, with a "
+                                        "stride of a multiple of 8 dets");
+    }
+
+    std::size_t size() const { return m_size; }
+    std::size_t stride() const { return m_stride; }
+
+    const uint64_t *alpha(std::size_t w) const { return m_words + w * m_stride; }
+    const uint64_t *beta(std::size_t w) const { return m_words + (N_WORDS + w) * m_stride; }
+    const uint64_t *spin(int s, std::size_t w) const { return s ? beta(w) : alpha(w); }
+
+    // Whether orbital `orb` of spin `s` is occupied in det i
+    bool occupied(int s, uint64_t orb, std::size_t i) const {
+        return (spin(s, orb / 64)[i] >> (orb % 64)) & 1;
+    }
+
+    // Gather det i back into array-of-structures form
+    det_type operator[](std::size_t i) const {
+        det_type d;
+        for (std::size_t w = 0; w < N_WORDS; w++) {
+            d.alpha.blocks[w] = alpha(w)[i];
+            d.beta.blocks[w] = beta(w)[i];
+        }
+        return d;
+    }
+
+  private:
+    const uint64_t *m_words = nullptr;
+    std::size_t m_size = 0;
+    std::size_t m_stride = 0;
+};
+
+template <std::size_t N_WORDS> class psi_block {
+  public:
+    typedef static_det_t<N_WORDS> det_type;
+    static constexpr std::size_t PAD = 8;
+
+    psi_block() = default;
+
+    template <class spin_det_type> psi_block(const det_base_t<spin_det_type> *psi, std::size_t n) {
+        reserve(n);
+        for (std::size_t i = 0; i < n; i++)
+            push_back(psi[i]);
+    }
+
+    std::size_t size() const { return m_size; }
+    std::size_t capacity() const { return m_stride; }
+    bool empty() const { return m_size == 0; }
+
+    void reserve(std::size_t n) {
+        if (n > m_stride)
+            reallocate(n);
+    }
+
+    // Release the capacity beyond size() (rounded up to PAD); resize() never shrinks it
+    void shrink_to_fit() {
+        if ((m_size + PAD - 1) / PAD * PAD < m_stride)
+            reallocate(m_size);
+    }
+
+    void clear() {
+        std::fill(m_words.begin(), m_words.end(), 0);
+        m_size = 0;
+    }
+
+    // Keep the first n dets (new ones are empty); dropped dets are zeroed like the padding
+    void resize(std::size_t n) {
+        reserve(n);
+        for (std::size_t w = 0; w < 2 * N_WORDS; w++)
+            std::fill(m_words.data() + w * m_stride + std::min(n, m_size),
+                      m_words.data() + w * m_stride + std::max(n, m_size), 0);
+        m_size = n;
+    }
+
+    // Append a determinant of any spin type (e.g. the heap-backed det_t) of at most
+    // 64 * N_WORDS orbitals
+    template <class spin_det_type> void push_back(const det_base_t<spin_det_type> &d) {
+        if (m_size == m_stride)
+            reserve(std::max<std::size_t>(2 * m_stride, PAD));
+        set(m_size++, d);
+    }
+
+    template <class spin_det_type> void set(std::size_t i, const det_base_t<spin_det_type> &d) {
+        for (int s = 0; s < N_SPIN_SPECIES; s++) {
+            const auto n = std::min<std::size_t>(N_WORDS, d[s].num_blocks());
+            assert(d[s].num_blocks() <= N_WORDS || d[s].find_next(64 * N_WORDS - 1) == d[s].npos);
+            const auto *blocks = d[s].data();
+            for (std::size_t w = 0; w < N_WORDS; w++)
+                spin(s, w)[i] = (w < n) ? static_cast<uint64_t>(blocks[w]) : 0;
+        }
+    }
+
+    det_type operator[](std::size_t i) const { return view()[i]; }
+
+    // New block holding dets idx[0], ..., idx[n - 1] of this one, in that order
+    psi_block gather(const std::size_t *idx, std::size_t n) const {
+        psi_block res;
+        res.reserve(n);
+        for (std::size_t w = 0; w < 2 * N_WORDS; w++) {
+            const uint64_t *src = m_words.data() + w * m_stride;
+            uint64_t *dst = res.m_words.data() + w * res.m_stride;
+            for (std::size_t k = 0; k < n; k++)
+                dst[k] = src[idx[k]];
+        }
+        res.m_size = n;
+        return res;
+    }
+
+    // Sort the determinants in det_t order (alpha first, most significant word first) and return
+    // the permutation applied: the i-th det of the sorted block was det perm[i]
+    std::vector<std::size_t> sort() {
+        std::vector<std::size_t> perm(m_size);
+        for (std::size_t i = 0; i < m_size; i++)
+            perm[i] = i;
+        std::sort(perm.begin(), perm.end(), [this](std::size_t a, std::size_t b) {
+            for (int s = 0; s < N_SPIN_SPECIES; s++)
+                for (auto w = N_WORDS; w-- > 0;) {
+                    const uint64_t x = spin(s, w)[a], y = spin(s, w)[b];
+                    if (x != y)
+                        return x < y;
+                }
+            return false;
+        });
+        *this = gather(perm.data(), perm.size());
+        return perm;
+    }
+
+    uint64_t *alpha(std::size_t w) { return m_words.data() + w * m_stride; }
+    const uint64_t *alpha(std::size_t w) const { return m_words.data() + w * m_stride; }
+    uint64_t *beta(std::size_t w) { return m_words.data() + (N_WORDS + w) * m_stride; }
+    const uint64_t *beta(std::size_t w) const { return m_words.data() + (N_WORDS + w) * m_stride; }
+    uint64_t *spin(int s, std::size_t w) { return s ? beta(w) : alpha(w); }
+    const uint64_t *spin(int s, std::size_t w) const { return s ? beta(w) : alpha(w); }
+
+    psi_block_view<N_WORDS> view() const {
+        return psi_block_view<N_WORDS>(m_words.data(), m_size, m_stride);
+    }
+    operator psi_block_view<N_WORDS>() const { return view(); }
+
+    // Zero-copy export: data() is a C-contiguous array with this shape and byte strides
+    const uint64_t *data() const { return m_words.data(); }
+    std::array<std::size_t, 3> numpy_shape() const { return {N_SPIN_SPECIES, N_WORDS, m_stride}; }
+    std::array<std::size_t, 3> numpy_strides() const {
+        return {N_WORDS * m_stride * sizeof(uint64_t), m_stride * sizeof(uint64_t),
+                sizeof(uint64_t)};
+    }
+
+  private:
+    // Move the dets to storage of capacity n rounded up to PAD
+    void reallocate(std::size_t n) {
+        const std::size_t stride = (n + PAD - 1) / PAD * PAD;
+        words_t words(2 * N_WORDS * stride, 0);
+        for (std::size_t w = 0; w < 2 * N_WORDS; w++)
+            std::copy(m_words.data() + w * m_stride, m_words.data() + w * m_stride + m_size,
+                      words.data() + w * stride);
+        m_words.swap(words);
+        m_stride = stride;
+    }
+
+    typedef std::vector<uint64_t, aligned_allocator_t<uint64_t>> words_t;
+
+    // [alpha word 0 | ... | alpha word N-1 | beta word 0 | ... | beta word N-1], m_stride dets each
+    words_t m_words;
+    std::size_t m_size = 0;
+    std::size_t m_stride = 0;
+};
+
+// Indices of the determinants of a block connected to a reference by a single or a double
+struct connected_idx_t {
+    std::vector<std::size_t> singles;
+    std::vector<std::size_t> doubles;
+
+    void clear() {
+        singles.clear();
+        doubles.clear();
+    }
+};
+
+/*
+Append to out.singles (out.doubles) the indices of the determinants of `ext` differing from `ref`
+by exactly one (two) excitations. Determinants equal to `ref` or further away are dropped.
+
+The number of differing orbitals of PAD dets is computed at once with AVX-512 (AVX2) popcounts
+when the code is built for it (see QUANTUM_ENVELOPE_ENABLE_NATIVE), and with a scalar loop
+otherwise.
+*/
+template <std::size_t N_WORDS>
+void filter_connected(const static_det_t<N_WORDS> &ref, const psi_block_view<N_WORDS> &ext,
+                      connected_idx_t &out);
+
+template <std::size_t N_WORDS>
+void filter_connected(const static_det_t<N_WORDS> &ref, const psi_block<N_WORDS> &ext,
+                      connected_idx_t &out) {
+    filter_connected(ref, ext.view(), out);
+}
+
+// C ABI for ctypes (qe/psi_block.py) over a NumPy array `words` of shape (2, n_words, stride), laid
+// out as a psi_block (see psi_block_view) and used in place; `ref` is one det as a (2, n_words)
+// array. psi_block_filter_connected sets degree[i] to 1 (2) when det i of the first n is a single
+// (double) of ref, and to 0 otherwise. Returns 0, or -1 (printing the reason) for an n_words other
+// than 1, 2, 4 or 8 or a misaligned array.
+extern "C" int psi_block_filter_connected(int n_words, const uint64_t *ref, const uint64_t *words,
+                                          std::size_t n, std::size_t stride, int8_t *degree);
@@ -0,0 +1,191 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <determinant.h>
+#include <limits>
+#include <vector>
+
+/*
+Alpha/beta factorized index of a wavefunction.
+
+The distinct alpha strings and the distinct beta strings of psi are stored once each, sorted, and
+every determinant is the pair (alpha_id, beta_id) of its strings. Two CSR tables list, for each
+alpha string, the (beta_id, det) pairs of psi built on it, sorted by beta_id, and conversely for
+each beta string.
+
+Connections are then found by joining short lists instead of scanning psi:
+    - the det with given alpha and beta strings is two string lookups and one search in a row;
+    - the single-spin singles of d in spin s are in the row of d's spin !s string;
+    - the opposite-spin doubles of d are the joins of the rows of the alpha singles of d's alpha
+      string with the beta singles of its beta string.
+*/
+template <class spin_det_type> class psi_index {
+  public:
+    typedef det_base_t<spin_det_type> det_type;
+    static constexpr std::size_t npos = std::numeric_limits<std::size_t>::max();
+
+    // Entry of a CSR row of spin s: id of the spin !s string, and det built on both strings
+    struct entry_t {
+        uint32_t id;
+        uint32_t det;
+    };
+
+    struct row_t {
+        const entry_t *first, *last;
+        const entry_t *begin() const { return first; }
+        const entry_t *end() const { return last; }
+        std::size_t size() const { return last - first; }
+    };
+
+    psi_index() = default;
+
+    psi_index(const det_type *psi, std::size_t n) : m_ids(n) {
+        for (int s = 0; s < N_SPIN_SPECIES; s++) {
+            auto &strings = m_strings[s];
+            strings.reserve(n);
+            for (std::size_t i = 0; i < n; i++)
+                strings.push_back(psi[i][s]);
+            std::sort(strings.begin(), strings.end());
+            strings.erase(std::unique(strings.begin(), strings.end()), strings.end());
+            for (std::size_t i = 0; i < n; i++)
+                m_ids[i][s] = string_id(s, psi[i][s]);
+            if (!strings.empty()) {
+                m_occupied[s] = strings[0];
+                for (const auto &string : strings)
+                    m_occupied[s] |= string;
+            }
+        }
+
+        for (int s = 0; s < N_SPIN_SPECIES; s++) {
+            // Counting sort of the dets by spin s string; dets are visited by increasing spin !s
+            // string so that each row comes out sorted by id
+            auto &offsets = m_offsets[s];
+            offsets.assign(m_strings[s].size() + 1, 0);
+            for (const auto &ids : m_ids)
+                offsets[ids[s] + 1]++;
+            for (std::size_t k = 0; k + 1 < offsets.size(); k++)
+                offsets[k + 1] += offsets[k];
+
+            std::vector<uint32_t> by_other(n);
+            for (std::size_t i = 0; i < n; i++)
+                by_other[i] = i;
+            std::sort(by_other.begin(), by_other.end(),
+                      [&](uint32_t a, uint32_t b) { return m_ids[a][!s] < m_ids[b][!s]; });
+
+            auto next = offsets;
+            m_entries[s].resize(n);
+            for (const auto i : by_other)
+                m_entries[s][next[m_ids[i][s]]++] = {m_ids[i][!s], i};
+        }
+    }
+
+    psi_index(const std::vector<det_type> &psi) : psi_index(psi.data(), psi.size()) {}
+
+    std::size_t size() const { return m_ids.size(); }
+    std::size_t n_strings(int spin) const { return m_strings[spin].size(); }
+    const spin_det_type &string(int spin, std::size_t id) const { return m_strings[spin][id]; }
+
+    // (alpha_id, beta_id) of det i
+    const std::array<uint32_t, 2> &ids(std::size_t i) const { return m_ids[i]; }
+
+    // Id of a spin string, or npos if no det of psi has it
+    std::size_t string_id(int spin, const spin_det_type &s) const {
+        const auto &strings = m_strings[spin];
+        const auto it = std::lower_bound(strings.begin(), strings.end(), s);
+        return (it != strings.end() && *it == s) ? std::size_t(it - strings.begin()) : npos;
+    }
+
+    // Dets built on string `id` of `spin`, sorted by the id of their other string
+    row_t row(int spin, std::size_t id) const {
+        const auto *e = m_entries[spin].data();
+        return {e + m_offsets[spin][id], e + m_offsets[spin][id + 1]};
+    }
+
+    // Index of the det made of strings `alpha_id` and `beta_id`, or npos
+    std::size_t find(std::size_t alpha_id, std::size_t beta_id) const {
+        if (alpha_id == npos || beta_id == npos)
+            return npos;
+        const auto r = row(0, alpha_id);
+        const auto it =
+            std::lower_bound(r.begin(), r.end(), beta_id,
+                             [](const entry_t &e, std::size_t id) { return e.id < id; });
+        return (it != r.end() && it->id == beta_id) ? it->det : npos;
+    }
+
+    // Index of d in psi, or npos
+    std::size_t find(const det_type &d) const {
+        const auto alpha_id = string_id(0, d[0]);
+        return (alpha_id == npos) ? npos : find(alpha_id, string_id(1, d[1]));
+    }
+
+    // Ids, in increasing order, of the strings of `spin` one single excitation away from s. The
+    // singles of s are generated, with particles among the orbitals occupied in some string of
+    // psi, and looked up rather than every string being compared to s.
+    void string_singles(int spin, const spin_det_type &s, std::vector<uint32_t> &out) const {
+        out.clear();
+        if (m_strings[spin].empty())
+            return;
+        typename orbital_list_type<spin_det_type>::type holes, parts;
+        extract_orbitals(s, s, true, s.size(), holes);
+        extract_orbitals(s, m_occupied[spin], false, s.size(), parts);
+        spin_det_type e = s;
+        for (const auto h : holes) {
+            e.flip(h);
+            for (const auto p : parts) {
+                e.flip(p);
+                const auto id = string_id(spin, e);
+                if (id != npos)
+                    out.push_back(id);
+                e.flip(p);
+            }
+            e.flip(h);
+        }
+        std::sort(out.begin(), out.end());
+    }
+
+    // Append to `out` the dets of psi differing from d by a single excitation of `spin`.
+    // d does not need to be in psi.
+    void single_spin_singles(const det_type &d, int spin, std::vector<std::size_t> &out) const {
+        const auto other_id = string_id(!spin, d[!spin]);
+        if (other_id == npos)
+            return;
+        for (const auto &e : row(!spin, other_id))
+            if (count_differences(m_strings[spin][e.id], d[spin]) == 2)
+                out.push_back(e.det);
+    }
+
+    // Append to `out` the dets of psi differing from d by one alpha and one beta excitation.
+    // d does not need to be in psi.
+    void opposite_spin_doubles(const det_type &d, std::vector<std::size_t> &out) const {
+        std::vector<uint32_t> alpha_singles, beta_singles;
+        string_singles(0, d[0], alpha_singles);
+        string_singles(1, d[1], beta_singles);
+        for (const auto alpha_id : alpha_singles) {
+            // merge-join of the row, sorted by beta id, with the sorted beta singles
+            const auto r = row(0, alpha_id);
+            auto e = r.begin();
+            auto b = beta_singles.begin();
+            while (e != r.end() && b != beta_singles.end()) {
+                if (e->id < *b)
+                    ++e;
+                else if (*b < e->id)
+                    ++b;
+                else {
+                    out.push_back(e->det);
+                    ++e, ++b;
+                }
+            }
+        }
+    }
+
+  private:
+    std::array<std::vector<spin_det_type>, N_SPIN_SPECIES> m_strings;
+    // Orbitals occupied in at least one string of each spin, the only possible particles
+    std::array<spin_det_type, N_SPIN_SPECIES> m_occupied;
+    std::vector<std::array<uint32_t, 2>> m_ids;
+    // Row k of spin s is m_entries[s][m_offsets[s][k] .. m_offsets[s][k + 1])
+    std::array<std::vector<uint32_t>, N_SPIN_SPECIES> m_offsets;
+    std::array<std::vector<entry_t>, N_SPIN_SPECIES> m_entries;
+};
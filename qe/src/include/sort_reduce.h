@@ -0,0 +1,410 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstdint>
+#include <parallel.h>
+#include <psi_block.h>
+#include <queue>
+#include <utility>
+#include <vector>
+
+/*
+Sort-then-aggregate of (determinant, payload) batches, e.g. the PT2 numerator contributions
+c_i * H_ia of every generated external determinant a: duplicates are merged by summing their
+payloads.
+
+The determinants are kept in psi_block structure-of-arrays form. Sorting is a parallel LSD radix
+sort: one stable counting pass per 8-bit digit of each word, least significant word first, each
+thread histogramming and scattering its own slice. Digits that are equal in every determinant
+(e.g. the words above the last orbital) are detected up front and their passes skipped.
+
+Large batches are processed in chunks of at most `chunk_size` dets, each sorted and reduced in
+place with scratch buffers of one chunk, and the reduced runs are then merged (and reduced again)
+in place (merge_runs). The merge goes in rounds of at most one chunk of dets, each split by key
+range over the threads, into an output buffer that is flushed in small blocks into the space of
+the runs already consumed. Scratch memory thus stays at about one chunk for the sort and two
+for the merge, plus a few indices per run and per block; the result is shrunk to its final size.
+*/
+
+// Words of a psi_block in sort-key order, least significant first: beta then alpha, low word first
+// (psi_block::sort orders by alpha first, most significant word first)
+template <std::size_t N_WORDS> struct sort_columns_t {
+    static constexpr std::size_t N_COLS = 2 * N_WORDS;
+    std::array<uint64_t *, N_COLS> cols;
+
+    sort_columns_t() = default;
+    sort_columns_t(psi_block<N_WORDS> &b, std::size_t offset = 0) {
+        for (std::size_t w = 0; w < N_WORDS; w++) {
+            cols[w] = b.beta(w) + offset;
+            cols[N_WORDS + w] = b.alpha(w) + offset;
+        }
+    }
+
+    uint64_t *operator[](std::size_t c) const { return cols[c]; }
+
+    // Whether det i < det j, and det i == det j
+    bool less(std::size_t i, const sort_columns_t &o, std::size_t j) const {
+        for (auto c = N_COLS; c-- > 0;)
+            if (cols[c][i] != o.cols[c][j])
+                return cols[c][i] < o.cols[c][j];
+        return false;
+    }
+    bool equal(std::size_t i, const sort_columns_t &o, std::size_t j) const {
+        for (std::size_t c = 0; c < N_COLS; c++)
+            if (cols[c][i] != o.cols[c][j])
+                return false;
+        return true;
+    }
+    void copy(std::size_t i, const sort_columns_t &o, std::size_t j) const {
+        for (std::size_t c = 0; c < N_COLS; c++)
+            cols[c][i] = o.cols[c][j];
+    }
+    // Copy dets j..j+n of o to i..i+n; the ranges may overlap if i <= j
+    void copy_n(std::size_t i, const sort_columns_t &o, std::size_t j, std::size_t n) const {
+        for (std::size_t c = 0; c < N_COLS; c++)
+            std::copy(o.cols[c] + j, o.cols[c] + j + n, cols[c] + i);
+    }
+    // First det of lo..hi (sorted) not less than det key of o
+    std::size_t lower_bound(std::size_t lo, std::size_t hi, const sort_columns_t &o,
+                            std::size_t key) const {
+        while (lo < hi) {
+            const auto mid = lo + (hi - lo) / 2;
+            if (less(mid, o, key))
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+        return lo;
+    }
+};
+
+// Sort the n dets of `cols` and their payload. `tmp` / `tmp_payload` hold at least n dets, and
+// `dest` n indices, of scratch.
+template <std::size_t N_WORDS, class T>
+void radix_sort(sort_columns_t<N_WORDS> cols, T *payload, std::size_t n,
+                sort_columns_t<N_WORDS> tmp, T *tmp_payload, uint32_t *dest,
+                unsigned n_threads = 1) {
+    constexpr std::size_t N_COLS = 2 * N_WORDS, RADIX = 256;
+    if (n == 0)
+        return;
+    n_threads = std::max<std::size_t>(1, std::min<std::size_t>(n_threads, n / 65536));
+
+    // A digit is skipped when it is the same in every det; compare against det 0 with OR-ed XORs
+    std::array<uint64_t, N_COLS> varying{};
+    for (std::size_t c = 0; c < N_COLS; c++)
+        for (std::size_t i = 0; i < n; i++)
+            varying[c] |= cols[c][i] ^ cols[c][0];
+
+    const sort_columns_t<N_WORDS> original = cols;
+    std::vector<std::array<std::size_t, RADIX>> hist(n_threads);
+    for (std::size_t c = 0; c < N_COLS; c++)
+        for (int shift = 0; shift < 64; shift += 8) {
+            if (!((varying[c] >> shift) & 0xff))
+                continue;
+            const uint64_t *key = cols[c];
+
+            parallel_slices(n_threads, n, [&](unsigned t, std::size_t begin, std::size_t end) {
+                auto &h = hist[t];
+                h.fill(0);
+                for (std::size_t i = begin; i < end; i++)
+                    h[(key[i] >> shift) & 0xff]++;
+            });
+            // Exclusive prefix over (digit, thread): thread t writes digit d after threads < t
+            std::size_t sum = 0;
+            for (std::size_t d = 0; d < RADIX; d++)
+                for (unsigned t = 0; t < n_threads; t++) {
+                    const auto count = hist[t][d];
+                    hist[t][d] = sum;
+                    sum += count;
+                }
+            parallel_slices(n_threads, n, [&](unsigned t, std::size_t begin, std::size_t end) {
+                auto &h = hist[t];
+                for (std::size_t i = begin; i < end; i++)
+                    dest[i] = h[(key[i] >> shift) & 0xff]++;
+                for (std::size_t k = 0; k < N_COLS; k++)
+                    for (std::size_t i = begin; i < end; i++)
+                        tmp[k][dest[i]] = cols[k][i];
+                for (std::size_t i = begin; i < end; i++)
+                    tmp_payload[dest[i]] = payload[i];
+            });
+            std::swap(cols, tmp);
+            std::swap(payload, tmp_payload);
+        }
+
+    // After an odd number of passes the result is in the scratch buffers
+    if (cols[0] != original[0]) {
+        for (std::size_t k = 0; k < N_COLS; k++)
+            std::copy(cols[k], cols[k] + n, tmp[k]);
+        std::copy(payload, payload + n, tmp_payload);
+    }
+}
+
+// Merge consecutive equal dets of the sorted `src` (n of them), summing their payloads, into
+// `dst`, which may alias src. Returns the number of distinct dets.
+template <std::size_t N_WORDS, class T>
+std::size_t reduce_sorted(sort_columns_t<N_WORDS> src, const T *src_payload, std::size_t n,
+                          sort_columns_t<N_WORDS> dst, T *dst_payload) {
+    std::size_t m = 0;
+    for (std::size_t i = 0; i < n; i++) {
+        if (m && dst.equal(m - 1, src, i)) {
+            dst_payload[m - 1] += src_payload[i];
+        } else {
+            dst.copy(m, src, i);
+            dst_payload[m++] = src_payload[i];
+        }
+    }
+    return m;
+}
+
+/*
+Merge the sorted and reduced runs [runs[r], runs[r + 1]) at the front of `dets` (and payload),
+reducing across them. Returns the number of distinct dets, which are then at the front of dets.
+
+Each round takes, from every run, the dets up to the smallest of the dets `step` ahead in each
+run, so at most `round` dets that all sort before the rest. They are split by key range between
+the threads, each merging its part with a heap into its own region of `out`. The output is
+flushed in blocks of `block` dets into slots: the full blocks of dets whose dets were all consumed,
+or n_runs + 1 spare ones, which is enough as only the block of each run head is partly consumed.
+The blocks are finally permuted into place.
+*/
+template <std::size_t N_WORDS, class T>
+std::size_t merge_runs(psi_block<N_WORDS> &dets, std::vector<T> &payload,
+                       const std::vector<std::size_t> &runs, unsigned n_threads,
+                       std::size_t chunk) {
+    constexpr std::size_t NONE = SIZE_MAX;
+    const std::size_t n_runs = runs.size() - 1, total = runs.back();
+    const std::size_t round = std::max(chunk, n_runs);
+    const std::size_t block = std::max<std::size_t>(1, chunk / (n_runs + 1));
+    const std::size_t n_slots = total / block, n_spare = n_runs + 1;
+
+    psi_block<N_WORDS> spare, out;
+    spare.resize(n_spare * block);
+    out.resize(round + block);
+    std::vector<T> spare_payload(n_spare * block), out_payload(round + block);
+    const sort_columns_t<N_WORDS> src(dets), out_cols(out);
+
+    // Slots 0..n_slots are blocks of dets, the others spare blocks
+    auto slot = [&](std::size_t s) {
+        return s < n_slots ? std::pair(sort_columns_t<N_WORDS>(dets, s * block),
+                                       payload.data() + s * block)
+                           : std::pair(sort_columns_t<N_WORDS>(spare, (s - n_slots) * block),
+                                       spare_payload.data() + (s - n_slots) * block);
+    };
+    auto move = [&](std::size_t to, std::size_t from, std::size_t len) {
+        const auto [to_cols, to_payload] = slot(to);
+        const auto [from_cols, from_payload] = slot(from);
+        to_cols.copy_n(0, from_cols, 0, len);
+        std::copy(from_payload, from_payload + len, to_payload);
+    };
+
+    std::vector<std::size_t> free_slots, occupant(n_slots + n_spare, NONE), consumed(n_slots);
+    for (std::size_t s = n_slots + n_spare; s-- > n_slots;)
+        free_slots.push_back(s);
+    // Output block k is in slot loc[k]
+    std::vector<std::size_t> loc;
+    std::size_t n_out = 0, m = 0;
+    auto flush = [&](std::size_t len) {
+        const auto s = free_slots.back();
+        free_slots.pop_back();
+        const auto [cols, slot_payload] = slot(s);
+        cols.copy_n(0, out_cols, 0, len);
+        std::copy(out_payload.data(), out_payload.data() + len, slot_payload);
+        occupant[s] = loc.size();
+        loc.push_back(s);
+        out_cols.copy_n(0, out_cols, len, n_out - len);
+        std::copy(out_payload.data() + len, out_payload.data() + n_out, out_payload.data());
+        n_out -= len;
+        m += len;
+    };
+
+    std::vector<std::size_t> head(runs.begin(), runs.end() - 1), active, hi, cut;
+    while (true) {
+        active.clear();
+        for (std::size_t r = 0; r < n_runs; r++)
+            if (head[r] < runs[r + 1])
+                active.push_back(r);
+        if (active.empty())
+            break;
+
+        // Round bound: all dets not greater than it are at most `round`
+        const std::size_t step = round / active.size();
+        std::size_t bound = NONE;
+        for (auto r : active) {
+            const auto i = std::min(head[r] + step, runs[r + 1]) - 1;
+            if (bound == NONE || src.less(i, src, bound))
+                bound = i;
+        }
+        // hi[a]: end of the round in run active[a]; the widest run gives the thread splitters
+        hi.clear();
+        std::size_t n_in = 0, widest = 0;
+        for (std::size_t a = 0; a < active.size(); a++) {
+            const auto r = active[a];
+            const auto end = std::min(head[r] + step, runs[r + 1]);
+            hi.push_back(src.lower_bound(head[r], end, src, bound));
+            if (hi.back() < end && src.equal(hi.back(), src, bound))
+                hi.back()++;
+            n_in += hi[a] - head[r];
+            if (hi[a] - head[r] > hi[widest] - head[active[widest]])
+                widest = a;
+        }
+
+        // cut[a * (n_t + 1) + t]: start of thread t in run active[a]
+        const unsigned n_t =
+            std::max<std::size_t>(1, std::min<std::size_t>(n_threads, n_in / 65536));
+        const auto w_lo = head[active[widest]], w_len = hi[widest] - w_lo;
+        cut.assign(active.size() * (n_t + 1), 0);
+        for (std::size_t a = 0; a < active.size(); a++) {
+            const auto r = active[a];
+            cut[a * (n_t + 1)] = head[r];
+            for (unsigned t = 1; t < n_t; t++)
+                cut[a * (n_t + 1) + t] =
+                    src.lower_bound(head[r], hi[a], src, w_lo + t * w_len / n_t);
+            cut[a * (n_t + 1) + n_t] = hi[a];
+        }
+        std::vector<std::size_t> offset(n_t + 1, n_out), count(n_t);
+        for (unsigned t = 0; t < n_t; t++) {
+            offset[t + 1] = offset[t];
+            for (std::size_t a = 0; a < active.size(); a++)
+                offset[t + 1] += cut[a * (n_t + 1) + t + 1] - cut[a * (n_t + 1) + t];
+        }
+
+        parallel_slices(n_t, n_t, [&](unsigned t, std::size_t, std::size_t) {
+            std::vector<std::size_t> pos(active.size());
+            for (std::size_t a = 0; a < active.size(); a++)
+                pos[a] = cut[a * (n_t + 1) + t];
+            auto greater = [&](std::size_t a, std::size_t b) {
+                return src.less(pos[b], src, pos[a]);
+            };
+            std::priority_queue<std::size_t, std::vector<std::size_t>, decltype(greater)> queue(
+                greater);
+            for (std::size_t a = 0; a < active.size(); a++)
+                if (pos[a] < cut[a * (n_t + 1) + t + 1])
+                    queue.push(a);
+
+            const auto o = offset[t];
+            std::size_t c = 0;
+            while (!queue.empty()) {
+                const auto a = queue.top();
+                queue.pop();
+                const auto i = pos[a]++;
+                if (c && out_cols.equal(o + c - 1, src, i)) {
+                    out_payload[o + c - 1] += payload[i];
+                } else {
+                    out_cols.copy(o + c, src, i);
+                    out_payload[o + c++] = payload[i];
+                }
+                if (pos[a] < cut[a * (n_t + 1) + t + 1])
+                    queue.push(a);
+            }
+            count[t] = c;
+        });
+        // Thread key ranges are disjoint, and so are those of successive rounds
+        for (unsigned t = 0; t < n_t; t++) {
+            if (offset[t] == n_out) {
+                n_out += count[t];
+                continue;
+            }
+            out_cols.copy_n(n_out, out_cols, offset[t], count[t]);
+            std::copy(out_payload.data() + offset[t], out_payload.data() + offset[t] + count[t],
+                      out_payload.data() + n_out);
+            n_out += count[t];
+        }
+
+        // Free the blocks of dets whose dets were all consumed, then flush the output
+        for (std::size_t a = 0; a < active.size(); a++) {
+            const auto r = active[a];
+            for (auto i = head[r]; i < std::min(hi[a], n_slots * block);) {
+                const auto s = i / block, next = std::min(hi[a], (s + 1) * block);
+                consumed[s] += next - i;
+                if (consumed[s] == block)
+                    free_slots.push_back(s);
+                i = next;
+            }
+            head[r] = hi[a];
+        }
+        while (n_out >= block)
+            flush(block);
+    }
+    if (n_out)
+        flush(n_out);
+
+    // Put output block k in slot k, moving its occupant to a free slot, which is spare or after k.
+    // A last partial block past the last full slot goes to the unused end of dets.
+    for (std::size_t k = 0; k < loc.size(); k++) {
+        const auto len = std::min(block, m - k * block);
+        if (k == n_slots) {
+            const auto [cols, slot_payload] = slot(loc[k]);
+            sort_columns_t<N_WORDS>(dets, k * block).copy_n(0, cols, 0, len);
+            std::copy(slot_payload, slot_payload + len, payload.data() + k * block);
+            break;
+        }
+        if (loc[k] == k)
+            continue;
+        if (const auto j = occupant[k]; j != NONE) {
+            auto f = free_slots.back();
+            for (; f <= k || occupant[f] != NONE; f = free_slots.back())
+                free_slots.pop_back();
+            free_slots.pop_back();
+            move(f, k, std::min(block, m - j * block));
+            occupant[f] = j;
+            loc[j] = f;
+        }
+        move(k, loc[k], len);
+        occupant[loc[k]] = NONE;
+        free_slots.push_back(loc[k]);
+        occupant[k] = k;
+        loc[k] = k;
+    }
+    return m;
+}
+
+/*
+Sort `dets` and merge duplicates, summing their `payload` (payload[i] belongs to dets[i]). On
+return dets holds distinct determinants in psi_block::sort order, and payload their sums.
+*/
+template <std::size_t N_WORDS, class T>
+void sort_reduce(psi_block<N_WORDS> &dets, std::vector<T> &payload, unsigned n_threads = 1,
+                 std::size_t chunk_size = std::size_t(1) << 22) {
+    assert(payload.size() == dets.size());
+    const std::size_t n = dets.size();
+    // chunk indices are 32-bit
+    const std::size_t chunk =
+        std::max<std::size_t>(1, std::min({chunk_size, n, std::size_t(UINT32_MAX)}));
+
+    psi_block<N_WORDS> tmp;
+    tmp.resize(chunk);
+    std::vector<T> tmp_payload(chunk);
+    std::vector<uint32_t> dest(chunk);
+
+    // Sort and reduce each chunk, compacting the reduced runs to the front of dets
+    std::vector<std::size_t> runs{0};
+    for (std::size_t lo = 0; lo < n; lo += chunk) {
+        const std::size_t len = std::min(chunk, n - lo);
+        const sort_columns_t<N_WORDS> cols(dets, lo);
+        radix_sort(cols, payload.data() + lo, len, sort_columns_t<N_WORDS>(tmp), tmp_payload.data(),
+                   dest.data(), n_threads);
+        const std::size_t out = runs.back();
+        runs.push_back(out + reduce_sorted(cols, payload.data() + lo, len,
+                                           sort_columns_t<N_WORDS>(dets, out),
+                                           payload.data() + out));
+    }
+    tmp = psi_block<N_WORDS>();
+    tmp_payload = std::vector<T>();
+    dest = std::vector<uint32_t>();
+
+    if (runs.size() <= 2) {
+        dets.resize(runs.back());
+        dets.shrink_to_fit();
+        payload.resize(runs.back());
+        payload.shrink_to_fit();
+        return;
+    }
+
+    const std::size_t m = merge_runs(dets, payload, runs, n_threads, chunk);
+    dets.resize(m);
+    dets.shrink_to_fit();
+    payload.resize(m);
+    payload.shrink_to_fit();
+}
@@ -0,0 +1,97 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <integral_types.h>
+#include <utility>
+#include <vector>
+
+/*
+Sparse two-electron integrals, screened: for each category, the compound indices of the integrals
+kept, in increasing order, and their values. assign drops the integrals of absolute value below the
+threshold and records their count and norm per category, so that the error of the screening can be
+reported.
+
+The arrays of a category are the (J, J_ind, N) arguments of its kernel in integrals.h, e.g.
+    G_pt2_kernel(J.val(IC_G), J.idx(IC_G), J.size(IC_G), ...)
+so that the kernels only go through the integrals that survived the screening.
+*/
+template <class T> class sparse_tej_t {
+  public:
+    explicit sparse_tej_t(const idx_t n_orb, const T threshold = 0)
+        : m_n_orb(n_orb), m_threshold(threshold) {}
+
+    idx_t n_orb() const { return m_n_orb; }
+    T threshold() const { return m_threshold; }
+
+    // Replace category c by the integrals of the n sorted compound indices idx of values val (e.g.
+    // a category of an fcidump_t or an integral_store_t) that pass the screening
+    void assign(const int c, const idx_t *idx, const T *val, const idx_t n) {
+        m_idx[c].clear();
+        m_val[c].clear();
+        m_n_dropped[c] = 0;
+        m_dropped_sq[c] = 0;
+        for (idx_t p = 0; p < n; p++) {
+            if (std::abs(val[p]) >= m_threshold) {
+                m_idx[c].push_back(idx[p]);
+                m_val[c].push_back(val[p]);
+            } else {
+                m_n_dropped[c]++;
+                m_dropped_sq[c] += val[p] * val[p];
+            }
+        }
+        m_idx[c].shrink_to_fit();
+        m_val[c].shrink_to_fit();
+    }
+
+    T *val(const int c) { return m_val[c].data(); }
+    const T *val(const int c) const { return m_val[c].data(); }
+    idx_t *idx(const int c) { return m_idx[c].data(); }
+    const idx_t *idx(const int c) const { return m_idx[c].data(); }
+    idx_t size(const int c) const { return m_idx[c].size(); }
+    idx_t size() const {
+        idx_t n = 0;
+        for (const auto &idx : m_idx)
+            n += idx.size();
+        return n;
+    }
+
+    // Number and Frobenius norm of the distinct integrals dropped by the screening
+    idx_t n_dropped() const {
+        idx_t n = 0;
+        for (const auto n_c : m_n_dropped)
+            n += n_c;
+        return n;
+    }
+    T dropped_norm() const {
+        T sq = 0;
+        for (const auto sq_c : m_dropped_sq)
+            sq += sq_c;
+        return std::sqrt(sq);
+    }
+
+    // Value of (i, j, k, l), zero if absent or screened out: a binary search in its category
+    T operator()(const idx_t i, const idx_t j, const idx_t k, const idx_t l) const {
+        // canonical order of compound_idx4: (ik) the smaller pair of (ik) and (jl)
+        std::pair<idx_t, idx_t> ik = std::minmax(i, k), jl = std::minmax(j, l);
+        idx_t ik_idx = compound_idx2(ik.first, ik.second);
+        idx_t jl_idx = compound_idx2(jl.first, jl.second);
+        if (ik_idx > jl_idx) {
+            std::swap(ik, jl);
+            std::swap(ik_idx, jl_idx);
+        }
+        const int c = category_idx4(ik.first, jl.first, ik.second, jl.second);
+        const idx_t ijkl = compound_idx2(ik_idx, jl_idx);
+        const auto it = std::lower_bound(m_idx[c].begin(), m_idx[c].end(), ijkl);
+        return it != m_idx[c].end() && *it == ijkl ? m_val[c][it - m_idx[c].begin()] : T(0);
+    }
+
+  private:
+    idx_t m_n_orb;
+    T m_threshold;
+    std::array<std::vector<idx_t>, N_CATEGORIES> m_idx;
+    std::array<std::vector<T>, N_CATEGORIES> m_val;
+    // count and squared norm of the integrals dropped from each category by its last assign
+    std::array<idx_t, N_CATEGORIES> m_n_dropped{};
+    std::array<T, N_CATEGORIES> m_dropped_sq{};
+};
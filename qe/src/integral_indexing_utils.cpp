@@ -1,11 +1,15 @@
+#if !defined(DOCTEST_CONFIG_DISABLE)
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#endif
 #include "integral_indexing_utils.h"
 #include <algorithm>
+#include <doctest/doctest.h>
 #include <iostream>
+#include <random>
 #include <set>
 
 // TODO: profile to see if it would be useful to implement branchless min/max
 // and canonical idx
-// TODO: create array forms with offloading/SIMD ?
 extern "C" idx_t compound_idx2(const idx_t i, const idx_t j) {
     // idx_t p = std::min(i, j);
     // idx_t q = std::max(i, j);
@@ -22,20 +26,9 @@ extern "C" idx_t compound_idx4(const idx_t i, const idx_t j, const idx_t k, cons
 
 idx_t compound_idx4(const ijkl_tuple ijkl) { return compound_idx4(ijkl.i, ijkl.j, ijkl.k, ijkl.l); }
 
-extern "C" struct ij_tuple compound_idx2_reverse(const idx_t ij) {
-    idx_t j = (isqrt(1 + 8 * ij) - 1) / 2;
-    idx_t i = ij - (j * (j + 1) / 2);
-    struct ij_tuple res = {i, j};
-    return res;
-}
+extern "C" struct ij_tuple compound_idx2_reverse(const idx_t ij) { return idx2_reverse(ij); }
 
-extern "C" struct ijkl_tuple compound_idx4_reverse(const idx_t ijkl) {
-    struct ij_tuple ik_jl = compound_idx2_reverse(ijkl);
-    struct ij_tuple ik = compound_idx2_reverse(ik_jl.i);
-    struct ij_tuple jl = compound_idx2_reverse(ik_jl.j);
-    struct ijkl_tuple res = {ik.i, jl.i, ik.j, jl.j};
-    return res;
-}
+extern "C" struct ijkl_tuple compound_idx4_reverse(const idx_t ijkl) { return idx4_reverse(ijkl); }
 
 extern "C" struct ijkl_perms compound_idx4_reverse_all(const idx_t ijkl) {
     struct ijkl_tuple idx = compound_idx4_reverse(ijkl);
@@ -68,6 +61,115 @@ extern "C" struct ijkl_tuple canonical_idx4(const idx_t i, const idx_t j, const
     return res;
 }
 
+// Array forms: element-wise over n indices, with the results in separate (structure-of-arrays)
+// output arrays. The loop bodies are branchless so that the compiler vectorizes them (64-bit
+// min/max and multiplies need AVX-512; see QUANTUM_ENVELOPE_ENABLE_NATIVE).
+static inline idx_t triangle_idx2(const idx_t i, const idx_t j) {
+    const idx_t p = i < j ? i : j;
+    const idx_t q = i < j ? j : i;
+    return (q * (q + 1)) / 2 + p;
+}
+
+extern "C" void compound_idx2_batch(const idx_t *__restrict i, const idx_t *__restrict j,
+                                    idx_t *__restrict ij, const idx_t n) {
+    for (idx_t x = 0; x < n; x++)
+        ij[x] = triangle_idx2(i[x], j[x]);
+}
+
+extern "C" void compound_idx4_batch(const idx_t *__restrict i, const idx_t *__restrict j,
+                                    const idx_t *__restrict k, const idx_t *__restrict l,
+                                    idx_t *__restrict ijkl, const idx_t n) {
+    for (idx_t x = 0; x < n; x++)
+        ijkl[x] = triangle_idx2(triangle_idx2(i[x], k[x]), triangle_idx2(j[x], l[x]));
+}
+
+extern "C" void canonical_idx4_batch(const idx_t *__restrict i, const idx_t *__restrict j,
+                                     const idx_t *__restrict k, const idx_t *__restrict l,
+                                     idx_t *__restrict out_i, idx_t *__restrict out_j,
+                                     idx_t *__restrict out_k, idx_t *__restrict out_l,
+                                     const idx_t n) {
+    for (idx_t x = 0; x < n; x++) {
+        const idx_t ii = i[x] < k[x] ? i[x] : k[x];
+        const idx_t kk = i[x] < k[x] ? k[x] : i[x];
+        const idx_t jj = j[x] < l[x] ? j[x] : l[x];
+        const idx_t ll = j[x] < l[x] ? l[x] : j[x];
+        const bool keep = triangle_idx2(ii, kk) <= triangle_idx2(jj, ll);
+        out_i[x] = keep ? ii : jj;
+        out_j[x] = keep ? jj : ii;
+        out_k[x] = keep ? kk : ll;
+        out_l[x] = keep ? ll : kk;
+    }
+}
+
+extern "C" void compound_idx2_reverse_batch(const idx_t *__restrict ij, idx_t *__restrict i,
+                                            idx_t *__restrict j, const idx_t n) {
+    for (idx_t x = 0; x < n; x++) {
+        const ij_tuple t = idx2_reverse(ij[x]);
+        i[x] = t.i;
+        j[x] = t.j;
+    }
+}
+
+extern "C" void compound_idx4_reverse_batch(const idx_t *__restrict ijkl, idx_t *__restrict i,
+                                            idx_t *__restrict j, idx_t *__restrict k,
+                                            idx_t *__restrict l, const idx_t n) {
+    for (idx_t x = 0; x < n; x++) {
+        const ijkl_tuple t = idx4_reverse(ijkl[x]);
+        i[x] = t.i;
+        j[x] = t.j;
+        k[x] = t.k;
+        l[x] = t.l;
+    }
+}
+
+TEST_CASE("testing isqrt") {
+    for (uint64_t r : {0ull, 1ull, 2ull, 67108863ull, 67108864ull, 94906265ull, 3037000499ull})
+        for (uint64_t n : {r * r, r * r + 2 * r, r * r - 1}) {
+            if (n > (uint64_t)INT64_MAX)
+                continue;
+            const uint64_t s = isqrt(n);
+            CHECK(s * s <= n);
+            CHECK((s + 1) * (s + 1) > n);
+        }
+    CHECK(isqrt(INT64_MAX) == 3037000499);
+}
+
+TEST_CASE("testing compound_idx2_reverse") {
+    std::mt19937_64 rng(0);
+    // just below and at triangular numbers, where a double precision sqrt rounds up past 2^52
+    for (int n = 0; n < 10000; n++) {
+        const idx_t q = rng() % ((idx_t)1 << 30);
+        for (const idx_t ij : {q * (q + 1) / 2 - 1, q * (q + 1) / 2, (idx_t)(rng() >> 4)}) {
+            if (ij < 0)
+                continue;
+            const ij_tuple t = compound_idx2_reverse(ij);
+            CHECK(0 <= t.i);
+            CHECK(t.i <= t.j);
+            CHECK(compound_idx2(t.i, t.j) == ij);
+        }
+    }
+}
+
+TEST_CASE("testing reverse batches and compound_idx_table_t") {
+    const idx_t n_orb = 40;
+    const compound_idx_table_t table(n_orb);
+    CHECK(table.n_pairs() == n_orb * (n_orb + 1) / 2);
+
+    std::vector<idx_t> ijkl(table.n_pairs() * (table.n_pairs() + 1) / 2);
+    for (idx_t x = 0; x < (idx_t)ijkl.size(); x++)
+        ijkl[x] = x;
+    const idx_t n = ijkl.size();
+    std::vector<idx_t> i(n), j(n), k(n), l(n), back(n);
+    compound_idx4_reverse_batch(ijkl.data(), i.data(), j.data(), k.data(), l.data(), n);
+    compound_idx4_batch(i.data(), j.data(), k.data(), l.data(), back.data(), n);
+    CHECK(back == ijkl);
+    for (idx_t x = 0; x < n; x++) {
+        const ijkl_tuple t = table.idx4_reverse(x);
+        REQUIRE(t == compound_idx4_reverse(x));
+        REQUIRE(t == ijkl_tuple{i[x], j[x], k[x], l[x]});
+    }
+}
+
 /*
 extern "C" int get_unique_idx4(ijkl_tuple* u_idx, const ijkl_perms all_idx){
     // Construct std::set, iterate through items and assign to output pointer
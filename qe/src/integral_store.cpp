@@ -0,0 +1,160 @@
+#if !defined(DOCTEST_CONFIG_DISABLE)
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#endif
+#include "integral_store.h"
+#include <cstdio>
+#include <cstring>
+#include <doctest/doctest.h>
+#include <fcntl.h>
+#include <filesystem>
+#include <iostream>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr uint64_t ALIGNMENT = 64;
+
+uint64_t align(const uint64_t offset) { return (offset + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT; }
+
+} // namespace
+
+void write_integral_store(const std::string &path, const fcidump_t &f) {
+    integral_store_header_t h{};
+    std::memcpy(h.magic, INTEGRAL_STORE_MAGIC, sizeof(h.magic));
+    h.version = INTEGRAL_STORE_VERSION;
+    h.n_orb = f.n_orb;
+    h.E0 = f.E0;
+    uint64_t offset = align(sizeof(h));
+    h.one_e_offset = offset;
+    offset = align(offset + f.one_e.size() * sizeof(double));
+    for (int c = 0; c < N_CATEGORIES; c++) {
+        auto &s = h.categories[c];
+        s.count = f.two_e_idx[c].size();
+        s.idx_offset = offset;
+        s.val_offset = align(offset + s.count * sizeof(idx_t));
+        offset = align(s.val_offset + s.count * sizeof(double));
+    }
+    h.file_size = offset;
+
+    const std::string tmp = path + ".tmp";
+    FILE *out = std::fopen(tmp.c_str(), "wb");
+    if (!out)
+        throw std::runtime_error("integral store: cannot create " + tmp);
+    // write `bytes` at `at`, zero padding from the current position
+    uint64_t pos = 0;
+    bool ok = true;
+    auto write = [&](uint64_t at, const void *data, uint64_t bytes) {
+        static const char zeros[ALIGNMENT] = {};
+        ok = ok && std::fwrite(zeros, 1, at - pos, out) == at - pos;
+        ok = ok && (!bytes || std::fwrite(data, 1, bytes, out) == bytes);
+        pos = at + bytes;
+    };
+    write(0, &h, sizeof(h));
+    write(h.one_e_offset, f.one_e.data(), f.one_e.size() * sizeof(double));
+    for (int c = 0; c < N_CATEGORIES; c++) {
+        const auto &s = h.categories[c];
+        write(s.idx_offset, f.two_e_idx[c].data(), s.count * sizeof(idx_t));
+        write(s.val_offset, f.two_e_val[c].data(), s.count * sizeof(double));
+    }
+    write(h.file_size, nullptr, 0);
+    ok = (std::fclose(out) == 0) && ok;
+    if (!ok || std::rename(tmp.c_str(), path.c_str()) != 0) {
+        std::remove(tmp.c_str());
+        throw std::runtime_error("integral store: cannot write " + path);
+    }
+}
+
+integral_store_t::integral_store_t(const std::string &path) {
+    const int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        throw std::runtime_error("integral store: cannot open " + path);
+    struct stat st;
+    if (fstat(fd, &st) == 0 && st.st_size >= (off_t)sizeof(integral_store_header_t)) {
+        m_size = st.st_size;
+        m_data = mmap(nullptr, m_size, PROT_READ, MAP_SHARED, fd, 0);
+        if (m_data == MAP_FAILED)
+            m_data = nullptr;
+    }
+    close(fd);
+    if (!m_data)
+        throw std::runtime_error("integral store: cannot map " + path);
+
+    const auto &h = header();
+    const char *error = nullptr;
+    if (std::memcmp(h.magic, INTEGRAL_STORE_MAGIC, sizeof(h.magic)) != 0)
+        error = "not an integral store";
+    else if (h.version != INTEGRAL_STORE_VERSION)
+        error = "unsupported version";
+    else if (h.file_size != m_size || h.n_orb < 0 ||
+             h.one_e_offset + h.n_orb * h.n_orb * sizeof(double) > m_size)
+        error = "truncated file";
+    for (const auto &c : h.categories)
+        if (!error && (c.val_offset + c.count * sizeof(double) > m_size ||
+                       c.idx_offset + c.count * sizeof(idx_t) > c.val_offset))
+            error = "truncated file";
+    if (error) {
+        munmap(m_data, m_size);
+        throw std::runtime_error(std::string("integral store: ") + error + " in " + path);
+    }
+}
+
+integral_store_t::~integral_store_t() { munmap(m_data, m_size); }
+
+extern "C" int integral_store_write_fcidump(const char *fcidump_path, const char *store_path,
+                                            const int n_threads) {
+    const unsigned threads = n_threads > 0 ? n_threads : std::thread::hardware_concurrency();
+    try {
+        write_integral_store(store_path, load_fcidump(fcidump_path, threads));
+        return 0;
+    } catch (const std::exception &e) {
+        std::cerr << e.what() << '\n';
+        return -1;
+    }
+}
+
+TEST_CASE("testing integral_store_t") {
+    fcidump_t f;
+    f.n_orb = 3;
+    f.E0 = 1.5;
+    f.one_e = {1, 2, 3, 2, 4, 5, 3, 5, 6};
+    f.two_e_idx[IC_A] = {0, 2, 5};
+    f.two_e_val[IC_A] = {0.5, 0.25, 0.125};
+    f.two_e_idx[IC_G] = {compound_idx4(0, 1, 2, 3)};
+    f.two_e_val[IC_G] = {-1};
+
+    const auto path = (std::filesystem::temp_directory_path() / "qe_test.integrals").string();
+    write_integral_store(path, f);
+    {
+        const integral_store_t store(path);
+        CHECK(store.n_orb() == 3);
+        CHECK(store.E0() == 1.5);
+        CHECK(std::vector<double>(store.one_e(), store.one_e() + 9) == f.one_e);
+        for (int c = 0; c < N_CATEGORIES; c++) {
+            const auto s = store.two_e(c);
+            CHECK(reinterpret_cast<uintptr_t>(s.idx) % 64 == 0);
+            CHECK(reinterpret_cast<uintptr_t>(s.val) % 64 == 0);
+            CHECK(std::vector<idx_t>(s.idx, s.idx + s.size) == f.two_e_idx[c]);
+            CHECK(std::vector<double>(s.val, s.val + s.size) == f.two_e_val[c]);
+        }
+    }
+
+    // a newer format, and a truncated file
+    integral_store_header_t h;
+    FILE *file = std::fopen(path.c_str(), "rb");
+    REQUIRE(std::fread(&h, sizeof(h), 1, file) == 1);
+    std::fclose(file);
+    h.version++;
+    file = std::fopen(path.c_str(), "r+b");
+    std::fwrite(&h, sizeof(h), 1, file);
+    std::fclose(file);
+    CHECK_THROWS_AS(integral_store_t{path}, std::runtime_error);
+
+    write_integral_store(path, f);
+    std::filesystem::resize_file(path, std::filesystem::file_size(path) - 64);
+    CHECK_THROWS_AS(integral_store_t{path}, std::runtime_error);
+    std::filesystem::remove(path);
+    CHECK_THROWS_AS(integral_store_t{path}, std::runtime_error);
+}
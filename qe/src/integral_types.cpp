@@ -1,43 +1,115 @@
+#if !defined(DOCTEST_CONFIG_DISABLE)
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#endif
 #include "integral_types.h"
+#include <doctest/doctest.h>
 #include <iostream>
-#include <stdexcept>
+#include <vector>
 
 extern "C" char integral_category(const idx_t i, const idx_t j, const idx_t k, const idx_t l) {
+    if (!(ijkl_tuple{i, j, k, l} == canonical_idx4(i, j, k, l)))
+        std::cerr << "Input integral not canonical." << '\n';
+    return 'A' + category_idx4(i, j, k, l);
+}
 
-    struct ijkl_tuple in_idx = {i, j, k, l};
-    struct ijkl_tuple can_idx = canonical_idx4(i, j, k, l);
+extern "C" void integral_category_batch(const idx_t *__restrict ijkl, j_category *__restrict cat,
+                                        const idx_t n) {
+    for (idx_t x = 0; x < n; x++)
+        cat[x] = category_idx4(idx4_reverse(ijkl[x]));
+}
 
-    try {
-        bool canonical = in_idx == can_idx;
-        if (!canonical)
-            throw std::invalid_argument("Input integral not canonical.");
-    } catch (const std::invalid_argument &e) {
-        std::cerr << e.what() << '\n';
+extern "C" idx_t integral_category_ijkl_batch(const idx_t *__restrict i, const idx_t *__restrict j,
+                                              const idx_t *__restrict k, const idx_t *__restrict l,
+                                              j_category *__restrict cat, const idx_t n) {
+    idx_t n_non_canonical = 0;
+    for (idx_t x = 0; x < n; x++) {
+        const ijkl_tuple t = canonical_idx4(i[x], j[x], k[x], l[x]);
+        n_non_canonical += !(t == ijkl_tuple{i[x], j[x], k[x], l[x]});
+        cat[x] = category_idx4(t);
     }
+    return n_non_canonical;
+}
 
-    // How fast does this need to be? How often are the integral categories
-    // calculated?
-    char res;
-
-    if (i == l) {
-        res = 'A';
-    } else if ((i == k) && (j == l)) {
-        res = 'B';
-    } else if ((i == k) || (j == l)) {
-        if (j == k) {
-            res = 'D';
-        } else {
-            res = 'C';
-        }
-    } else if (j == k) {
-        res = 'E';
-    } else if ((i == j) && (k == l)) {
-        res = 'F';
-    } else if ((i == j) || (k == l)) {
-        res = 'E';
-    } else {
-        res = 'G';
+extern "C" void integral_category_partition(const idx_t *__restrict ijkl, const idx_t n,
+                                            idx_t *__restrict out, idx_t *__restrict offsets) {
+    // classify and count in one pass over the indices, then scatter
+    std::vector<j_category> cat(n);
+    std::array<idx_t, IC_G + 1> count{};
+    for (idx_t x = 0; x < n; x++) {
+        cat[x] = category_idx4(idx4_reverse(ijkl[x]));
+        count[cat[x]]++;
     }
+    offsets[0] = 0;
+    for (int c = 0; c <= IC_G; c++)
+        offsets[c + 1] = offsets[c] + count[c];
+    std::array<idx_t, IC_G + 1> next;
+    std::copy(offsets, offsets + IC_G + 1, next.begin());
+    for (idx_t x = 0; x < n; x++)
+        out[next[cat[x]]++] = ijkl[x];
+}
+
+TEST_CASE("testing integral categories") {
+    // The if/else ladder the table is built from, on the indices themselves
+    auto category_ladder = [](const idx_t i, const idx_t j, const idx_t k, const idx_t l) {
+        if (i == l)
+            return 'A';
+        if ((i == k) && (j == l))
+            return 'B';
+        if ((i == k) || (j == l))
+            return (j == k) ? 'D' : 'C';
+        if (j == k)
+            return 'E';
+        if ((i == j) && (k == l))
+            return 'F';
+        if ((i == j) || (k == l))
+            return 'E';
+        return 'G';
+    };
+
+    const idx_t n_orb = 9;
+    std::vector<idx_t> ijkl, i, j, k, l;
+    for (idx_t a = 0; a < n_orb; a++)
+        for (idx_t b = 0; b < n_orb; b++)
+            for (idx_t c = 0; c < n_orb; c++)
+                for (idx_t d = 0; d < n_orb; d++) {
+                    i.push_back(a), j.push_back(b), k.push_back(c), l.push_back(d);
+                    const ijkl_tuple t = canonical_idx4(a, b, c, d);
+                    if (t == ijkl_tuple{a, b, c, d})
+                        ijkl.push_back(compound_idx4(a, b, c, d));
+                }
+    const idx_t n = ijkl.size();
+    CHECK(n == (n_orb * (n_orb + 1) / 2) * (n_orb * (n_orb + 1) / 2 + 1) / 2);
 
-    return res;
+    std::vector<j_category> cat(n);
+    integral_category_batch(ijkl.data(), cat.data(), n);
+    for (idx_t x = 0; x < n; x++) {
+        const ijkl_tuple t = compound_idx4_reverse(ijkl[x]);
+        REQUIRE('A' + cat[x] == category_ladder(t.i, t.j, t.k, t.l));
+        REQUIRE('A' + cat[x] == integral_category(t.i, t.j, t.k, t.l));
+    }
+
+    SUBCASE("non-canonical tuples") {
+        const idx_t m = i.size();
+        std::vector<j_category> cat_ijkl(m);
+        CHECK(integral_category_ijkl_batch(i.data(), j.data(), k.data(), l.data(),
+                                           cat_ijkl.data(), m) == m - n);
+        for (idx_t x = 0; x < m; x++)
+            CHECK(cat_ijkl[x] ==
+                  category_idx4(compound_idx4_reverse(compound_idx4(i[x], j[x], k[x], l[x]))));
+    }
+
+    SUBCASE("partition") {
+        std::vector<idx_t> out(n), offsets(IC_G + 2);
+        integral_category_partition(ijkl.data(), n, out.data(), offsets.data());
+        CHECK(offsets[0] == 0);
+        CHECK(offsets[IC_G + 1] == n);
+        for (int c = 0; c <= IC_G; c++) {
+            std::vector<idx_t> expected;
+            for (idx_t x = 0; x < n; x++)
+                if (cat[x] == c)
+                    expected.push_back(ijkl[x]);
+            CHECK(std::vector<idx_t>(out.begin() + offsets[c], out.begin() + offsets[c + 1]) ==
+                  expected);
+        }
+    }
 }
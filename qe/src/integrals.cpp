@@ -0,0 +1,359 @@
+#if !defined(DOCTEST_CONFIG_DISABLE)
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#endif
+#include <doctest/doctest.h>
+#include <integral_store.h>
+#include <integrals.h>
+#include <random>
+#include <set>
+
+// Every kernel, so that the header keeps compiling
+template void e_pt2_ii_OE<double>(double *, idx_t, const double, det_t *, idx_t, double *);
+template void e_pt2_ij_OE<double>(double *, idx_t, det_t *, idx_t, det_t *, idx_t, double *);
+template void A_pt2_kernel<double>(const double *, idx_t, det_t *, idx_t, double *);
+template void A_pt2_kernel<double, 2>(const double *, idx_t, const psi_block_view<2> &, double *);
+template void B_pt2_kernel<double>(const double *, const idx_t *, idx_t, det_t *, idx_t, double *);
+template void B_pt2_kernel<double, 2>(const double *, const idx_t *, idx_t,
+                                      const psi_block_view<2> &, double *);
+template void C_pt2_kernel<double>(const double *, const idx_t *, idx_t, det_t *, idx_t, det_t *,
+                                   idx_t, double *);
+template void C_pt2_kernel<double, 2>(const double *, const idx_t *, idx_t,
+                                      const psi_block_view<2> &, const psi_block_view<2> &,
+                                      double *);
+template void D_pt2_kernel<double>(const double *, const idx_t *, idx_t, det_t *, idx_t, det_t *,
+                                   idx_t, double *);
+template void D_pt2_kernel<double, 2>(const double *, const idx_t *, idx_t,
+                                      const psi_block_view<2> &, const psi_block_view<2> &,
+                                      double *);
+template void E_pt2_kernel<double>(const double *, const idx_t *, idx_t, det_t *, idx_t, det_t *,
+                                   idx_t, double *);
+template void E_pt2_kernel<double, 2>(const double *, const idx_t *, idx_t,
+                                      const psi_block_view<2> &, const psi_block_view<2> &,
+                                      double *);
+template void E_pt2_kernel<double, spin_det_t>(const double *, const idx_t *, idx_t, const det_t *,
+                                               idx_t, const psi_index<spin_det_t> &, double *);
+template void F_pt2_kernel<double>(const double *, const idx_t *, idx_t, det_t *, idx_t, det_t *,
+                                   idx_t, double *);
+template void F_pt2_kernel<double, spin_det_t>(const double *, const idx_t *, idx_t, const det_t *,
+                                               idx_t, const psi_index<spin_det_t> &, double *);
+template void F_pt2_kernel_denom<double>(const double *, const idx_t *, idx_t, det_t *, idx_t,
+                                         double *);
+template void F_pt2_kernel_denom<double, 2>(const double *, const idx_t *, idx_t,
+                                            const psi_block_view<2> &, double *);
+template void G_pt2_kernel<double>(const double *, const idx_t *, idx_t, det_t *, idx_t, det_t *,
+                                   idx_t, double *);
+template void G_pt2_kernel<double, 2>(const double *, const idx_t *, idx_t,
+                                      const psi_block_view<2> &, const psi_block_view<2> &,
+                                      double *);
+template void G_pt2_kernel<double, spin_det_t>(const double *, const idx_t *, idx_t, const det_t *,
+                                               idx_t, const psi_index<spin_det_t> &, double *);
+
+namespace {
+
+// Move n random electrons of `spin` of d to random empty orbitals
+det_t excite(det_t d, int spin, int n, std::mt19937 &rng) {
+    const auto n_orb = d[spin].size();
+    for (int k = 0; k < n;) {
+        const auto h = rng() % n_orb, p = rng() % n_orb;
+        if (d[spin][h] && !d[spin][p]) {
+            d[spin][h] = 0;
+            d[spin][p] = 1;
+            k++;
+        }
+    }
+    return d;
+}
+
+// Small internal space, and an external space of its singles, doubles and a few triples
+struct kernel_space_t {
+    std::vector<det_t> psi_int, psi_ext;
+
+    explicit kernel_space_t(std::size_t n_orb) {
+        std::mt19937 rng(0);
+        det_t ref{spin_det_t(n_orb), spin_det_t(n_orb)};
+        for (int k = 0; k < 4; k++)
+            ref[0][k] = 1;
+        for (int k = 0; k < 3; k++)
+            ref[1][k] = 1;
+        std::set<det_t> ints, exts;
+        while (ints.size() < 5)
+            ints.insert(excite(excite(ref, 0, rng() % 3, rng), 1, rng() % 3, rng));
+        for (const auto &d : ints)
+            for (int k = 0; k < 8; k++)
+                for (const auto &[n_a, n_b] : {std::pair<int, int>{1, 0}, {0, 1}, {2, 0}, {0, 2},
+                                               {1, 1}, {2, 1}})
+                    exts.insert(excite(excite(d, 0, n_a, rng), 1, n_b, rng));
+        for (const auto &d : ints)
+            exts.erase(d);
+        psi_int.assign(ints.begin(), ints.end());
+        psi_ext.assign(exts.begin(), exts.end());
+        std::shuffle(psi_ext.begin(), psi_ext.end(), rng);
+    }
+};
+
+// Canonical compound indices of the integrals of category c over n_orb orbitals
+std::vector<idx_t> category_indices(j_category c, idx_t n_orb) {
+    std::vector<idx_t> J_ind;
+    for (idx_t ijkl = 0; ijkl < compound_idx4(n_orb, 0, 0, 0); ijkl++)
+        if (category_idx4(idx4_reverse(ijkl)) == c)
+            J_ind.push_back(ijkl);
+    return J_ind;
+}
+
+// Run `kernel` and the det_t scan `reference` on the integrals of category c, with random values,
+// and compare their contributions to the external space
+template <class Reference, class Kernel>
+void check_kernel(j_category c, idx_t n_orb, idx_t n_ext, Reference &&reference,
+                  Kernel &&kernel) {
+    auto J_ind = category_indices(c, n_orb);
+    std::mt19937 rng(c);
+    std::uniform_real_distribution<double> dist(-1, 1);
+    std::vector<double> J(J_ind.size());
+    for (auto &v : J)
+        v = dist(rng);
+
+    std::vector<double> expected(n_ext), res(n_ext);
+    reference(J.data(), J_ind.data(), (idx_t)J.size(), expected.data());
+    kernel(J.data(), J_ind.data(), (idx_t)J.size(), res.data());
+    CHECK(std::count(expected.begin(), expected.end(), 0.) < n_ext);
+    for (idx_t d_e = 0; d_e < n_ext; d_e++)
+        REQUIRE(res[d_e] == doctest::Approx(expected[d_e]));
+}
+
+} // namespace
+
+TEST_CASE("testing C, D and E block kernels") {
+    const idx_t n_orb = 12;
+    kernel_space_t space(n_orb);
+    auto &[psi_int, psi_ext] = space;
+    const idx_t N_int = psi_int.size(), N_ext = psi_ext.size();
+    const psi_block<1> block_int(psi_int.data(), N_int), block_ext(psi_ext.data(), N_ext);
+
+#define CHECK_BLOCK_KERNEL(c, kernel)                                                              \
+    check_kernel(                                                                                  \
+        c, n_orb, N_ext,                                                                           \
+        [&](double *J, idx_t *J_ind, idx_t N, double *res) {                                       \
+            kernel(J, J_ind, N, psi_int.data(), N_int, psi_ext.data(), N_ext, res);                \
+        },                                                                                         \
+        [&](double *J, idx_t *J_ind, idx_t N, double *res) {                                       \
+            kernel(J, J_ind, N, block_int.view(), block_ext.view(), res);                          \
+        })
+    CHECK_BLOCK_KERNEL(IC_C, C_pt2_kernel);
+    CHECK_BLOCK_KERNEL(IC_D, D_pt2_kernel);
+    CHECK_BLOCK_KERNEL(IC_E, E_pt2_kernel);
+#undef CHECK_BLOCK_KERNEL
+}
+
+TEST_CASE("testing A, B, F and G block kernels") {
+    const idx_t n_orb = 12;
+    kernel_space_t space(n_orb);
+    auto &[psi_int, psi_ext] = space;
+    const idx_t N_int = psi_int.size(), N_ext = psi_ext.size();
+    const psi_block<1> block_int(psi_int.data(), N_int), block_ext(psi_ext.data(), N_ext);
+
+    // denominator kernels only see the external space
+    check_kernel(
+        IC_A, n_orb, N_ext,
+        [&](double *J, idx_t *, idx_t N, double *res) {
+            A_pt2_kernel(J, N, psi_ext.data(), N_ext, res);
+        },
+        [&](double *J, idx_t *, idx_t N, double *res) {
+            A_pt2_kernel(J, N, block_ext.view(), res);
+        });
+    check_kernel(
+        IC_B, n_orb, N_ext,
+        [&](double *J, idx_t *J_ind, idx_t N, double *res) {
+            B_pt2_kernel(J, J_ind, N, psi_ext.data(), N_ext, res);
+        },
+        [&](double *J, idx_t *J_ind, idx_t N, double *res) {
+            B_pt2_kernel(J, J_ind, N, block_ext.view(), res);
+        });
+    check_kernel(
+        IC_F, n_orb, N_ext,
+        [&](double *J, idx_t *J_ind, idx_t N, double *res) {
+            F_pt2_kernel_denom(J, J_ind, N, psi_ext.data(), N_ext, res);
+        },
+        [&](double *J, idx_t *J_ind, idx_t N, double *res) {
+            F_pt2_kernel_denom(J, J_ind, N, block_ext.view(), res);
+        });
+    check_kernel(
+        IC_G, n_orb, N_ext,
+        [&](double *J, idx_t *J_ind, idx_t N, double *res) {
+            G_pt2_kernel(J, J_ind, N, psi_int.data(), N_int, psi_ext.data(), N_ext, res);
+        },
+        [&](double *J, idx_t *J_ind, idx_t N, double *res) {
+            G_pt2_kernel(J, J_ind, N, block_int.view(), block_ext.view(), res);
+        });
+}
+
+TEST_CASE("testing E, F and G indexed kernels") {
+    const idx_t n_orb = 12;
+    kernel_space_t space(n_orb);
+    auto &[psi_int, psi_ext] = space;
+    const idx_t N_int = psi_int.size(), N_ext = psi_ext.size();
+    const psi_index<spin_det_t> index_ext(psi_ext);
+
+#define CHECK_INDEXED_KERNEL(c, kernel)                                                            \
+    check_kernel(                                                                                  \
+        c, n_orb, N_ext,                                                                           \
+        [&](double *J, idx_t *J_ind, idx_t N, double *res) {                                       \
+            kernel(J, J_ind, N, psi_int.data(), N_int, psi_ext.data(), N_ext, res);                \
+        },                                                                                         \
+        [&](double *J, idx_t *J_ind, idx_t N, double *res) {                                       \
+            kernel(J, J_ind, N, psi_int.data(), N_int, index_ext, res);                            \
+        })
+    // E covers the E_bcfh flags and the beta phase of E_24, G the same spin doubles
+    CHECK_INDEXED_KERNEL(IC_E, E_pt2_kernel);
+    CHECK_INDEXED_KERNEL(IC_F, F_pt2_kernel);
+    CHECK_INDEXED_KERNEL(IC_G, G_pt2_kernel);
+#undef CHECK_INDEXED_KERNEL
+}
+
+TEST_CASE("testing G same spin doubles outside G_11 .. G_44") {
+    // alpha q s -> r t is none of G_11 .. G_44 of J_qrst, while beta q r sets G_11 so that the
+    // internal det is not skipped: the double belongs to another integral and contributes 0
+    idx_t J_ind[1] = {compound_idx4(0, 1, 2, 3)};
+    const auto [q, r, s, t] = idx4_reverse(J_ind[0]);
+    const idx_t n_orb = 6;
+    det_t d_int{spin_det_t(n_orb), spin_det_t(n_orb)};
+    d_int[0][q] = d_int[0][s] = 1;
+    d_int[1][q] = d_int[1][r] = 1;
+    det_t d_ext = d_int;
+    d_ext[0] = spin_det_t(n_orb);
+    d_ext[0][r] = d_ext[0][t] = 1;
+
+    const auto g = G_same_spin_flags(d_int, q, r, s, t);
+    CHECK(g == std::array<int, 4>{2, 0, 0, 0});
+    const auto exc = get_excitation_info(d_int, d_ext);
+    CHECK(G_pt2_phase(exc, phase_mask_t<spin_det_t>(d_int), g, q, r, s, t) == 0);
+
+    double J[1] = {1.}, res[3] = {};
+    G_pt2_kernel(J, J_ind, 1, &d_int, 1, &d_ext, 1, res);
+    const psi_block<1> block_int(&d_int, 1), block_ext(&d_ext, 1);
+    G_pt2_kernel(J, J_ind, 1, block_int.view(), block_ext.view(), res + 1);
+    G_pt2_kernel(J, J_ind, 1, &d_int, 1, psi_index<spin_det_t>(&d_ext, 1), res + 2);
+    CHECK(res[0] == 0);
+    CHECK(res[1] == 0);
+    CHECK(res[2] == 0);
+}
+
+TEST_CASE("testing OEJ") {
+    const idx_t N_orb = 4;
+    std::vector<double> one_e(N_orb * N_orb);
+    for (idx_t i = 0; i < N_orb; i++)
+        for (idx_t j = 0; j < N_orb; j++)
+            one_e[i * N_orb + j] = 1 + std::min(i, j) + 10 * std::max(i, j);
+
+    OEJ<double> J(N_orb);
+    J.assign_dense(one_e.data());
+    CHECK(J.active_orbitals == std::vector<idx_t>{0, 1, 2, 3});
+    for (idx_t i = 0; i < N_orb; i++)
+        for (idx_t j = 0; j < N_orb; j++) {
+            CHECK(J.owns_index(i, j));
+            CHECK(J(i, j) == one_e[i * N_orb + j]);
+        }
+
+    // pairs (0, 2), (1, 2) and (2, 2)
+    OEJ<double> J_part(N_orb, 3, 6);
+    J_part.assign_dense(one_e.data());
+    CHECK(J_part.active_orbitals == std::vector<idx_t>{0, 1, 2});
+    CHECK(J_part(2, 0) == 21);
+    CHECK(J_part(2, 2) == 23);
+    CHECK(J_part(1, 1) == 0);
+    CHECK(J_part(3, 0) == 0);
+    CHECK(!J_part.owns_index(3, 3));
+    CHECK(J_part[4] == 22);
+
+    spin_det_t s(N_orb);
+    s.set(3);
+    CHECK(!J_part.det_in_chunk(s));
+    s.set(1);
+    CHECK(J_part.det_in_chunk(s));
+
+    CHECK_THROWS_AS(OEJ<double>(N_orb, 2, 11), std::invalid_argument);
+}
+
+TEST_CASE("testing TEJ") {
+    const idx_t N_orb = 5;
+    const idx_t n = TEJ<double>::n_integrals(N_orb);
+    std::vector<idx_t> idx(n);
+    std::vector<double> val(n);
+    for (idx_t ijkl = 0; ijkl < n; ijkl++) {
+        idx[ijkl] = ijkl;
+        val[ijkl] = ijkl + 0.5;
+    }
+
+    for (const auto &[sidx, eidx] : {std::pair<idx_t, idx_t>{0, n}, {17, 18}, {40, 100}}) {
+        TEJ<double> J(N_orb, sidx, eidx);
+        J.assign(idx.data(), val.data(), n);
+        CHECK((idx_t)J.integrals.size() == eidx - sidx);
+
+        std::array<bool, N_CATEGORIES> categories{};
+        spin_det_t orbitals(N_orb);
+        for (idx_t i = 0; i < N_orb; i++)
+            for (idx_t j = 0; j < N_orb; j++)
+                for (idx_t k = 0; k < N_orb; k++)
+                    for (idx_t l = 0; l < N_orb; l++) {
+                        const idx_t ijkl = compound_idx4(i, j, k, l);
+                        const bool owned = ijkl >= sidx && ijkl < eidx;
+                        REQUIRE(J.owns_index(i, j, k, l) == owned);
+                        REQUIRE(J(i, j, k, l) == (owned ? ijkl + 0.5 : 0));
+                        if (owned) {
+                            categories[category_idx4(idx4_reverse(ijkl))] = true;
+                            for (const idx_t o : {i, j, k, l})
+                                orbitals.set(o);
+                        }
+                    }
+        CHECK(J.owned_categories == categories);
+        CHECK(J.orbital_mask == orbitals);
+        CHECK((idx_t)J.active_orbitals.size() == (idx_t)orbitals.count());
+    }
+
+    CHECK_THROWS_AS(TEJ<double>(N_orb, 5, 4), std::invalid_argument);
+}
+
+TEST_CASE("testing TEJView") {
+    const idx_t N_orb = 6;
+    const kernel_space_t space(N_orb);
+    auto psi_int = space.psi_int, psi_ext = space.psi_ext;
+    const idx_t N_int = psi_int.size(), N_ext = psi_ext.size();
+
+    // every other G integral, as the section of a store
+    std::vector<idx_t> idx;
+    std::vector<double> val;
+    for (const idx_t ijkl : category_indices(IC_G, N_orb))
+        if (ijkl % 2) {
+            idx.push_back(ijkl);
+            val.push_back(ijkl + 0.5);
+        }
+    const two_e_section_t section{idx.data(), val.data(), (idx_t)idx.size()};
+    const TEJView<double> J(N_orb, IC_G, section);
+    CHECK(J.J() == val.data());
+    CHECK(J.J_ind() == idx.data());
+    CHECK(J.size() == section.size);
+
+    spin_det_t orbitals(N_orb);
+    for (idx_t i = 0; i < N_orb; i++)
+        for (idx_t j = 0; j < N_orb; j++)
+            for (idx_t k = 0; k < N_orb; k++)
+                for (idx_t l = 0; l < N_orb; l++) {
+                    const idx_t ijkl = compound_idx4(i, j, k, l);
+                    const bool owned = std::binary_search(idx.begin(), idx.end(), ijkl);
+                    REQUIRE(J.owns_index(i, j, k, l) == owned);
+                    REQUIRE(J(i, j, k, l) == (owned ? ijkl + 0.5 : 0));
+                    if (owned)
+                        for (const idx_t o : {i, j, k, l})
+                            orbitals.set(o);
+                }
+    CHECK(J.orbital_mask == orbitals);
+    CHECK((idx_t)J.active_orbitals.size() == (idx_t)orbitals.count());
+
+    // the kernels read the section in place
+    std::vector<double> res(N_ext);
+    G_pt2_kernel(J.J(), J.J_ind(), J.size(), psi_int.data(), N_int, psi_ext.data(), N_ext,
+                 res.data());
+    CHECK(std::count(res.begin(), res.end(), 0.) < N_ext);
+
+    CHECK_THROWS_AS(TEJView<double>(N_orb, (j_category)N_CATEGORIES, section),
+                    std::invalid_argument);
+}
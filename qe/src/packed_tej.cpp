@@ -0,0 +1,85 @@
+#if !defined(DOCTEST_CONFIG_DISABLE)
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#endif
+#include <doctest/doctest.h>
+#include <packed_tej.h>
+#include <random>
+
+TEST_CASE("testing packed_tej_t") {
+    const idx_t n_orb = 6;
+    CHECK(packed_tej_t<double>::n_integrals(n_orb) == compound_idx4(5, 5, 5, 5) + 1);
+
+    packed_tej_t<double> J(n_orb);
+    CHECK(J.size() == packed_tej_t<double>::n_integrals(n_orb));
+    CHECK(reinterpret_cast<uintptr_t>(J.data()) % 64 == 0);
+    for (idx_t i = 0; i < n_orb; i++)
+        for (idx_t j = 0; j < n_orb; j++)
+            for (idx_t k = 0; k < n_orb; k++)
+                for (idx_t l = 0; l < n_orb; l++)
+                    REQUIRE(J.index(i, j, k, l) == compound_idx4(i, j, k, l));
+
+    std::mt19937 rng(0);
+    std::vector<idx_t> idx(J.size());
+    std::vector<double> val(J.size());
+    for (idx_t p = 0; p < J.size(); p++) {
+        idx[p] = p;
+        val[p] = std::uniform_real_distribution<double>(-1, 1)(rng);
+    }
+    J.assign(idx.data(), val.data(), J.size());
+    // the 8 permutations of (ij|kl) share one value
+    for (idx_t i = 0; i < n_orb; i++)
+        for (idx_t j = 0; j < n_orb; j++)
+            for (idx_t k = 0; k < n_orb; k++)
+                for (idx_t l = 0; l < n_orb; l++) {
+                    const double v = val[compound_idx4(i, j, k, l)];
+                    REQUIRE(J(i, j, k, l) == v);
+                    REQUIRE(J(k, j, i, l) == v);
+                    REQUIRE(J(i, l, k, j) == v);
+                    REQUIRE(J(k, l, i, j) == v);
+                    REQUIRE(J(j, i, l, k) == v);
+                    REQUIRE(J(l, i, j, k) == v);
+                    REQUIRE(J(j, k, l, i) == v);
+                    REQUIRE(J(l, k, j, i) == v);
+                }
+    J.prefetch(1, 2, 3, 4);
+}
+
+TEST_CASE("testing packed_tej_slice_t") {
+    const idx_t n_orb = 5, n_ranks = 4;
+    const idx_t n = packed_tej_slice_t<double>::n_integrals(n_orb);
+    std::vector<idx_t> idx(n);
+    std::vector<double> val(n);
+    for (idx_t p = 0; p < n; p++) {
+        idx[p] = p;
+        val[p] = p + 1;
+    }
+
+    idx_t covered = 0;
+    for (idx_t rank = 0; rank < n_ranks; rank++) {
+        const auto [first, last] = packed_tej_slice_t<double>::owner_range(n_orb, rank, n_ranks);
+        CHECK(first == covered);
+        CHECK(last - first >= n / n_ranks);
+        CHECK(last - first <= n / n_ranks + 1);
+        covered = last;
+
+        packed_tej_slice_t<double> J(n_orb, first, last);
+        CHECK(J.size() == last - first);
+        J.assign(idx.data(), val.data(), n);
+        for (idx_t i = 0; i < n_orb; i++)
+            for (idx_t j = 0; j < n_orb; j++)
+                for (idx_t k = 0; k < n_orb; k++)
+                    for (idx_t l = 0; l < n_orb; l++) {
+                        const idx_t ijkl = compound_idx4(i, j, k, l);
+                        const bool owned = ijkl >= first && ijkl < last;
+                        REQUIRE(J.owns_index(ijkl) == owned);
+                        REQUIRE(J(i, j, k, l) == (owned ? ijkl + 1 : 0));
+                        J.prefetch(i, j, k, l);
+                    }
+        if (J.size())
+            CHECK(J[first] == first + 1);
+    }
+    CHECK(covered == n);
+
+    CHECK_THROWS_AS(packed_tej_slice_t<double>(n_orb, 0, n + 1), std::invalid_argument);
+    CHECK_THROWS_AS(packed_tej_slice_t<double>(n_orb, 2, 1), std::invalid_argument);
+}
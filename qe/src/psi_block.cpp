@@ -0,0 +1,275 @@
+#if !defined(DOCTEST_CONFIG_DISABLE)
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#endif
+#include <doctest/doctest.h>
+#include <iostream>
+#include <psi_block.h>
+#if defined(__AVX2__) || defined(__AVX512BW__)
+#include <immintrin.h>
+#endif
+
+namespace {
+
+#if defined(__AVX512BW__) && !defined(__AVX512VPOPCNTDQ__)
+// Per-byte popcount of 64 bytes, by nibble table lookup
+inline __m512i popcount_bytes(__m512i x) {
+    const __m512i lut = _mm512_broadcast_i32x4(
+        _mm_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4));
+    const __m512i low = _mm512_set1_epi8(0x0f);
+    const __m512i hi = _mm512_and_si512(_mm512_srli_epi64(x, 4), low);
+    return _mm512_add_epi8(_mm512_shuffle_epi8(lut, _mm512_and_si512(x, low)),
+                           _mm512_shuffle_epi8(lut, hi));
+}
+#elif defined(__AVX2__)
+inline __m256i popcount_bytes(__m256i x) {
+    const __m256i lut = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4, 0, 1, 1, 2,
+                                         1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+    const __m256i low = _mm256_set1_epi8(0x0f);
+    const __m256i hi = _mm256_and_si256(_mm256_srli_epi64(x, 4), low);
+    return _mm256_add_epi8(_mm256_shuffle_epi8(lut, _mm256_and_si256(x, low)),
+                           _mm256_shuffle_epi8(lut, hi));
+}
+#endif
+
+// Number of differing orbitals (2 * excitation degree) between `ref` and dets i .. i + PAD of
+// `ext`. Per-byte counts are summed over all words before being reduced to 64-bit lanes, which
+// cannot overflow since 2 * N_WORDS * 8 <= 255 for every supported width.
+template <std::size_t N_WORDS>
+void count_differences_block(const static_det_t<N_WORDS> &ref,
+                             const psi_block_view<N_WORDS> &ext, std::size_t i, uint64_t *counts) {
+    static_assert(psi_block<N_WORDS>::PAD == 8, "one 512-bit register of dets");
+    static_assert(2 * N_WORDS * 8 <= 255, "per-byte counts must fit in a byte");
+#if defined(__AVX512VPOPCNTDQ__)
+    __m512i acc = _mm512_setzero_si512();
+    for (int s = 0; s < N_SPIN_SPECIES; s++)
+        for (std::size_t w = 0; w < N_WORDS; w++) {
+            const __m512i x = _mm512_xor_si512(_mm512_load_si512(ext.spin(s, w) + i),
+                                               _mm512_set1_epi64(ref[s].blocks[w]));
+            acc = _mm512_add_epi64(acc, _mm512_popcnt_epi64(x));
+        }
+    _mm512_storeu_si512(counts, acc);
+#elif defined(__AVX512BW__)
+    __m512i acc = _mm512_setzero_si512();
+    for (int s = 0; s < N_SPIN_SPECIES; s++)
+        for (std::size_t w = 0; w < N_WORDS; w++) {
+            const __m512i x = _mm512_xor_si512(_mm512_load_si512(ext.spin(s, w) + i),
+                                               _mm512_set1_epi64(ref[s].blocks[w]));
+            acc = _mm512_add_epi8(acc, popcount_bytes(x));
+        }
+    _mm512_storeu_si512(counts, _mm512_sad_epu8(acc, _mm512_setzero_si512()));
+#elif defined(__AVX2__)
+    __m256i lo = _mm256_setzero_si256(), hi = _mm256_setzero_si256();
+    for (int s = 0; s < N_SPIN_SPECIES; s++)
+        for (std::size_t w = 0; w < N_WORDS; w++) {
+            const __m256i r = _mm256_set1_epi64x(ref[s].blocks[w]);
+            const auto *x = reinterpret_cast<const __m256i *>(ext.spin(s, w) + i);
+            lo = _mm256_add_epi8(lo, popcount_bytes(_mm256_xor_si256(_mm256_load_si256(x), r)));
+            hi = _mm256_add_epi8(hi, popcount_bytes(_mm256_xor_si256(_mm256_load_si256(x + 1), r)));
+        }
+    const __m256i zero = _mm256_setzero_si256();
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(counts), _mm256_sad_epu8(lo, zero));
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(counts + 4), _mm256_sad_epu8(hi, zero));
+#else
+    for (std::size_t k = 0; k < psi_block<N_WORDS>::PAD; k++)
+        counts[k] = 0;
+    for (int s = 0; s < N_SPIN_SPECIES; s++)
+        for (std::size_t w = 0; w < N_WORDS; w++) {
+            const uint64_t r = ref[s].blocks[w];
+            const uint64_t *x = ext.spin(s, w) + i;
+            for (std::size_t k = 0; k < psi_block<N_WORDS>::PAD; k++)
+                counts[k] += __builtin_popcountll(x[k] ^ r);
+        }
+#endif
+}
+
+} // namespace
+
+template <std::size_t N_WORDS>
+void filter_connected(const static_det_t<N_WORDS> &ref, const psi_block_view<N_WORDS> &ext,
+                      connected_idx_t &out) {
+    constexpr std::size_t PAD = psi_block<N_WORDS>::PAD;
+    alignas(64) uint64_t counts[PAD];
+    for (std::size_t i = 0; i < ext.size(); i += PAD) {
+        count_differences_block(ref, ext, i, counts);
+        // padding dets past ext.size() are never reported
+        const std::size_t n = std::min(PAD, ext.size() - i);
+        for (std::size_t k = 0; k < n; k++) {
+            if (counts[k] == 2)
+                out.singles.push_back(i + k);
+            else if (counts[k] == 4)
+                out.doubles.push_back(i + k);
+        }
+    }
+}
+
+namespace {
+
+template <std::size_t N_WORDS>
+void filter_connected_words(const uint64_t *ref, const uint64_t *words, std::size_t n,
+                            std::size_t stride, int8_t *degree) {
+    static_det_t<N_WORDS> d;
+    for (std::size_t w = 0; w < N_WORDS; w++) {
+        d.alpha.blocks[w] = ref[w];
+        d.beta.blocks[w] = ref[N_WORDS + w];
+    }
+    connected_idx_t out;
+    filter_connected(d, psi_block_view<N_WORDS>(words, n, stride), out);
+    std::fill(degree, degree + n, 0);
+    for (const auto i : out.singles)
+        degree[i] = 1;
+    for (const auto i : out.doubles)
+        degree[i] = 2;
+}
+
+} // namespace
+
+extern "C" int psi_block_filter_connected(const int n_words, const uint64_t *ref,
+                                          const uint64_t *words, const std::size_t n,
+                                          const std::size_t stride, int8_t *degree) {
+    try {
+        switch (n_words) {
+        case 1:
+            filter_connected_words<1>(ref, words, n, stride, degree);
+            break;
+        case 2:
+            filter_connected_words<2>(ref, words, n, stride, degree);
+            break;
+        case 4:
+            filter_connected_words<4>(ref, words, n, stride, degree);
+            break;
+        case 8:
+            filter_connected_words<8>(ref, words, n, stride, degree);
+            break;
+        default:
+            throw std::invalid_argument("psi_block: n_words must be 1, 2, 4 or 8");
+        }
+        return 0;
+    } catch (const std::exception &e) {
+        std::cerr << e.what() << '\n';
+        return -1;
+    }
+}
+
+TEST_CASE("testing psi_block") {
+    psi_block<2> psi;
+    CHECK(psi.empty());
+    const static_det_t<2> d{static_spin_det_t<2>{"0111"}, static_spin_det_t<2>{"0011"}};
+    for (std::size_t i = 0; i < 20; i++) {
+        auto e = d;
+        e.beta.set(64 + i);
+        psi.push_back(e);
+    }
+    CHECK(psi.size() == 20);
+    CHECK(psi.capacity() % psi_block<2>::PAD == 0);
+    auto shrunk = psi;
+    shrunk.reserve(100);
+    shrunk.resize(9);
+    CHECK(shrunk.capacity() == 104);
+    shrunk.shrink_to_fit();
+    CHECK(shrunk.capacity() == 16);
+    CHECK(shrunk[8] == psi[8]);
+    CHECK(reinterpret_cast<std::uintptr_t>(psi.beta(1)) % 64 == 0);
+    CHECK(psi.beta(1)[5] == (uint64_t(1) << 5));
+    CHECK(psi[7].beta[71]);
+    CHECK(psi[7].alpha == d.alpha);
+
+    // sort and gather
+    std::vector<static_det_t<2>> dets;
+    for (std::size_t i = 0; i < psi.size(); i++)
+        dets.push_back(psi[psi.size() - 1 - i]);
+    psi_block<2> rev(dets.data(), dets.size());
+    const auto perm = rev.sort();
+    CHECK(perm[0] == 19);
+    std::sort(dets.begin(), dets.end());
+    for (std::size_t i = 0; i < dets.size(); i++)
+        CHECK(rev[i] == dets[i]);
+    const std::size_t idx[3] = {4, 0, 4};
+    const auto g = rev.gather(idx, 3);
+    CHECK(g.size() == 3);
+    CHECK(g[0] == dets[4]);
+    CHECK(g[1] == dets[0]);
+    CHECK(g[2] == dets[4]);
+
+    // heap-backed dets are converted word by word
+    det_t dd{spin_det_t(67), spin_det_t("11")};
+    dd.alpha[0] = 1;
+    dd.alpha[66] = 1;
+    psi_block<2> from_det_t(&dd, 1);
+    CHECK(from_det_t.alpha(0)[0] == 1);
+    CHECK(from_det_t.alpha(1)[0] == 4);
+    CHECK(from_det_t.view().occupied(0, 66, 0));
+    CHECK(!from_det_t.view().occupied(1, 2, 0));
+
+    // NumPy layout: element (s, w, i) at byte offset s * strides[0] + w * strides[1] + i * 8
+    const auto shape = psi.numpy_shape();
+    const auto strides = psi.numpy_strides();
+    CHECK(shape == std::array<std::size_t, 3>{2, 2, psi.capacity()});
+    const auto *bytes = reinterpret_cast<const char *>(psi.data());
+    CHECK(*reinterpret_cast<const uint64_t *>(bytes + strides[0] + strides[1] + 5 * strides[2]) ==
+          psi.beta(1)[5]);
+
+    // views over foreign arrays must keep the alignment and padding of psi_block
+    const psi_block_view<2> over(psi.data(), psi.size(), psi.capacity());
+    CHECK(over[5] == psi[5]);
+    CHECK_THROWS_AS(psi_block_view<2>(psi.data() + 1, 3, psi.capacity()), std::invalid_argument);
+    CHECK_THROWS_AS(psi_block_view<2>(psi.data(), 3, 12), std::invalid_argument);
+    CHECK_THROWS_AS(psi_block_view<2>(psi.data(), 17, 16), std::invalid_argument);
+}
+
+TEST_CASE("testing filter_connected") {
+    // ref and every single / double of it, interleaved with disconnected dets, across both words
+    const static_det_t<2> ref{static_spin_det_t<2>{"00001111"}, static_spin_det_t<2>{"0111"}};
+    std::vector<static_det_t<2>> psi{ref};
+    for (uint64_t p : {4, 70, 127})
+        psi.push_back(apply_single_excitation(ref, 0, 1, p));
+    psi.push_back(apply_double_excitation(ref, {0, 1}, 3, 2, 100, 3));
+    psi.push_back(apply_double_excitation(ref, {1, 1}, 0, 1, 80, 81));
+    psi.push_back(apply_double_excitation(apply_single_excitation(ref, 0, 0, 90), {0, 1}, 3, 2,
+                                          100, 3)); // triple
+    for (int k = 0; k < 10; k++)
+        psi.push_back(apply_single_excitation(ref, 1, 2, 64 + k));
+
+    const psi_block<2> block(psi.data(), psi.size());
+    connected_idx_t out;
+    filter_connected(ref, block, out);
+    std::vector<std::size_t> singles{1, 2, 3};
+    for (std::size_t k = 7; k < psi.size(); k++)
+        singles.push_back(k);
+    CHECK(out.singles == singles);
+    CHECK(out.doubles == std::vector<std::size_t>{4, 5});
+
+    // agrees with the scalar excitation degree
+    for (std::size_t i = 0; i < psi.size(); i++) {
+        const auto exc = get_excitation_info(ref, psi[i]);
+        const bool single = std::count(out.singles.begin(), out.singles.end(), i);
+        const bool dbl = std::count(out.doubles.begin(), out.doubles.end(), i);
+        CHECK(single == (exc.order() == 1));
+        CHECK(dbl == (exc.order() == 2));
+    }
+}
+
+TEST_CASE("testing psi_block_filter_connected") {
+    const static_det_t<2> ref{static_spin_det_t<2>{"0011"}, static_spin_det_t<2>{"0011"}};
+    const std::vector<static_det_t<2>> psi{ref, apply_single_excitation(ref, 1, 0, 70),
+                                           apply_double_excitation(ref, {0, 1}, 1, 1, 2, 100)};
+    const psi_block<2> block(psi.data(), psi.size());
+    const uint64_t words[4] = {ref.alpha.blocks[0], ref.alpha.blocks[1], ref.beta.blocks[0],
+                               ref.beta.blocks[1]};
+    std::vector<int8_t> degree(psi.size(), -1);
+    CHECK(psi_block_filter_connected(2, words, block.data(), psi.size(), block.capacity(),
+                                     degree.data()) == 0);
+    CHECK(degree == std::vector<int8_t>{0, 1, 2});
+    CHECK(psi_block_filter_connected(3, words, block.data(), psi.size(), block.capacity(),
+                                     degree.data()) == -1);
+    CHECK(psi_block_filter_connected(2, words, block.data() + 1, psi.size(), block.capacity(),
+                                     degree.data()) == -1);
+}
+
+template void filter_connected(const static_det_t<1> &, const psi_block_view<1> &,
+                               connected_idx_t &);
+template void filter_connected(const static_det_t<2> &, const psi_block_view<2> &,
+                               connected_idx_t &);
+template void filter_connected(const static_det_t<4> &, const psi_block_view<4> &,
+                               connected_idx_t &);
+template void filter_connected(const static_det_t<8> &, const psi_block_view<8> &,
+                               connected_idx_t &);
@@ -0,0 +1,100 @@
+#if !defined(DOCTEST_CONFIG_DISABLE)
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#endif
+#include <doctest/doctest.h>
+#include <psi_index.h>
+#include <random>
+#include <set>
+
+namespace {
+
+// Random dets sharing few alpha and beta strings, as in a selected CI wavefunction
+template <class det_type> std::vector<det_type> random_psi(std::size_t n_orb, std::size_t n) {
+    std::mt19937 rng(0);
+    typedef typename det_type::spin_type spin_type;
+    auto string = [&](int n_elec) {
+        spin_type s(n_orb);
+        for (int k = 0; k < n_elec;) {
+            const auto o = rng() % n_orb;
+            if (!s[o]) {
+                s[o] = 1;
+                k++;
+            }
+        }
+        return s;
+    };
+    std::vector<spin_type> alphas, betas;
+    for (int k = 0; k < 12; k++) {
+        alphas.push_back(string(3));
+        betas.push_back(string(2));
+    }
+    std::set<det_type> psi;
+    while (psi.size() < n)
+        psi.insert(det_type{alphas[rng() % alphas.size()], betas[rng() % betas.size()]});
+    std::vector<det_type> res(psi.begin(), psi.end());
+    std::shuffle(res.begin(), res.end(), rng);
+    return res;
+}
+
+template <class det_type> void check_psi_index(std::size_t n_orb) {
+    const auto all = random_psi<det_type>(n_orb, 60);
+    const std::vector<det_type> psi(all.begin(), all.begin() + 50), others(all.begin() + 50,
+                                                                           all.end());
+    const psi_index<typename det_type::spin_type> index(psi);
+    CHECK(index.size() == psi.size());
+    CHECK(index.n_strings(0) <= 12);
+
+    for (std::size_t i = 0; i < psi.size(); i++) {
+        CHECK(index.find(psi[i]) == i);
+        const auto &[alpha_id, beta_id] = index.ids(i);
+        CHECK(index.string(0, alpha_id) == psi[i].alpha);
+        CHECK(index.string(1, beta_id) == psi[i].beta);
+    }
+    for (const auto &d : others)
+        CHECK(index.find(d) == index.npos);
+
+    // connections of members and non members agree with a scan of psi
+    for (const auto &d : all) {
+        std::vector<std::size_t> singles[2], doubles, expected_singles[2], expected_doubles;
+        for (int s = 0; s < N_SPIN_SPECIES; s++)
+            index.single_spin_singles(d, s, singles[s]);
+        index.opposite_spin_doubles(d, doubles);
+        for (std::size_t i = 0; i < psi.size(); i++) {
+            const auto exc = get_excitation_info(d, psi[i]);
+            if (exc.order() == 1)
+                expected_singles[exc.degree[0] ? 0 : 1].push_back(i);
+            if (exc.degree[0] == 1 && exc.degree[1] == 1)
+                expected_doubles.push_back(i);
+        }
+        for (int s = 0; s < N_SPIN_SPECIES; s++) {
+            std::sort(singles[s].begin(), singles[s].end());
+            CHECK(singles[s] == expected_singles[s]);
+        }
+        std::sort(doubles.begin(), doubles.end());
+        CHECK(doubles == expected_doubles);
+    }
+}
+
+} // namespace
+
+TEST_CASE("testing psi_index") {
+    SUBCASE("static_det_t") { check_psi_index<static_det_t<1>>(20); }
+    SUBCASE("det_t") { check_psi_index<det_t>(70); }
+
+    SUBCASE("rows") {
+        const std::vector<static_det_t<1>> psi{
+            {static_spin_det_t<1>{"11"}, static_spin_det_t<1>{"101"}},
+            {static_spin_det_t<1>{"11"}, static_spin_det_t<1>{"11"}},
+            {static_spin_det_t<1>{"110"}, static_spin_det_t<1>{"11"}}};
+        const psi_index<static_spin_det_t<1>> index(psi);
+        CHECK(index.n_strings(0) == 2);
+        CHECK(index.n_strings(1) == 2);
+        // beta "11" < "101": row of alpha "11" lists det 1 then det 0
+        const auto r = index.row(0, index.string_id(0, static_spin_det_t<1>{"11"}));
+        CHECK(r.size() == 2);
+        CHECK(r.begin()[0].det == 1);
+        CHECK(r.begin()[1].det == 0);
+        CHECK(index.row(1, index.string_id(1, static_spin_det_t<1>{"11"})).size() == 2);
+        CHECK(index.string_id(0, static_spin_det_t<1>{"1001"}) == index.npos);
+    }
+}
@@ -0,0 +1,87 @@
+#if !defined(DOCTEST_CONFIG_DISABLE)
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#endif
+#include <doctest/doctest.h>
+#include <map>
+#include <random>
+#include <sort_reduce.h>
+
+namespace {
+
+// n random dets, with many duplicates, and their payloads; also the expected reduction
+template <std::size_t N_WORDS>
+void random_batch(std::size_t n, std::size_t n_orb, psi_block<N_WORDS> &dets,
+                  std::vector<double> &payload,
+                  std::map<static_det_t<N_WORDS>, double> &expected) {
+    std::mt19937 rng(0);
+    std::vector<static_det_t<N_WORDS>> distinct(n / 4 + 1);
+    for (auto &d : distinct)
+        for (int s = 0; s < N_SPIN_SPECIES; s++)
+            for (int k = 0; k < 3; k++)
+                d[s][rng() % n_orb] = 1;
+    for (std::size_t i = 0; i < n; i++) {
+        const auto &d = distinct[rng() % distinct.size()];
+        const double v = rng() % 1000;
+        dets.push_back(d);
+        payload.push_back(v);
+        expected[d] += v;
+    }
+}
+
+template <std::size_t N_WORDS>
+void check_sort_reduce(std::size_t n, std::size_t n_orb, unsigned n_threads,
+                       std::size_t chunk_size) {
+    psi_block<N_WORDS> dets;
+    std::vector<double> payload;
+    std::map<static_det_t<N_WORDS>, double> expected;
+    random_batch(n, n_orb, dets, payload, expected);
+
+    sort_reduce(dets, payload, n_threads, chunk_size);
+    REQUIRE(dets.size() == expected.size());
+    REQUIRE(payload.size() == expected.size());
+    // the memory of the input batch is released
+    CHECK(dets.capacity() < dets.size() + psi_block<N_WORDS>::PAD);
+    std::size_t i = 0;
+    for (const auto &[d, v] : expected) {
+        CHECK(dets[i] == d);
+        CHECK(payload[i] == v);
+        i++;
+    }
+}
+
+} // namespace
+
+TEST_CASE("testing sort_reduce") {
+    SUBCASE("empty") {
+        psi_block<1> dets;
+        std::vector<double> payload;
+        sort_reduce(dets, payload);
+        CHECK(dets.empty());
+        CHECK(payload.empty());
+    }
+    SUBCASE("one word") { check_sort_reduce<1>(1000, 20, 1, 1 << 22); }
+    SUBCASE("two words") { check_sort_reduce<2>(1000, 100, 1, 1 << 22); }
+    SUBCASE("chunks") { check_sort_reduce<2>(1000, 100, 1, 64); }
+    SUBCASE("threads") { check_sort_reduce<2>(300000, 100, 4, 1 << 22); }
+    SUBCASE("threads and chunks") { check_sort_reduce<1>(300000, 60, 4, 100000); }
+    // more runs than dets per chunk, and single-det output blocks
+    SUBCASE("many runs") { check_sort_reduce<1>(1000, 20, 1, 5); }
+    SUBCASE("many runs, wider blocks") { check_sort_reduce<2>(5000, 100, 1, 300); }
+    // rounds of the merge split between threads
+    SUBCASE("threaded merge") { check_sort_reduce<1>(1200000, 60, 4, 400000); }
+
+    SUBCASE("psi_block order") {
+        psi_block<2> dets, sorted;
+        std::vector<double> payload;
+        std::map<static_det_t<2>, double> expected;
+        random_batch(500, 128, dets, payload, expected);
+        sorted = dets;
+        sorted.sort();
+        sort_reduce(dets, payload);
+        std::size_t j = 0;
+        for (std::size_t i = 0; i < sorted.size(); i++)
+            if (i == 0 || !(sorted[i] == sorted[i - 1]))
+                CHECK(dets[j++] == sorted[i]);
+        CHECK(j == dets.size());
+    }
+}
@@ -0,0 +1,82 @@
+#if !defined(DOCTEST_CONFIG_DISABLE)
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#endif
+#include <doctest/doctest.h>
+#include <random>
+#include <sparse_tej.h>
+
+TEST_CASE("testing sparse_tej_t") {
+    const idx_t n_orb = 5;
+    const idx_t n_pairs = n_orb * (n_orb + 1) / 2;
+    const idx_t n = n_pairs * (n_pairs + 1) / 2;
+    const double threshold = 1e-10;
+
+    // integrals of magnitude 1e-14 to 1, split by category as in an fcidump_t
+    std::mt19937 rng(0);
+    std::vector<double> values(n);
+    std::array<std::vector<idx_t>, N_CATEGORIES> idx;
+    std::array<std::vector<double>, N_CATEGORIES> val;
+    idx_t n_small = 0;
+    double small_sq = 0;
+    for (idx_t p = 0; p < n; p++) {
+        const double exponent = std::uniform_real_distribution<double>(-14, 0)(rng);
+        values[p] = (rng() % 2 ? 1 : -1) * std::pow(10., exponent);
+        const int c = category_idx4(idx4_reverse(p));
+        idx[c].push_back(p);
+        val[c].push_back(values[p]);
+        if (std::abs(values[p]) < threshold) {
+            n_small++;
+            small_sq += values[p] * values[p];
+        }
+    }
+    REQUIRE(n_small > 0);
+
+    sparse_tej_t<double> J(n_orb, threshold);
+    for (int c = 0; c < N_CATEGORIES; c++)
+        J.assign(c, idx[c].data(), val[c].data(), idx[c].size());
+    CHECK(J.n_dropped() == n_small);
+    CHECK(J.size() == n - n_small);
+    CHECK(J.dropped_norm() == doctest::Approx(std::sqrt(small_sq)));
+
+    // reassigning a category replaces its integrals and its share of the dropped ones
+    std::vector<double> scaled(val[IC_G]);
+    for (auto &v : scaled)
+        v *= 1e-20;
+    const idx_t n_small_G = std::count_if(val[IC_G].begin(), val[IC_G].end(),
+                                          [&](double v) { return std::abs(v) < threshold; });
+    J.assign(IC_G, idx[IC_G].data(), scaled.data(), idx[IC_G].size());
+    CHECK(J.size(IC_G) == 0);
+    CHECK(J.n_dropped() == n_small - n_small_G + (idx_t)idx[IC_G].size());
+    J.assign(IC_G, idx[IC_G].data(), val[IC_G].data(), idx[IC_G].size());
+    CHECK(J.n_dropped() == n_small);
+    CHECK(J.size() == n - n_small);
+    CHECK(J.dropped_norm() == doctest::Approx(std::sqrt(small_sq)));
+
+    for (int c = 0; c < N_CATEGORIES; c++) {
+        CHECK(std::is_sorted(J.idx(c), J.idx(c) + J.size(c)));
+        for (idx_t p = 0; p < J.size(c); p++) {
+            CHECK(std::abs(J.val(c)[p]) >= threshold);
+            CHECK(J.val(c)[p] == values[J.idx(c)[p]]);
+        }
+    }
+
+    for (idx_t i = 0; i < n_orb; i++)
+        for (idx_t j = 0; j < n_orb; j++)
+            for (idx_t k = 0; k < n_orb; k++)
+                for (idx_t l = 0; l < n_orb; l++) {
+                    const double v = values[compound_idx4(i, j, k, l)];
+                    const double expected = std::abs(v) >= threshold ? v : 0;
+                    REQUIRE(J(i, j, k, l) == expected);
+                    REQUIRE(J(k, j, i, l) == expected);
+                    REQUIRE(J(j, i, l, k) == expected);
+                    REQUIRE(J(l, k, j, i) == expected);
+                }
+
+    // no screening keeps everything
+    sparse_tej_t<double> J_all(n_orb);
+    for (int c = 0; c < N_CATEGORIES; c++)
+        J_all.assign(c, idx[c].data(), val[c].data(), idx[c].size());
+    CHECK(J_all.size() == n);
+    CHECK(J_all.n_dropped() == 0);
+    CHECK(J_all.dropped_norm() == 0);
+}
@@ -5,6 +5,7 @@ import time
 import sys
 import os
 import random
+import numpy as np
 
 sys.path.insert(0, os.path.abspath(os.path.join(os.path.dirname(__file__), "..")))
 from qe.integral_indexing_utils import (
@@ -15,6 +16,9 @@ from qe.integral_indexing_utils import (
     compound_idx2_reverse,
     compound_idx4_reverse_all,
     compound_idx4_reverse_all_unique,
+    compound_idx4_batch,
+    canonical_idx4_batch,
+    compound_idx4_reverse_batch,
 )
 from qe.drivers import (
     integral_category,
@@ -28,6 +32,8 @@ from qe.drivers import (
     check_constraint,
 )
 from qe.io import load_eref, load_integrals, load_wf
+from qe.chunking import JChunkFactory, FakeComm, native_chunks
+from qe import psi_block
 from collections import defaultdict
 from itertools import product, chain
 from functools import cached_property
@@ -62,11 +68,14 @@ class Test_Index(Timing, unittest.TestCase):
     def test_idx2_reverse(self, n=10000, nmax=(1 << 60) - 1):
         def check_idx2_reverse(ij):
             i, j = compound_idx2_reverse(ij)
-            self.assertTrue(i <= j)
+            self.assertTrue(0 <= i <= j)
             self.assertEqual(ij, compound_idx2(i, j))
 
         for ij in random.sample(range(nmax), k=n):
             check_idx2_reverse(ij)
+        # just below triangular numbers, where a floating point square root rounds up
+        for q in random.sample(range(1, 1 << 30), k=n):
+            check_idx2_reverse(q * (q + 1) // 2 - 1)
 
     def test_idx4_reverse(self, n=10000, nmax=(1 << 60) - 1):
         def check_idx4_reverse(ijkl):
@@ -117,6 +126,21 @@ class Test_Index(Timing, unittest.TestCase):
         for ijkl in random.sample(range(nmax), k=n):
             check_compound_idx4_reverse_all_unique(ijkl)
 
+    def test_batch(self, n=10000, nmax=(1 << 60) - 1):
+        ijkl = random.sample(range(nmax), k=n)
+        i, j, k, l = compound_idx4_reverse_batch(ijkl)
+        self.assertEqual(
+            list(zip(i.tolist(), j.tolist(), k.tolist(), l.tolist())),
+            [compound_idx4_reverse(x) for x in ijkl],
+        )
+        # non-canonical permutations of the same integrals
+        self.assertEqual(compound_idx4_batch(k, l, i, j).tolist(), ijkl)
+        canonical = canonical_idx4_batch(l, i, j, k)
+        self.assertEqual(
+            list(zip(*(x.tolist() for x in canonical))),
+            [canonical_idx4(*compound_idx4_reverse(x)) for x in ijkl],
+        )
+
 
 class Test_Category(Timing, unittest.TestCase):
     def test_pair_categorization(self, n=10000, nmax=(1 << 60) - 1):
@@ -278,6 +302,50 @@ class Test_Category(Timing, unittest.TestCase):
             )
 
 
+class Test_Chunking(Timing, unittest.TestCase):
+    def test_native_chunks(self, N_mo=12, comm_size=3, chunk_size=100):
+        for category in "ABCDEFG":
+            stream = list(getattr(JChunkFactory, f"{category}_idx_iter")(N_mo))
+            src = (np.array(sorted(stream)), np.array(sorted(stream)) * 0.5)
+            self.assertEqual(native_chunks(N_mo, category).idx.tolist(), stream)
+            for rank in range(comm_size):
+                comm = FakeComm(rank, comm_size)
+                chunk = native_chunks(N_mo, category, src, comm=comm)
+                self.assertEqual(chunk.idx.tolist(), stream[rank::comm_size])
+                self.assertEqual(chunk.J.tolist(), (chunk.idx * 0.5).tolist())
+                batches = [stream[b : b + chunk_size] for b in range(0, len(stream), chunk_size)]
+                chunks = native_chunks(N_mo, category, src, chunk_size, comm)
+                self.assertEqual([c.idx.tolist() for c in chunks], batches[rank::comm_size])
+
+
+class Test_PsiBlock(Timing, unittest.TestCase):
+    def check_filter_connected(self, ref, dets, n_orb):
+        block = psi_block.to_psi_block(dets, n_orb)
+        self.assertEqual(block.ctypes.data % 64, 0)
+        self.assertEqual(psi_block.from_psi_block(block, len(dets)), dets)
+        singles, doubles = psi_block.filter_connected(ref, block, len(dets))
+        degree = [sum(ref.exc_degree(det)) for det in dets]
+        self.assertEqual(singles.tolist(), [i for i, d in enumerate(degree) if d == 1])
+        self.assertEqual(doubles.tolist(), [i for i, d in enumerate(degree) if d == 2])
+
+    def test_filter_connected(self, n_orb=8):
+        ref = Determinant((0, 1, 2), (0, 1), "tuple")
+        dets = [ref] + list(ref.gen_all_connected_det(n_orb))
+        dets += [Determinant((3, 4, 5), (0, 1), "tuple"), Determinant((0, 5, 6), (2, 3), "tuple")]
+        self.check_filter_connected(ref, dets, n_orb)
+
+    def test_filter_connected_multiword(self, n_orb=200):
+        ref = Determinant((0, 70, 150), (1, 130), "tuple")
+        dets = [
+            Determinant((0, 70, 199), (1, 130), "tuple"),
+            Determinant((0, 65, 150), (1, 64), "tuple"),
+            Determinant((2, 3, 4), (1, 130), "tuple"),
+            ref,
+        ]
+        self.check_filter_connected(ref, dets, n_orb)
+        self.assertEqual(psi_block.to_psi_block(dets, n_orb).shape, (2, 4, 8))
+
+
 class Test_Minimal(Timing, unittest.TestCase):
     @staticmethod
     def simplify_indices(l):